@@ -26,6 +26,9 @@ mac {
 
 QMAKE_LFLAGS_RELEASE += -s
 
+# clock_gettime() of monoclock.cpp
+linux-*:LIBS += -lrt
+
 DESTDIR = .
 OBJECTS_DIR = _build/obj
 UI_DIR = _build/uic
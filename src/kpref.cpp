@@ -22,9 +22,13 @@
 
 #include "kpref.h"
 #include "desktop.h"
+#include "bideval.h"
 #include "deskview.h"
 #include "updatecheck.h"
 
+#include <QDesktopServices>
+#include <QDir>
+#include <QFile>
 #include <QSettings>
 
 //#include <QTextBrowser>
@@ -53,6 +57,42 @@ inline const char * GenName(const QString &str, const QString &ext);
 
 //char *documentation; //see bottom this file
 
+// Finished deals of all games go to one archive in user's data directory
+static void openDealArchive (PrefModel *model) {
+  QString dir = QDesktopServices::storageLocation(QDesktopServices::DataLocation);
+  if (dir.isEmpty() || !QDir().mkpath(dir)) return;
+  if (!model->openDealArchive(dir+"/deals.opda"))
+    qWarning() << "Can't open deal archive in" << dir;
+}
+
+
+// Decisions for offline replay (see tracereplay tool), if asked for
+static void openDecisionTrace (PrefModel *model) {
+  QByteArray fileName = qgetenv("OPENPREF_DECISION_TRACE");
+  if (!fileName.isEmpty() && !model->openDecisionTrace(QString::fromLocal8Bit(fileName)))
+    qWarning() << "Can't open decision trace" << fileName;
+}
+
+
+// Predetermined deals and export of deals (binary if named *.opdl), if asked for
+static void openDealFiles (PrefModel *model) {
+  QString fileName = QString::fromLocal8Bit(qgetenv("OPENPREF_DEALS"));
+  if (!fileName.isEmpty() && !model->openDealSource(fileName))
+    qWarning() << "Can't read deal file" << fileName;
+  fileName = QString::fromLocal8Bit(qgetenv("OPENPREF_DEALS_EXPORT"));
+  if (!fileName.isEmpty() && !model->openDealExport(fileName, fileName.endsWith(".opdl")))
+    qWarning() << "Can't write deal file" << fileName;
+}
+
+
+// Bidding weights fitted by bidtrain, if user has put them next to the archive
+static void loadBidWeights () {
+  QString fileName = QDesktopServices::storageLocation(QDesktopServices::DataLocation)+"/bidweights.txt";
+  if (QFile::exists(fileName) && !BidEvaluator::global().load(fileName))
+    qWarning() << "Can't read bidding weights from" << fileName;
+}
+
+
 MainWindow::MainWindow (bool fullScreen) : m_fullScreen(fullScreen)
 {
   setWindowTitle("OpenPref");
@@ -68,6 +108,10 @@ MainWindow::MainWindow (bool fullScreen) : m_fullScreen(fullScreen)
   mDeskView = new DeskView(this);
   setCentralWidget(mDeskView);
   m_PrefModel = new PrefModel(mDeskView);
+  openDealArchive(m_PrefModel);
+  openDecisionTrace(m_PrefModel);
+  openDealFiles(m_PrefModel);
+  loadBidWeights();
   mDeskView->setModel(m_PrefModel);
   m_optionDialog = new OptionDialog(this);
   m_updateCheck = UpdateCheck::instance(mDeskView);
@@ -247,6 +291,9 @@ void MainWindow::newSingleGame ()
     mDeskView->ClearScreen();
     delete m_PrefModel;
     m_PrefModel = new PrefModel(mDeskView);
+    openDealArchive(m_PrefModel);
+    openDecisionTrace(m_PrefModel);
+    openDealFiles(m_PrefModel);
     mDeskView->setModel(m_PrefModel);
     doConnects();
     
@@ -269,6 +316,8 @@ void MainWindow::newSingleGame ()
     m_PrefModel->optAlphaBeta1 = dlg->cbAlphaBeta1->isChecked();
     m_PrefModel->optPlayerName2 = dlg->leName2->text();
     m_PrefModel->optAlphaBeta2 = dlg->cbAlphaBeta2->isChecked();
+    // no option in the dialog yet
+    m_PrefModel->optClaim = st.value("fastforward", false).toBool();
   
     writeSettings();
     //actFileOpen->setEnabled(false);
@@ -322,6 +371,7 @@ void MainWindow::writeSettings () {
   st.setValue("alphabeta1", m_PrefModel->optAlphaBeta1);
   st.setValue("playername2", m_PrefModel->optPlayerName2);
   st.setValue("alphabeta2", m_PrefModel->optAlphaBeta2);
+  st.setValue("fastforward", m_PrefModel->optClaim);
 }
 
 
@@ -344,6 +394,7 @@ void MainWindow::readSettings () {
   m_PrefModel->optAlphaBeta1 = (st.value("alphabeta1", false).toBool());
   m_PrefModel->optPlayerName2 = st.value("playername2", tr("Player 2")).toString();
   m_PrefModel->optAlphaBeta2 = (st.value("alphabeta2", false).toBool());
+  m_PrefModel->optClaim = st.value("fastforward", false).toBool();
   //optWithoutThree = st.value("without3", false).toBool();
   //optAggPass = st.value("aggpass", false).toBool();
 
@@ -0,0 +1,56 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef ABCSEARCH_H
+#define ABCSEARCH_H
+
+#include <QtGlobal>
+
+#include "searchstats.h"
+
+/**
+ * @class AbcSearch abcsearch.h
+ * @brief Card play search of AlphaBetaPlayer
+ *
+ * Hands are 32-bit card masks (see cardBitNo()). Unlike DDSolver, there
+ * are no coalitions: every player takes as many tricks as he can for
+ * himself (as few as he can in misere and pass-out), and the tree is cut
+ * with alpha-beta pruning for three players. Search state is global, so
+ * only one search can run at a time.
+ */
+class AbcSearch {
+public:
+  /**
+   * Returns the card (bit number) player @a me (1..3) should play. Trick so
+   * far is @a tableCnt cards of @a table in order of play, @a tricks are
+   * tricks players 1..3 took already. @a strain is trump suit 1..4,
+   * anything else is no trumps; first tricks of pass-out are led in
+   * @a passOutSuit (1..4, 0 if free). Counters of the search go to @a stats,
+   * tricks @a me ends the deal with on the found line go to @a score (10
+   * minus them in misere)
+   */
+  static int bestMove (const quint32 hands[3], const int tricks[3], const int table[], int tableCnt,
+    int me, int strain, bool misere, int passOutSuit, SearchStats &stats, int *score=0);
+};
+
+
+#endif
@@ -28,475 +28,12 @@
 #include "prfconst.h"
 #include "formbid.h"
 #include "desktop.h"
-
-typedef unsigned char  card_t;
-
-static inline card_t CARD (int face, int suit) {
-  Q_ASSERT(!(face < 7 || face > 14 || suit < 0 || suit > 3));
-  return ((face-7)*4+suit)+1;
-}
-
-
-static inline int SUIT (int c) {
-  return (c-1)%4;
-}
-
-
-static inline int FACE (int c) {
-  return ((c-1)/4)+7;
-}
-
-
-static inline int compareCards (int c0, int c1) {
-  int t0 = SUIT(c0), t1 = SUIT(c1);
-  int r = t1-t0;
-  if (!r) {
-    t0 = FACE(c0), t1 = FACE(c1);
-    r = t0-t1;
-  }
-  return r;
-}
-
-
-void xsortCards (card_t *arr, int len) {
-  int f, c;
-  for (f = 0; f < len; f++) {
-    for (c = len-1; c > f; c--) {
-      int cc = compareCards(arr[c], arr[f]);
-      if (cc > 0) {
-        int t = arr[c];
-        arr[c] = arr[f];
-        arr[f] = t;
-      }
-    }
-  }
-}
-
-
-static int gTrumpSuit; // trump; global var
-static int gPassOutSuit; // нужная масть для первого или второго круга распасов
-//static int gGameBid; // >=6
-//static int gMoves[4][10];
-//static int gTricks[3];
-//static int gE0, gE1, gMe;
-//static int gWhoPlays;
-static int gIterations;
-
-//static int gTrk = 0;
-static bool gPassOutOrMisere;
-
-
-typedef struct {
-  int faces[10];
-  int suits[10];
-  int suitCount[4]; // # of cards in each suit
-  int suitStart[4]; // 1st card of each suit
-  int tricks;
-} tHand;
-
-
-//static long long xStTime, cTime;
-static tHand xHands[3];
-static int xCardsLeft;
-static int xDeskFaces[3], xDeskSuits[3];
-//static int lastMoveF, lastMoveS;
-static QTime stTime;
-
-
-//#define ABDEBUG
-//#define ADVANCED_RES
-/*
- * карты должны быть отсортированы по мастям в порядке убывания "морды"
- * a: игрок player набрал максимум вот столько
- * b: игрок player+1 набрал максимум вот столько
- * c: игрок player+2 набрал максимум вот столько
- * возврат: то же самое
- *
- * идея и псевдокод взяты отсюда: http://clauchau.free.fr/gamma.html
- * idea and pseudocode was taken from here: http://clauchau.free.fr/gamma.html
- */
-static void abcPrune (
-  int turn, int player,
-  int a, int b, int c,
-  int *ra, int *rb, int *rc, int *rm
-) {
-    /*
-     * (x, y, z) := some static additive evaluation of Position,
-     * x measuring how good is Position for the Player to move,
-     * y measuring how good is Position for the next Player,
-     * z measuring how good is Position for the further next Player,
-     * the higher the better, -infinite for a defeat, +infinite for a win;
-     *
-     * if the game is over then return (x, y, z, "game over");
-     * else return ( min(x-y, x-z), min(y-x, y-z), min(z-x, z-y), "static" );
-     */
-/*
-  if (!xCardsLeft) {
-    gIterations++;
-    if (gIterations%8000000 == 0) {
-      cTime = getTimeMs();
-      fprintf(stderr, "\r%i (%i seconds)\x1b[K", gIterations, (int)((cTime-xStTime)/1000));
-    }
-    *ra = xHands[player].tricks;
-    *rb = xHands[(player+1)%3].tricks;
-    *rc = xHands[(player+2)%3].tricks;
-    return;
-  }
-*/
-
-  //int lmF = lastMoveF, lmS = lastMoveS;
-#ifdef ABDEBUG
-  printf("cards left: %i; turn: %i\n", xCardsLeft, turn);
-  printStatus(turn, player, 0);
-#endif
-
-  tHand *hand = &(xHands[player]);
-  //int bestx = a, worsty = b, worstz = c;
-  int bestx = -666, worsty = 666, worstz = 666;
-  int bestm = -1;
-  int n = 0; // will count equivalent moves
-  int crdFace, crdSuit, tmp, who = -1;
-  int newTurn = turn+1, newPlayer = (player+1)%3;
-  int sDeskFaces[3], sDeskSuits[3];
-  sDeskFaces[0] = xDeskFaces[0]; sDeskFaces[1] = xDeskFaces[1]; sDeskFaces[2] = xDeskFaces[2];
-  sDeskSuits[0] = xDeskSuits[0]; sDeskSuits[1] = xDeskSuits[1]; sDeskSuits[2] = xDeskSuits[2];
-  if (turn == 2) {
-    newTurn = 0;
-    --xCardsLeft;
-  }
-  int crdNo = 0, crdNext, ccc = 0;
-  for (int f = 0; f < 10; f++) if (hand->faces[f]) ccc++;
-  //if (!ccc) { abort(); }
-  Q_ASSERT(ccc);
-  //int movesChecked = 0, firstm = -1;
-  while (crdNo < 10) {
-    crdFace = hand->faces[crdNo];
-    if (!hand->faces[crdNo]) {
-      crdNo++;
-      continue;
-    }
-    crdNext = crdNo+1;
-    crdSuit = hand->suits[crdNo];
-    if (turn == 0) {
-      // первый ход может быть любой ваще, если это не первый и не второй круг распасов
-      if (gPassOutSuit >= 0 && crdSuit != gPassOutSuit && hand->suitCount[gPassOutSuit]) {
-        // не, это очень херовая масть, начнём с верной масти
-        tmp = hand->suitStart[gPassOutSuit];
-        //if (tmp == crdNo) abort(); // а такого не бывает
-        Q_ASSERT(tmp != crdNo);
-        if (tmp < crdNo) break; // ну нет у нас такой, и уже всё, что было, проверили
-        // скипаем и повторяем выборы
-        crdNo = tmp;
-        continue;
-      }
-      goto doMove;
-    }
-    // check for valid move
-    // выход в правильную масть?
-    if (crdSuit == xDeskSuits[0]) goto doMove;
-    // не, не та масть; ну-ка, чо у нас на руках ваще?
-    // нужная масть у нас есть?
-    if (hand->suitCount[xDeskSuits[0]]) {
-      // таки есть, потому это очень хуёвый вариант; ходим сразу с нужной масти
-      tmp = hand->suitStart[xDeskSuits[0]];
-      if (tmp < crdNo) break; // всё, нечего больше искать
-      if (tmp > crdNo) {
-        // скипаем
-        crdNo = tmp;
-        continue;
-      }
-      // вот этой и ходим
-      goto doMove;
-    }
-    // не, нужной масти нет
-    // а козырь есть?
-    if (gTrumpSuit <= 3) {
-      // игра козырная, есть козыри?
-      if (hand->suitCount[gTrumpSuit]) {
-        // таки есть
-        tmp = hand->suitStart[gTrumpSuit];
-        if (tmp < crdNo) break; // всё, нечего больше искать
-        if (tmp > crdNo) {
-          // скипаем
-          crdNo = tmp;
-          continue;
-        }
-        // вот этой и ходим
-        goto doMove;
-      } else {
-        // не, и козырей нет, можно кидать чо попало
-        goto doMove;
-      }
-    } else {
-      // игра бескозырная, тут любая карта пойдёт, хули
-      goto doMove;
-    }
-doMove:
-/*
-    movesChecked++;
-    if (firstm < 0) firstm = crdNo;
-*/
-    // проскипаем последовательность из плавно убывающих карт одной масти
-    // очевидно, что при таком раскладе похуй, какой из них ходить
-    int scnt = hand->suitCount[crdSuit];
-    if (scnt > 1) {
-      // в этой масти есть ещё карты
-      // проверим, есть ли у кого ещё эта масть
-      if (xHands[0].suitCount[crdSuit]+xHands[1].suitCount[crdSuit]+xHands[2].suitCount[crdSuit] <= scnt) {
-        // единственный гордый владелец этой масти; пробуем только одну её карту
-        int tsuit = crdSuit+1;
-        while (tsuit <= 3 && hand->suitCount[tsuit] == 0) tsuit++;
-        crdNext = tsuit>3 ? 11 : hand->suitStart[tsuit];
-      } else {
-        // такая масть есть ещё у кого-то
-        int tface = crdFace+1;
-        while (crdNext <= 10 && hand->suits[crdNext] == crdSuit && hand->faces[crdNext] == tface) {
-          crdNext++;
-          tface++;
-        }
-      }
-    }
-    // кидаем карту на стол
-    xDeskSuits[turn] = crdSuit;
-    xDeskFaces[turn] = crdFace;
-    // убираем карту из руки
-    hand->suitCount[crdSuit]--;
-    if (crdNo == hand->suitStart[crdSuit]) hand->suitStart[crdSuit]++;
-    hand->faces[crdNo] = 0;
-
-    //lastMoveF = crdFace; lastMoveS = crdSuit;
-    int y, z, x;
-    if (turn == 2) {
-      // the turn is done, count tricks
-      //who = whoTakes(pdesk, gTrumpSuit);
-      // а кто, собственно, забрал?
-      if (gTrumpSuit <= 3) {
-        // trump game
-        if (xDeskSuits[0] == gTrumpSuit) {
-          // нулевой козырнул
-          who = 0; tmp = xDeskFaces[0];
-          if (xDeskSuits[1] == xDeskSuits[0] && xDeskFaces[1] > tmp) { tmp = xDeskFaces[1]; who = 1; }
-          if (xDeskSuits[2] == xDeskSuits[0] && xDeskFaces[2] > tmp) who = 2;
-        } else if (xDeskSuits[1] == gTrumpSuit) {
-          // первый козырнул
-          who = 1; tmp = xDeskFaces[0];
-          if (xDeskSuits[2] == xDeskSuits[1] && xDeskFaces[2] > tmp) who = 2;
-        } else if (xDeskSuits[2] == gTrumpSuit) {
-          // второй козырнул
-          who = 2;
-        } else {
-          // никто не козырял
-          who = 0; tmp = xDeskFaces[0];
-          if (xDeskSuits[1] == xDeskSuits[0] && xDeskFaces[1] > tmp) { tmp = xDeskFaces[1]; who = 1; }
-          if (xDeskSuits[2] == xDeskSuits[0] && xDeskFaces[2] > tmp) who = 2;
-        }
-      } else {
-        // notrump game
-        who = 0; tmp = xDeskFaces[0];
-        if (xDeskSuits[1] == xDeskSuits[0] && xDeskFaces[1] > tmp) { tmp = xDeskFaces[1]; who = 1; }
-        if (xDeskSuits[2] == xDeskSuits[0] && xDeskFaces[2] > tmp) who = 2;
-      }
-      who = (who+player+1)%3;
-      xHands[who].tricks++; // прибавили взятку
-#ifdef ABDEBUG
-      printf("==%i takes; cards left: %i; turn: %i\n", who, xCardsLeft, turn);
-      printStatus(turn, player, 1);
-#endif
-      //if (xCardsLeft < 0) abort();
-      Q_ASSERT(xCardsLeft >= 0);
-      if (!xCardsLeft) {
-        // всё, отбомбились, даёшь коэффициенты
-        gIterations++;
-        if (gIterations%1000000 == 0) {
-          if (stTime.elapsed() >= 5000) {
-            stTime.start();
-            //cTime = getTimeMs();
-            //fprintf(stderr, "\r%i (%i seconds)\x1b[K", gIterations, (int)((cTime-xStTime)/1000));
-            fprintf(stderr, "\r%i\x1b[K", gIterations);
-          }
-        }
-/*
-        y = xHands[newPlayer].tricks;
-        z = xHands[(newPlayer+1)%3].tricks;
-        x = xHands[(newPlayer+2)%3].tricks;
-*/
-        x = xHands[player].tricks;
-        y = xHands[newPlayer].tricks;
-        z = xHands[(player+2)%3].tricks;
-        if (gPassOutOrMisere) {
-          x = 10-x;
-          y = 10-y;
-          z = 10-z;
-        }
-#ifdef ADVANCED_RES
-        if (player == gWhoPlays) {
-          // я играю; выиграл ли?
-          if (x < gGameBid) {
-            // нет, обезлаплен
-            x = -gGameBid-1; /*y = z = 666;*/
-          } else {
-            // да, взял своё
-            x = 20+gGameBid;
-/*
-            switch (gGameBid) {
-              case 6:
-                if (y < 2) y = -666+y; // bad
-                if (z < 2) z = -666+z; // bad
-                break;
-              case 7: case 8: case 9:
-                if (y < 1) y = -666+y; // bad
-                if (z < 1) z = -666+z; // bad
-                break;
-            }
-*/
-          }
-        } else {
-          // я вистую; получилось ли?
-          if (xHands[gWhoPlays].tricks < gGameBid) {
-            // по любому засадили чувачка
-            //x = 666-(gGameBid-xHands[gWhoPlays].tricks); // на сколько
-            // чувак в жопе
-            if (gWhoPlays == newPlayer) {
-              //y = -xHands[gWhoPlays].tricks-1;
-              //z = 666;
-            } else {
-              //z = -xHands[gWhoPlays].tricks-1;
-              //y = 666;
-            }
-          } else {
-            // нет, чувак, увы, взял своё; а я?
-/*
-            switch (gGameBid) {
-              case 6:
-                if (x < 2) x = -15-x; else x = 15+x;
-                break;
-              case 7: case 8: case 9:
-                if (x < 1) x = -15-x; else x = 15+x;
-                break;
-            }
-            if (gWhoPlays == newPlayer) {
-              y = 666;
-              switch (gGameBid) {
-                case 6:
-                  if (z < 2) z = -15-z; else z = 15+z;
-                  break;
-                case 7: case 8: case 9:
-                  if (z < 1) z = -15-z; else z = 15+z;
-                  break;
-              }
-            } else {
-              z = 666;
-              switch (gGameBid) {
-                case 6:
-                  if (y < 2) y = -15-y; else y = 15+y;
-                  break;
-                case 7: case 8: case 9:
-                  if (y < 1) y = -15-y; else y = 15+y;
-                  break;
-              }
-            }
-*/
-          }
-        }
-#endif
-        //printStatus(2, player, 0);
-      } else {
-        // рекурсивно проверяем дальше
-        //abcPrune(newTurn, newPlayer, -c, -a, b, &y, &z, &x, NULL);
-        if (who == player) {
-          // я же и забрал, снова здорово
-          abcPrune(0, player, a, b, c, &x, &y, &z, NULL);
-        } else if (who == newPlayer) {
-          // следующий забрал; красота и благолепие
-          abcPrune(0, newPlayer, -c, -a, b, &y, &z, &x, NULL);
-        } else {
-          // предыдущий забрал; вот такие вот параметры вышли; путём трэйсинга, да
-          abcPrune(0, who, -b, c, -a, &z, &x, &y, NULL);
-        }
-      }
-      // брали взятку? восстановим статус кво
-      xHands[who].tricks--;
-    } else {
-      // рекурсивно проверяем дальше
-      abcPrune(newTurn, newPlayer, -c, -a, b, &y, &z, &x, NULL);
-    }
-    // восстановим стол
-    xDeskFaces[0] = sDeskFaces[0]; xDeskFaces[1] = sDeskFaces[1]; xDeskFaces[2] = sDeskFaces[2];
-    xDeskSuits[0] = sDeskSuits[0]; xDeskSuits[1] = sDeskSuits[1]; xDeskSuits[2] = sDeskSuits[2];
-    // вернём в руку карту
-    hand->suitCount[crdSuit]++;
-    hand->faces[crdNo] = crdFace;
-    if (crdNo+1 == hand->suitStart[crdSuit]) hand->suitStart[crdSuit]--;
-    // проверим, чо нашли
-    if (bestm >= 0 && x == bestx) {
-      // we've found an equivalent move
-      //if (bestm < 0) abort();
-      n++;
-      if (y < worsty) worsty = y;
-      if (z < worstz) worstz = z;
-      //if (myrand()%n == n-1) bestm = crdNo;
-      // hands are sorted, so take the smallest possible card
-      if (bestm < 0 || crdFace < hand->faces[bestm]) bestm = crdNo;
-    } else if (x > bestx) {
-      // we've found a better move
-      n = 1;
-      bestm = crdNo;
-      bestx = x; worsty = y; worstz = z;
-      if (x > b || x > c) break; // всё, дальше искать не надо, всё равно мы крутые; goto done;
-      if (x > a) a = x;
-    }
-    // берём следующую карту
-    crdNo = crdNext;
-  }
-  xDeskFaces[0] = sDeskFaces[0]; xDeskFaces[1] = sDeskFaces[1]; xDeskFaces[2] = sDeskFaces[2];
-  xDeskSuits[0] = sDeskSuits[0]; xDeskSuits[1] = sDeskSuits[1]; xDeskSuits[2] = sDeskSuits[2];
-  if (turn == 2) {
-    xCardsLeft++;
-  }
-  *ra = bestx; *rb = worsty; *rc = worstz;
-  if (rm) *rm = bestm;
-/*
-  if (rm) *rm = bestm>=0?bestm:firstm;
-  if (bestm < 0) {
-    fprintf(stderr, "first: %i (%i)\n", firstm, movesChecked);
-  }
-*/
-  //lastMoveF = lmF; lastMoveS = lmS;
-}
-
-
-//static card_t hands[3][10];
-
-
-
-static const char *cFaceS[8] = {" 7"," 8"," 9","10"," J"," Q"," K"," A"};
-static const char *cSuitS[4] = {"s","c","d","h"};
-
-static void printHand (tHand *hand) {
-  int z;
-  for (z = 0; z < 10; z++) {
-    if (hand->faces[z]) {
-      printf(" %s%s(%2i)", cFaceS[hand->faces[z]-7], cSuitS[hand->suits[z]], CARD(hand->faces[z], hand->suits[z]));
-    } else {
-      printf(" ...");
-    }
-  }
-  printf("  0:(%i,%i); 1:(%i,%i); 2:(%i,%i); 3:(%i,%i)",
-    hand->suitCount[0], hand->suitStart[0],
-    hand->suitCount[1], hand->suitStart[1],
-    hand->suitCount[2], hand->suitStart[2],
-    hand->suitCount[3], hand->suitStart[3]);
-  printf("\n");
-}
-
-
-static void printDesk (int cnt) {
-  printf("desk:");
-  for (int z = 0; z < cnt; z++) {
-    printf(" %s%s(%2i)", cFaceS[xDeskFaces[z]-7], cSuitS[xDeskSuits[z]], CARD(xDeskFaces[z], xDeskSuits[z]));
-  }
-  printf("\n");
-}
+#include "bidsim.h"
+#include "miseredrop.h"
+#include "talonenum.h"
+#include "whistsim.h"
+#include "searchstats.h"
+#include "abcsearch.h"
 
 
 /*
@@ -508,10 +45,9 @@ static void printDesk (int cnt) {
 Card *AlphaBetaPlayer::makeMove (Card *lMove, Card *rMove, Player *aLeftPlayer, Player *aRightPlayer, bool isPassOut) {
   qDebug() << type() << "("<< mPlayerNo << ") moves";
   
-  card_t hands[3][10];
-  card_t desk[3];
+  quint32 hands[3];
+  int tricks[3];
   int crdLeft = 0;
-  int trumpSuit = 0;
   Player *plst[3];
 
 //again:
@@ -523,17 +59,11 @@ Card *AlphaBetaPlayer::makeMove (Card *lMove, Card *rMove, Player *aLeftPlayer,
   // build hands
   for (int c = 0; c < 3; c++) {
     Q_ASSERT(plst[c]);
-    CardList *clst = &(plst[c]->mCards);
-    //for (int f = 0; f < 10; f++) hds[c][f] = hands[c][f] = 0;
-    int pos = 0;
-    for (int f = 0; f < clst->size(); f++) {
-      Card *ct = clst->at(f);
-      if (!ct) continue;
-      hands[c][pos++] = CARD(ct->face(), ct->suit()-1);
-      if (pos > crdLeft) crdLeft = pos;
-    }
-    for (int f = pos; f < 10; f++) hands[c][f] = 0;
-    xsortCards(hands[c], pos);
+    hands[c] = plst[c]->mCards.mask();
+    tricks[c] = plst[c]->tricksTaken();
+    int cnt = 0;
+    for (quint32 m = hands[c]; m; m &= m-1) cnt++;
+    if (cnt > crdLeft) crdLeft = cnt;
   }
 
 
@@ -544,118 +74,43 @@ Card *AlphaBetaPlayer::makeMove (Card *lMove, Card *rMove, Player *aLeftPlayer,
 
   // find game
   const eGameBid bid = m_model->currentGame();
+  bool misere = (bid == g86 || bid == g86catch || bid == raspass);
+  int strain = misere ? 0 : bid%10;
 
-  gPassOutOrMisere = (bid == g86 || bid == g86catch || bid == raspass);
-  trumpSuit = bid%10-1;//(bid-(bid/10)*10)-1;
-/*
-  if (bid == g86catch || bid == g86 || bid == raspass) {
-    return Player::moveSelectCard(lMove, rMove, aLeftPlayer, aRightPlayer);
-  }
-*/
-  if (bid == g86catch || bid == g86 || bid == raspass) {
-    trumpSuit = 4;
-  }
-  if (trumpSuit < 0) trumpSuit = 4;
-
+#ifdef ABDEBUG
   fprintf(stderr, "po:%s; lm:%s, rm:%s\n", isPassOut?"y":"n", lMove?"y":"n", rMove?"y":"n");
+#endif
+  int passOutSuit = 0;
   if (isPassOut && rMove && !lMove) {
     // это распасы, первый или второй круг, первый ход
-    gPassOutSuit = rMove->suit()-1;
-    fprintf(stderr, "pass-out: %i\n", gPassOutSuit);
+    passOutSuit = rMove->suit();
     rMove = 0;
-  } else gPassOutSuit = -1;
+  }
 
   // build desk
+  int desk[2];
   int turn = 0;
   if (lMove) {
-    desk[turn++] = CARD(lMove->face(), lMove->suit()-1);
-    if (rMove) desk[turn++] = CARD(rMove->face(), rMove->suit()-1);
+    desk[turn++] = lMove->id();
+    if (rMove) desk[turn++] = rMove->id();
   } else if (rMove) {
-    desk[turn++] = CARD(rMove->face(), rMove->suit()-1);
-  }
-
-  // build hands
-  for (int f = 0; f < 3; f++) {
-    xHands[f].suitCount[0] = xHands[f].suitCount[1] = xHands[f].suitCount[2] = xHands[f].suitCount[3] = 0;
-    xHands[f].suitStart[0] = xHands[f].suitStart[1] = xHands[f].suitStart[2] = xHands[f].suitStart[3] = 11;
-    xHands[f].tricks = plst[f]->tricksTaken();
-    int st;
-    for (int z = 0; z < 10; z++) {
-      if (hands[f][z]) {
-        xHands[f].faces[z] = FACE(hands[f][z]);
-        st = xHands[f].suits[z] = SUIT(hands[f][z]);
-        if (xHands[f].suitCount[st]++ == 0) xHands[f].suitStart[st] = z;
-      } else xHands[f].faces[z] = 0;
-    }
-  }
-
-  // build desk
-  for (int f = 0; f < turn; f++) {
-    xDeskFaces[f] = FACE(desk[f]);
-    xDeskSuits[f] = SUIT(desk[f]);
+    desk[turn++] = rMove->id();
   }
 
-  int a, b, c, move;
-  int me = this->number()-1;
-  xCardsLeft = crdLeft;
-  gTrumpSuit = trumpSuit;
-  gIterations = 0;
-
-  printf("%shand 0:", this->number()==0?"*":" ");
-  printHand(&(xHands[0]));
-  printf("%shand 1:", this->number()==1?"*":" ");
-  printHand(&(xHands[1]));
-  printf("%shand 2:", this->number()==2?"*":" ");
-  printHand(&(xHands[2]));
-  printDesk(turn);
-
-  // оптимизации
-/*
-  if (turn > 0) {
-    // можем вообще взять?
-    if (hands[me].suitCount(
-  }
-*/
+  SearchStats stats;
+  int move = AbcSearch::bestMove(hands, tricks, desk, turn, mPlayerNo, strain, misere, passOutSuit, stats);
+  SearchStatsLog::instance().decision(mPlayerNo, "move", stats);
 
-  stTime = QTime::currentTime();
-  stTime.start();
-  abcPrune(turn, me, -666, 666, 666, &a, &b, &c, &move);
+  Card *moveCard = cardFromId(move);
 
   qDebug() <<
-    "face:" << FACE(hands[me][move]) <<
-    "suit:" << SUIT(hands[me][move])+1 <<
-    "move:" << move <<
+    "move:" << moveCard->toString() <<
     "turn:" << turn <<
     "moves:" << crdLeft <<
-    "trump:" << trumpSuit <<
-    "iters:" << gIterations <<
+    "strain:" << strain <<
+    "nodes:" << stats.totalNodes() <<
     "";
 
-/*
-  for (int h = 0; h < 3; h++) {
-    fprintf(stderr, (h == me)?"*":" ");
-    fprintf(stderr, "hand %i:", h);
-    for (int f = 0; f < 10; f++) {
-      if (hands[h][f]) {
-        fprintf(stderr, " %2i.%i(%3i)", FACE(hands[h][f]), SUIT(hands[h][f]), hands[h][f]);
-      } else {
-        fprintf(stderr, " %2i.%i(%3i)", 0, 0, hands[h][f]);
-      }
-    }
-    fprintf(stderr, "\n");
-  }
-  fprintf(stderr, "desk:");
-  for (int f = 0; f < turn; f++) {
-    fprintf(stderr, " %2i.%i(%3i)", FACE(desk[f]), SUIT(desk[f]), desk[f]);
-  }
-  fprintf(stderr, "\n");
-*/
-  Q_ASSERT(move >= 0);
-
-  Card *moveCard = getCard(FACE(hands[me][move]), SUIT(hands[me][move])+1);
-
-  qDebug() << "move:" << moveCard->toString();
-
   mCards.remove(moveCard);
   mCardsOut.insert(moveCard);
 
@@ -672,3 +127,121 @@ Player * AlphaBetaPlayer::create(int aMyNumber, PrefModel *model) {
   Player * pl = new AlphaBetaPlayer(aMyNumber, model);
   return pl;
 }
+
+
+// shared by all AlphaBeta players: players are copied by value during the deal
+static BidSimulator *bidSimulator () {
+  static BidSimulator *sim = 0;
+  if (!sim) sim = new BidSimulator;
+  return sim;
+}
+
+
+static TalonEvaluator *talonEvaluator () {
+  static TalonEvaluator *eval = 0;
+  if (!eval) eval = new TalonEvaluator;
+  return eval;
+}
+
+
+eGameBid AlphaBetaPlayer::makeBid (eGameBid lMove, eGameBid rMove) {
+  if (m_game == gtPass) return m_game;
+  eGameBid curMaxGame = qMax(lMove, rMove), minBid;
+  if (curMaxGame == g105 && !mIStart) {
+    // nothing left to bid
+    m_game = gtPass;
+    return m_game;
+  }
+  bool aggPass = m_model->optAggPass && m_model->optPassCount > 0;
+  bool opening = (lMove == gtPass || lMove == undefined) && (rMove == gtPass || rMove == undefined);
+  if (opening) minBid = g61;
+  else if (mIStart) minBid = curMaxGame;
+  else minBid = (eGameBid)succBid(curMaxGame);
+  if (aggPass && minBid < g71) minBid = g71;
+
+  // exact talon expectation screens out hopeless hands before the simulation
+  quint32 hand = mCards.mask();
+  if (talonEvaluator()->evaluate(hand).bestBid(minBid, opening && !aggPass) == gtPass) {
+    m_game = gtPass;
+    return m_game;
+  }
+  SearchStats before = bidSimulator()->stats();
+  QTime time;
+  time.start();
+  eGameBid best = bidSimulator()->chooseBid(hand, mPlayerNo,
+    m_model->nCurrentStart.nValue, minBid, opening && !aggPass, m_model->aiRandom());
+  SearchStats stats = bidSimulator()->stats();
+  stats -= before;
+  stats.msec = time.elapsed();
+  SearchStatsLog::instance().decision(mPlayerNo, "bid", stats);
+  // the samples couldn't tell the bids apart: the heuristic knows the hand as well
+  if (!bidSimulator()->separated()) return AiPlayer::makeBid(lMove, rMove);
+  if (best == gtPass || best == g86) m_game = best;
+  else {
+    // hold the auction with the cheapest game: misere isn't one
+    m_game = minBid;
+    if (m_game == g86) m_game = (eGameBid)succBid(m_game);
+  }
+  return m_game;
+}
+
+
+eGameBid AlphaBetaPlayer::dropForGame () {
+  quint32 cards = mCards.mask(), drop = 0;
+  eGameBid game = m_game;
+  double bestValue = 0;
+  quint32 drops[5];
+  int strainTricks[5];
+  TalonEvaluator::bestDrops(cards, drops, strainTricks);
+  for (int strain = 1; strain <= DDNoTrump; strain++) {
+    quint32 d = drops[strain-1];
+    int tricks = strainTricks[strain-1];
+    for (int level = 6; level <= 10; level++) {
+      eGameBid bid = (eGameBid)(level*10+strain);
+      if (bid < m_game) continue;
+      int price = gamePoolPrice(bid), need = gameTricks(bid);
+      double v = tricks >= need ? price : -price*(need-tricks);
+      if (!drop || v > bestValue) {
+        drop = d;
+        game = bid;
+        bestValue = v;
+      }
+    }
+  }
+
+  clearCardArea();
+  dropCards(drop);
+  draw();
+  m_game = game;
+  return m_game;
+}
+
+
+eGameBid AlphaBetaPlayer::dropForMisere () {
+  MisereDropSearch search;
+  dropCards(search.bestDrop(mCards.mask(), mPlayerNo, m_model->nCurrentStart.nValue,
+    m_model->aiRandom()));
+  return g86;
+}
+
+
+eGameBid AlphaBetaPlayer::makeFinalBid (eGameBid MaxGame, int nPlayerPass) {
+  // misere, Stalingrad and ten without whists have no choice
+  if (MaxGame == g86 || (m_model->optStalingrad && MaxGame == g61) ||
+      (!m_model->opt10Whist && MaxGame >= g101 && MaxGame <= g105))
+    return AiPlayer::makeFinalBid(MaxGame, nPlayerPass);
+  int partner = 6-mPlayerNo-m_model->activePlayerNumber();
+  eGameBid partnerBid = m_model->player(partner)->game();
+  // the partner sits after me and answers later, unless I decide again after his halfwhist;
+  // his game still holds his pass from the auction
+  if (partner == mPlayerNo%3+1 && nPlayerPass < 2) partnerBid = undefined;
+  WhistSimulator sim(m_model);
+  m_game = sim.chooseFinalBid(mCards.mask(), mPlayerNo, partnerBid, nPlayerPass);
+  return m_game;
+}
+
+
+bool AlphaBetaPlayer::chooseClosedWhist () {
+  WhistSimulator sim(m_model);
+  return sim.chooseClosed(mCards.mask(), mPlayerNo);
+}
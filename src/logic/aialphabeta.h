@@ -37,6 +37,17 @@ public:
   virtual Player * create(int aMyNumber, PrefModel *model);
 
   Card *makeMove (Card *lMove, Card *rMove, Player *aLeftPlayer, Player *aRightPlayer, bool isPassOut);
+  /// Bids by double-dummy simulation (see BidSimulator)
+  virtual eGameBid makeBid (eGameBid lMove, eGameBid rMove);
+  /// Whist, pass or halfwhist by expected score (see WhistSimulator)
+  virtual eGameBid makeFinalBid (eGameBid MaxGame, int nPlayerPass);
+  virtual bool chooseClosedWhist ();
+
+protected:
+  /// Drop and final contract by exact drop search (see TalonEvaluator)
+  virtual eGameBid dropForGame ();
+  /// Misere drop by search (see MisereDropSearch)
+  virtual eGameBid dropForMisere ();
 };
 
 
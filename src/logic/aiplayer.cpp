@@ -28,6 +28,7 @@
 #include <QPainter>
 
 #include "aiplayer.h"
+#include "bideval.h"
 #include "desktop.h"
 
 #include "debug.h"
@@ -40,7 +41,15 @@ enum eHand {
 };
 
 
+static inline int topBit (quint32 m) {
+  int res = 31;
+  while (!(m & 0x80000000u)) { m <<= 1; res--; }
+  return res;
+}
+
+
 AiPlayer::AiPlayer (int aMyNumber, PrefModel *model) : Player(aMyNumber, model) {
+  SuitTables::init();
   internalInit();
 }
 
@@ -59,6 +68,23 @@ void AiPlayer::clear () {
   mLeft.clear();
   mRight.clear();
   mOut.clear();
+  mTracker.clear();
+}
+
+
+// dropped cards go to mOut, where the heuristics look for them
+void AiPlayer::dropCards (quint32 drop) {
+  for (CardId id = 0; id < 32; id++) {
+    if (!(drop & cardIdMask(id))) continue;
+    mCards.removeId(id);
+    mOut.insertId(id);
+  }
+  mCards.mySort();
+}
+
+
+void AiPlayer::cardPlayed (int who, CardId card) {
+  mTracker.cardPlayed(who, card);
 }
 
 
@@ -120,70 +146,27 @@ Card *AiPlayer::GetMaxCardPere (int s0, int s1, int s2) {
 }
 
 
+// Suit holdings (one byte of card mask) are looked up in SuitTables
+static inline quint8 suitMask (const CardList &list, int suit) {
+  return (list.mask() >> ((suit-1)*8)) & 0xff;
+}
+
+
 tSuitProbs AiPlayer::countTricks (eSuit Mast, CardList &aMaxCardList, int a23) {
-  tSuitProbs suitProb;
-  Card *MyCard, *tmpCard;
-  CardList MyCardStack, EnemyCardStack;
-  for (int c = 7; c <= FACE_ACE; c++) {
-    MyCard = mCards.exists(c, Mast);
-    if (MyCard) MyCardStack.insert(MyCard);
-    MyCard = aMaxCardList.exists(c, Mast);
-    if (MyCard) EnemyCardStack.insert(MyCard);
-  }
-  if (a23 != 23) suitProb = calcProbsForMax(MyCardStack, EnemyCardStack);
-  else suitProb = calcProbsForMaxH23(MyCardStack, EnemyCardStack);
-  suitProb.len = mCards.cardsInSuit(Mast);
-  suitProb.sum = 0;
-  for (int j = 7; j <= FACE_ACE; j++ ) {
-    tmpCard = mCards.exists(j, Mast);
-    if (tmpCard) suitProb.sum += tmpCard->face();
-  }
-  return suitProb;
+  SuitTables::Mode mode = (a23 != 23) ? SuitTables::Max : SuitTables::MaxH23;
+  return SuitTables::probs(mode, suitMask(mCards, Mast), suitMask(aMaxCardList, Mast));
 }
 
 
 tSuitProbs AiPlayer::countGameTricks (eSuit Mast, int a23) {
-  tSuitProbs suitProb;
-  Card *MyCard, *tmpCard;
-  CardList MyCardStack, EnemyCardStack;
-
-  for (int c = 7; c <= FACE_ACE; c++) {
-    MyCard = mCards.exists(c, Mast);
-    if (MyCard) MyCardStack.insert(MyCard);
-    else EnemyCardStack.insert(getCard(c, Mast));
-  }
-  if (MyCardStack.count() >= 4 && MyCardStack.count() <= 5) EnemyCardStack.remove(EnemyCardStack.minFace());
-  if (a23 == 23) suitProb = calcProbsForMaxH23(MyCardStack, EnemyCardStack);
-  else suitProb = calcProbsForMax(MyCardStack, EnemyCardStack);
-  suitProb.len = mCards.cardsInSuit(Mast);
-  suitProb.sum = 0;
-  for (int j = 7; j <= FACE_ACE; j++) {
-    tmpCard = mCards.exists(j, Mast);
-    if (tmpCard) suitProb.sum += tmpCard->face();
-  }
-  return suitProb;
+  SuitTables::Mode mode = (a23 == 23) ? SuitTables::MaxH23 : SuitTables::Max;
+  return SuitTables::gameProbs(mode, suitMask(mCards, Mast));
 }
 
 
 //-----------------------------------------------------------------------
 tSuitProbs AiPlayer::countPassTricks (eSuit Mast, CardList &aMaxCardList) {
-  tSuitProbs suitProb;
-  Card *MyCard, *tmpCard;
-  CardList MyCardStack, EnemyCardStack;
-  for (int c = 7; c <= FACE_ACE; c++) {
-    MyCard = mCards.exists(c, Mast);
-    if (MyCard) MyCardStack.insert(MyCard);
-    MyCard = aMaxCardList.exists(c, Mast);
-    if (MyCard) EnemyCardStack.insert(MyCard);
-  }
-  suitProb = calcProbsForMin(MyCardStack, EnemyCardStack);
-  suitProb.len = mCards.cardsInSuit(Mast);
-  suitProb.sum = 0;
-  for (int j = 7; j <= FACE_ACE; j++) {
-    tmpCard = mCards.exists(j, Mast);
-    if (tmpCard) suitProb.sum += tmpCard->face();
-  }
-  return suitProb;
+  return SuitTables::probs(SuitTables::Min, suitMask(mCards, Mast), suitMask(aMaxCardList, Mast));
 }
 
 
@@ -200,125 +183,6 @@ bool AiPlayer::checkForMisere () {
 }
 
 
-//-----------------------------------------------------------------------
-// Для мин результата
-tSuitProbs AiPlayer::calcProbsForMin (CardList &my, CardList &enemy) {
-  tSuitProbs suitProb;
-  suitProb.tricks = 0;
-  suitProb.perehvatov = 0;
-  int nMaxLen;
-  Card *MyCardMin, *EnemyCardMax, *EnemyCardMin;
-  //!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-  //enemy->free(enemy->minFace());
-  nMaxLen = (my.count() > enemy.count()) ? my.count() : enemy.count() ;
-  //my.count()>enemy->count() ? nMaxLen = my->count() : nMaxLen = enemy->count();
-  for (int f = 1; f <= nMaxLen; f++)  {
-    MyCardMin = my.minFace();
-    EnemyCardMax = enemy.maxFace();
-    if (MyCardMin) {
-      EnemyCardMin = enemy.lesserInSuit(MyCardMin);
-      if (!EnemyCardMin) EnemyCardMin = enemy.minFace();
-    } else {
-      //EnemyCardMin = enemy->minFace();
-      break;
-    }
-    if (!EnemyCardMax && !EnemyCardMin) break;
-    if (*MyCardMin > *EnemyCardMin) {
-      // викидываем мою  его младшую
-      my.remove(MyCardMin);
-      enemy.remove(EnemyCardMin);
-      suitProb.tricks++;
-    } else {
-      my.remove(MyCardMin);
-      enemy.remove(EnemyCardMax);
-    }
-  }
-  return suitProb;
-}
-
-
-//-----------------------------------------------------------------------
-// Для максимального результата на 1 руке
-tSuitProbs AiPlayer::calcProbsForMax (CardList &my, CardList &enemy) {
-  tSuitProbs suitProb;
-  suitProb.tricks = 0;
-  suitProb.perehvatov = 0;
-  int nMaxLen, nIget = 1;
-  Card *MyCardMax = 0, *EnemyCardMax = 0, *EnemyCardMin = 0;
-  //my->count()>enemy->count() ? nMaxLen = my->count() : nMaxLen = enemy->count();
-  nMaxLen = (my.count() > enemy.count()) ? my.count() : enemy.count();
-  for (int f = 1; f <= nMaxLen; f++) {
-    MyCardMax = my.maxFace();
-    if (MyCardMax) {
-      EnemyCardMax = enemy.greaterInSuit(MyCardMax);
-      if (!EnemyCardMax) EnemyCardMax = enemy.minFace();
-    } else EnemyCardMax = enemy.maxFace();
-    EnemyCardMin = enemy.minFace();
-    if (!MyCardMax) break;
-    if (!EnemyCardMax && !EnemyCardMin)  {
-      // остаток -- мои взятки
-      for (int j = 1; j <= my.count(); j++) suitProb.tricks++;
-      break;
-    }
-    if (*MyCardMax > *EnemyCardMax) {
-      // викидываем мою старшую, его младшую
-      my.remove(MyCardMax);
-      enemy.remove(EnemyCardMin);
-      suitProb.tricks++;
-      if (!nIget) suitProb.perehvatov++;
-      nIget = 1;
-    } else {
-      my.remove(MyCardMax);
-      enemy.remove(EnemyCardMax);
-      nIget = 0;
-    }
-  }
-  return suitProb;
-}
-
-
-//-----------------------------------------------------------------------
-// Для максимального результата на 2 и 3 руке
-tSuitProbs AiPlayer::calcProbsForMaxH23 (CardList &my, CardList &enemy) {
-  tSuitProbs suitProb;
-  suitProb.tricks = 0;
-  suitProb.perehvatov = 0;
-  int nMaxLen,nIget = 1;
-  Card *MyCardMax, *EnemyCardMax;
-  //my->count()>enemy->count() ? nMaxLen = my->count() : nMaxLen = enemy->count();
-  nMaxLen = (my.count() > enemy.count()) ? my.count() : enemy.count();
-  for (int f = 1; f <= nMaxLen; f++) {
-    EnemyCardMax = enemy.maxFace();
-    if (EnemyCardMax) {
-      // Пытаемся н-ти больше чеm у него
-      MyCardMax = my.greaterInSuit(EnemyCardMax);
-      if (!MyCardMax) {
-        // Нет у меня больше чем у него
-        MyCardMax = my.minFace();
-        if (!MyCardMax) break; // и меньше тож нет
-        // Меньше чем у него
-        my.remove(MyCardMax);
-        enemy.remove(EnemyCardMax);
-        nIget = 0;
-      } else {
-        // Есть больше чем у него
-        my.remove(MyCardMax);
-        enemy.remove(EnemyCardMax);
-        suitProb.tricks++;
-        if (!nIget) suitProb.perehvatov++;
-        nIget = 1;
-      }
-    } else {
-      // У него нет карт в данной масти! остаток -- мои взятки
-      if (!enemy.count()) for (int j = 1; j <= my.count(); j++) suitProb.tricks++;
-      //25.07.2000 for ( int j =1; j<=my->count();j++ ) suitProb.tricks++;
-      break;
-    }
-  }
-  return suitProb;
-}
-
-
 ///////////////////////////////////////////////////////////////////////////////
 // Пересчитывает таблицу дли распасов или мизера
 void AiPlayer::recalcPassOutTables (CardList &aMaxCardList, int a23) {
@@ -326,8 +190,9 @@ void AiPlayer::recalcPassOutTables (CardList &aMaxCardList, int a23) {
   mSuitProb[0].tricks = 0;
   mSuitProb[0].perehvatov = 0;
   mSuitProb[0].sum = 0;
+  quint32 my = mCards.mask(), enemy = aMaxCardList.mask();
   for (int f = 1; f <= 4; f++)  {
-    mSuitProb[f] = countPassTricks((eSuit)f, aMaxCardList);
+    mSuitProb[f] = SuitTables::probs(SuitTables::Min, my >> ((f-1)*8), enemy >> ((f-1)*8));
     mSuitProb[0].tricks += mSuitProb[f].tricks;
     mSuitProb[0].perehvatov += mSuitProb[f].perehvatov;
     mSuitProb[0].sum += mSuitProb[f].sum;
@@ -342,8 +207,10 @@ void AiPlayer::recalcTables (CardList &aMaxCardList, int a23) {
   mSuitProb[0].tricks = 0;
   mSuitProb[0].perehvatov = 0;
   mSuitProb[0].sum = 0;
+  SuitTables::Mode mode = (a23 != 23) ? SuitTables::Max : SuitTables::MaxH23;
+  quint32 my = mCards.mask(), enemy = aMaxCardList.mask();
   for (f = 1; f <= 4; f++) {
-    mSuitProb[f] = countTricks((eSuit)f, aMaxCardList, a23);
+    mSuitProb[f] = SuitTables::probs(mode, my >> ((f-1)*8), enemy >> ((f-1)*8));
     mSuitProb[0].tricks += mSuitProb[f].tricks;
     mSuitProb[0].perehvatov += mSuitProb[f].perehvatov;
     mSuitProb[0].sum += mSuitProb[f].sum;
@@ -352,69 +219,29 @@ void AiPlayer::recalcTables (CardList &aMaxCardList, int a23) {
 
 
 void AiPlayer::loadLists (Player *aLeftPlayer, Player *aRightPlayer, CardList &aMaxCardList) {
-/*
-  int nLeftVisible = aLeftPlayer->nCardsVisible,nRightVisible = aRightPlayer->nCardsVisible;
-  int nCards = mCards.count();
-*/
-  mLeft.clear();
-  mRight.clear();
-/*
-  // !!!!!!!!!!!!!!!!!!!!!!!!! необходимо учитывать, что во взятках
-  if ( !nLeftVisible && !nRightVisible ) {
-      makestatfill(nCards,1); // ,1- for max list 2- for minlist
-  }
-  if ( nLeftVisible && !nRightVisible ) {
-      makestatfill(nCards,1); // ,1- for max list 2- for minlist
-  }
-  if ( !nLeftVisible && nRightVisible ) {
-      makestatfill(nCards,1); // ,1- for max list 2- for minlist
-  }
-  if ( nLeftVisible && nRightVisible ) {
-*/
-    mLeft = aLeftPlayer->mCards;
-    mRight = aRightPlayer->mCards;
-/*
-  }
-*/
-// Get Max List only len
-/*
+  quint32 left = handMask(aLeftPlayer), right = handMask(aRightPlayer);
+  // the tracker keeps these lists as cards are played; copies share the data
+  mLeft = mTracker.list(aLeftPlayer->number());
+  mRight = mTracker.list(aRightPlayer->number());
+  // both hands give their top cards until they run out; the last higher one is kept
   for (int m = 1; m <= 4; m++) {
-    for (int c = FACE_ACE; c >= 7; c--) {
-      if (mLeft.exists(c, m) || mRight.exists(c, m)) {
-        aMaxCardList.insert(newCard(c, m));
-      }
+    quint32 l = (left >> ((m-1)*8)) & 0xff, r = (right >> ((m-1)*8)) & 0xff;
+    int max = -1;
+    while (l || r) {
+      int lt = l ? topBit(l) : -1, rt = r ? topBit(r) : -1;
+      max = qMax(lt, rt);
+      if (lt >= 0) l &= ~(1u << lt);
+      if (rt >= 0) r &= ~(1u << rt);
     }
+    if (max >= 0) aMaxCardList.insertId((m-1)*8+max);
   }
-*/
-  for (int m = 1; m <= 4; m++) {
-    Card *LeftMax,*RightMax,*Max=0;
-    while (mLeft.cardsInSuit(m) || mRight.cardsInSuit(m)) {
-      LeftMax = mLeft.maxInSuit(m);
-      RightMax = mRight.maxInSuit(m);
-      if (LeftMax == 0 && RightMax == 0) {
-        Max = 0;
-      } else if (LeftMax == 0 && RightMax != 0) {
-        Max = RightMax;
-        mRight.remove(Max);
-      } else if (LeftMax != 0 && RightMax == 0) {
-        Max = LeftMax;
-        mLeft.remove(Max);
-      } else if (*LeftMax > *RightMax) {
-        Max = LeftMax;
-        mLeft.remove(LeftMax);
-        mRight.remove(RightMax);
-      } else {
-        Max = RightMax;
-        mLeft.remove(LeftMax);
-        mRight.remove(RightMax);
-      }
-    }
-    if (Max != 0) aMaxCardList.insert(getCard(Max->face(), Max->suit()));
-  }
-  mLeft.clear();
-  mRight.clear();
-  mLeft = aLeftPlayer->mCards;
-  mRight = aRightPlayer->mCards;
+}
+
+
+// Hand of @a plr as tracked since the start of play (see makeMove())
+quint32 AiPlayer::handMask (Player *plr) const {
+  Q_ASSERT(mTracker.isStarted());
+  return mTracker.hand(plr->number());
 }
 
 
@@ -1367,6 +1194,14 @@ Card *AiPlayer::MyPass3 (Card *aLeftCard, Card *aRightCard, Player *aLeftPlayer,
 Card *AiPlayer::makeMove (Card *lMove, Card *rMove, Player *aLeftPlayer, Player *aRightPlayer, bool isPassOut) {
   Q_UNUSED(isPassOut)
   qDebug() << type() << "("<< mPlayerNo << ") moves";
+  if (!mTracker.isStarted()) {
+    // first move in the deal: later cards come through cardPlayed()
+    quint32 hands[3];
+    hands[mPlayerNo-1] = mCards.mask();
+    hands[aLeftPlayer->number()-1] = aLeftPlayer->mCards.mask();
+    hands[aRightPlayer->number()-1] = aRightPlayer->mCards.mask();
+    mTracker.start(hands);
+  }
   Card *cur = 0;
   if (lMove == 0 && rMove == 0) {
     // мой заход - первый
@@ -1439,38 +1274,35 @@ eGameBid AiPlayer::makeFinalBid (eGameBid MaxGame, int nPlayerPass)
 
 ///////////////////////////////////////////////////////////////////////////////
 // calc drop
-eGameBid AiPlayer::moveCalcDrop () {
-  eGameBid GamesTypeRetVal;
-  int f;
+// Supposed trump is the longest suit, of equal ones the one with higher cards
+static eSuit longestSuit (const tSuitProbs *table) {
   int nMaxMastLen = 0;
   eSuit nMaxMast = SuitNone;
-  tSuitProbs LocalMastTable[5];
-  LocalMastTable[0].tricks = 0;
-  LocalMastTable[0].perehvatov = 0;
-  LocalMastTable[0].sum = 0;
-  for (f = 1; f <= 4; f++) {
-    LocalMastTable[f] = countGameTricks((eSuit)f, 1);
-    LocalMastTable[0].tricks += LocalMastTable[f].tricks;
-    LocalMastTable[0].perehvatov +=LocalMastTable[f].perehvatov;
-    LocalMastTable[0].sum += LocalMastTable[f].sum;
-  }
-  for (f = 1; f <= 4; f++) {
-    // предполагаемый козырь - самая длинная масть
-    if (mCards.cardsInSuit(f) > nMaxMastLen) {
-      nMaxMastLen = mCards.cardsInSuit(f);
+  for (int f = 1; f <= 4; f++) {
+    if (table[f].len > nMaxMastLen) {
+      nMaxMastLen = table[f].len;
       nMaxMast = (eSuit)f;
     }
   }
-  for (f = 1; f <= 4; f++) {
-    if (mCards.cardsInSuit(f) == nMaxMastLen && nMaxMast != f) {
-      // есть максимально длинные масти
-      if (LocalMastTable[f].sum > LocalMastTable[nMaxMast].sum) nMaxMast = (eSuit)f;
-    }
+  for (int f = 1; f <= 4; f++) {
+    if (table[f].len == nMaxMastLen && nMaxMast != f && table[f].sum > table[nMaxMast].sum)
+      nMaxMast = (eSuit)f;
   }
-  //масть и звятки уже посчитали
-  GamesTypeRetVal = (eGameBid)(LocalMastTable[0].tricks*10+nMaxMast);
-  // это то, что мы можем играть максимально
-  return GamesTypeRetVal;
+  return nMaxMast;
+}
+
+
+// Game that can be played with @a hand at most; perehvatov of the hand go to @a perehvatov
+static eGameBid maxGame (quint32 hand, int *perehvatov=0) {
+  tSuitProbs table[5];
+  SuitTables::handProbs(SuitTables::Max, hand, table);
+  if (perehvatov) *perehvatov = table[0].perehvatov;
+  return (eGameBid)(table[0].tricks*10+longestSuit(table));
+}
+
+
+eGameBid AiPlayer::moveCalcDrop () {
+  return maxGame(mCards.mask());
 }
 
 
@@ -1486,33 +1318,24 @@ eGameBid AiPlayer::makeDrop() {
 eGameBid AiPlayer::dropForMisere () {
   qDebug() << "dropForMisere";
   Card *FirstCardOut = 0, *SecondCardOut = 0;
-  Card *tmpFirstCardOut, *tmpSecondCardOut;
   Card *RealFirstCardOut, *RealSecondCardOut;
   eGameBid Hight = g105, tmpHight = g105;
+  int perehvatov = 0, tmpPerehvatov;
+  quint32 hand = mCards.mask();
   for (int f = 0; f < 12; f++) {
-    tmpFirstCardOut = mCards.at(f);
-    mCards.removeAt(f);
-    //for ( int j=0;j<12;j++ )  {
+    CardId first = mCards.idAt(f);
+    if (first == CardNone) continue;
     for (int j = f+1; j < 12; j++) { // patch from Rasskazov K. (kostik450@mail.ru)
-      if (j != f) {
-        tmpSecondCardOut = mCards.at(j);
-        mCards.removeAt(j);
-        /// @todo bad practise
-        AiPlayer *tmpGamer = new AiPlayer(99, m_model);
-        tmpGamer->mCards = mCards;
-        tmpGamer->mCards.mySort();
-        tmpHight = tmpGamer->moveCalcDrop();
-        if ((tmpHight < Hight) ||
-            (tmpHight == Hight && tmpGamer->mSuitProb[0].perehvatov < mSuitProb[0].perehvatov)) {
-          Hight = tmpHight;
-          FirstCardOut = tmpFirstCardOut;
-          SecondCardOut = tmpSecondCardOut;
-        }
-        delete tmpGamer;
-        mCards.putAt(j, tmpSecondCardOut);
+      CardId second = mCards.idAt(j);
+      if (second == CardNone) continue;
+      tmpHight = maxGame(hand & ~(cardIdMask(first) | cardIdMask(second)), &tmpPerehvatov);
+      if (tmpHight < Hight || (tmpHight == Hight && tmpPerehvatov < perehvatov)) {
+        Hight = tmpHight;
+        perehvatov = tmpPerehvatov;
+        FirstCardOut = cardFromId(first);
+        SecondCardOut = cardFromId(second);
       }
     }
-    mCards.putAt(f, tmpFirstCardOut);
   }
   RealFirstCardOut = mCards.maxInSuit(FirstCardOut->suit());
   mCards.remove(RealFirstCardOut);
@@ -1534,34 +1357,26 @@ eGameBid AiPlayer::dropForMisere () {
 //
 eGameBid AiPlayer::dropForGame () {
   Card *FirstCardOut = 0, *SecondCardOut = 0;
-  Card *tmpFirstCardOut, *tmpSecondCardOut;
   Card *RealFirstCardOut, *RealSecondCardOut;
   eGameBid Hight = zerogame, tmpHight = zerogame;
-
+  int perehvatov = 0, tmpPerehvatov;
+  // every pair of cards is tried once; of equal games the one with fewer perehvatov
+  // is kept, then the first pair
+  quint32 hand = mCards.mask();
   for (int f = 0; f < 12; f++) {
-    tmpFirstCardOut = mCards.at(f);
-    mCards.removeAt(f);
-    for (int j = 0; j < 12; j++)  {
-      if (j != f) {
-        tmpSecondCardOut = mCards.at(j);
-        mCards.removeAt(j);
-        /// @todo bad practise
-        AiPlayer *tmpGamer = new AiPlayer(99, m_model);
-        tmpGamer->mCards = mCards;
-        tmpGamer->mCards.mySort();
-        tmpHight = tmpGamer->moveCalcDrop();
-        if ((tmpHight > Hight) ||
-            (tmpHight == Hight && tmpGamer->mSuitProb[0].perehvatov < mSuitProb[0].perehvatov)) {
-          Hight = tmpHight;
-          FirstCardOut = tmpFirstCardOut;
-          SecondCardOut = tmpSecondCardOut;
-        }
-        tmpGamer->mCards.clear();
-        delete tmpGamer;
-        mCards.putAt(j, tmpSecondCardOut);
+    CardId first = mCards.idAt(f);
+    if (first == CardNone) continue;
+    for (int j = f+1; j < 12; j++) {
+      CardId second = mCards.idAt(j);
+      if (second == CardNone) continue;
+      tmpHight = maxGame(hand & ~(cardIdMask(first) | cardIdMask(second)), &tmpPerehvatov);
+      if (tmpHight > Hight || (tmpHight == Hight && tmpPerehvatov < perehvatov)) {
+        Hight = tmpHight;
+        perehvatov = tmpPerehvatov;
+        FirstCardOut = cardFromId(first);
+        SecondCardOut = cardFromId(second);
       }
     }
-    mCards.putAt(f, tmpFirstCardOut);
   }
 
   clearCardArea();
@@ -1597,6 +1412,16 @@ eGameBid AiPlayer::dropForGame () {
 
 
 //ход при торговле
+void AiPlayer::bidFeatures (float *f) {
+  int enemyPool = 0;
+  for (int p = 1; p <= 3; p++) {
+    if (p != mPlayerNo) enemyPool = qMax(enemyPool, m_model->player(p)->mScore.pool());
+  }
+  int position = (mPlayerNo-m_model->nCurrentStart.nValue+3)%3;
+  BidEvaluator::features(mCards.mask(), position, mScore.pool(), enemyPool, m_model->optMaxPool, f);
+}
+
+
 eGameBid AiPlayer::makeBid (eGameBid lMove, eGameBid rMove) {
 //mIStart = (lMove == undefined && rMove == undefined);
 	//qDebug() << mPlayerNo << mIStart;
@@ -1607,9 +1432,6 @@ eGameBid AiPlayer::makeBid (eGameBid lMove, eGameBid rMove) {
 */
   //mMyGame = gtPass;
   if (m_game != gtPass)  {
-    int f;
-    int nMaxMastLen = 0;
-    eSuit nMaxMast = SuitNone;
     tSuitProbs LocalMastTable[5];
 /*
     if (optAggPass && optPassCount > 0) {
@@ -1623,37 +1445,26 @@ eGameBid AiPlayer::makeBid (eGameBid lMove, eGameBid rMove) {
       if (lMove != gtPass && lMove != undefined && lMove < g65) lMove = g65;
       if (rMove != gtPass && rMove != undefined && rMove < g65) rMove = g65;
     }
-    LocalMastTable[0].tricks=0;
-    LocalMastTable[0].perehvatov=0;
-    LocalMastTable[0].sum = 0;
-    for (f = 1; f <= 4; f++)  {
-      LocalMastTable[f] = countGameTricks((eSuit)f, 1);
-      LocalMastTable[0].tricks += LocalMastTable[f].tricks;
-      LocalMastTable[0].perehvatov +=LocalMastTable[f].perehvatov;
-      LocalMastTable[0].sum += LocalMastTable[f].sum;
-    }
+    SuitTables::handProbs(SuitTables::Max, mCards.mask(), LocalMastTable);
     // предполагаемый козырь -- самая длинная масть
-    for (f = 1; f <= 4; f++) {
-      if (mCards.cardsInSuit(f) > nMaxMastLen) {
-        nMaxMastLen = mCards.cardsInSuit(f);
-        nMaxMast = (eSuit)f;
-      }
-    }
-    for (f = 1; f <= 4; f++) {
-      if (mCards.cardsInSuit(f) == nMaxMastLen && nMaxMast != f) {
-        // есть максимально длинные масти
-        if (LocalMastTable[f].sum > LocalMastTable[nMaxMast].sum) nMaxMast = (eSuit)f;
-      }
+    eSuit nMaxMast = longestSuit(LocalMastTable);
+    int tricks = LocalMastTable[0].tricks;
+    const BidEvaluator &eval = BidEvaluator::global();
+    if (eval.isLoaded()) {
+      // learned estimate counts the talon, thresholds below add it themselves
+      float features[BidEvaluator::VectorSize];
+      bidFeatures(features);
+      tricks = qBound(0, qRound(eval.predict(features))-1, 9);
     }
     // масть и взятки уже посчитали
     if (curMaxGame <= g75) {
-      m_game = (eGameBid)((LocalMastTable[0].tricks+1)*10+nMaxMast);
+      m_game = (eGameBid)((tricks+1)*10+nMaxMast);
     } else {
-      m_game = (eGameBid)((LocalMastTable[0].tricks)*10+nMaxMast);
+      m_game = (eGameBid)((tricks)*10+nMaxMast);
     }
 	// if first move or one player passed
     if ((rMove == gtPass || rMove == undefined) && (lMove == gtPass || lMove == undefined)) {
-      if (LocalMastTable[0].tricks >= 4) {
+      if (tricks >= 4) {
         /*if (optAggPass && optPassCount > 0) mMyGame = g71;
         else*/ m_game = g61;
       } else {
@@ -24,13 +24,8 @@
 #define AIPLAYER_H
 
 #include "player.h"
-
-typedef struct {
-  int tricks;
-  int perehvatov;
-  int len;
-  int sum;
-} tSuitProbs;
+#include "cardtracker.h"
+#include "suittables.h"
 
 /**
  * @class AiPlayer aiplayer.h
@@ -48,8 +43,10 @@ public:
   virtual eGameBid makeBid (eGameBid lMove, eGameBid rMove); //ход при торговле
   virtual eGameBid makeFinalBid (eGameBid MaxGame, int nPlayerPass); // после получения игроком прикупа - пасс или вист
   virtual eGameBid makeDrop();
+  virtual void dropCards (quint32 drop);
 
   virtual bool chooseClosedWhist ();
+  virtual void cardPlayed (int who, CardId card);
 
   virtual void clear ();
 
@@ -58,20 +55,17 @@ protected:
   virtual eGameBid dropForGame ();
   virtual eGameBid dropForMisere ();
   eGameBid moveCalcDrop (); //для расчета сноса
+  void bidFeatures (float *f); // BidEvaluator features of my hand before the talon
   tSuitProbs countGameTricks (eSuit, int a23);
   tSuitProbs countTricks (eSuit, CardList &, int a23);
   tSuitProbs countPassTricks (eSuit, CardList &);
   int numTricks(const int suit);
 
-  // Два списка
-  tSuitProbs calcProbsForMax (CardList &my, CardList &enemy); // Для максимального результата на 1 руке
-  tSuitProbs calcProbsForMaxH23 (CardList &my, CardList &enemy); // Для максимального результата на 2 и 3 руке
-  tSuitProbs calcProbsForMin (CardList &my, CardList &enemy); // Для мин результата
-
   void recalcTables (CardList &aMaxCardList, int a23); // Пересчитывает таблицу tSuitProbs mSuitProb[5];
   void recalcPassOutTables (CardList &aMaxCardList, int a23); // Пересчитывает таблицу дли распасов или мизера
 
   void loadLists (Player *aLeftPlayer, Player *aRightPlayer, CardList &aMaxCardList); // Набор списков
+  quint32 handMask (Player *plr) const;
 
   Card *GetMaxCardPere (int s0=0, int s1=0, int s2=0);
   Card *GetMaxCardWithOutPere (int s0=0, int s1=0, int s2=0);
@@ -106,6 +100,7 @@ protected:
   CardList mLeft;  // cards of left player (supposed or open)
   CardList mRight; // cards of right player (supposed or open)
   CardList mOut;   // Сdropped cards (my or supposed)
+  CardTracker mTracker;
 };
 
 
@@ -0,0 +1,158 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#include <string.h>
+
+#include <QFile>
+#include <QList>
+
+#if defined(__AVX__)
+# include <immintrin.h>
+#elif defined(__SSE__)
+# include <xmmintrin.h>
+#endif
+
+#include "bideval.h"
+#include "suittables.h"
+
+
+static const char *sNames[BidEvaluator::Features] = {
+  "bias",
+  "len1", "len2", "len3", "len4",
+  "aces", "kings", "queens",
+  "controls", "voids",
+  "tabletricks", "perehvatov",
+  "firsthand", "secondhand",
+  "poolleft", "poollead"
+};
+
+
+BidEvaluator::BidEvaluator () : mLoaded(false) {
+  memset(mWeights, 0, sizeof(mWeights));
+}
+
+
+const char *BidEvaluator::featureName (int f) {
+  if (f < 0 || f >= Features) return "";
+  return sNames[f];
+}
+
+
+void BidEvaluator::features (quint32 hand, int position, int myPool, int enemyPool, int maxPool, float *f) {
+  memset(f, 0, VectorSize*sizeof(float));
+  f[Bias] = 1.0f;
+
+  int len[4];
+  for (int s = 0; s < 4; s++) {
+    quint8 suit = (hand >> (s*8)) & 0xff;
+    int n = 0;
+    for (quint8 m = suit; m; m &= m-1) n++;
+    len[s] = n;
+    if (suit & 0x80) { f[Aces] += 1.0f; f[Controls] += 2.0f; }
+    if (suit & 0x40) { f[Kings] += 1.0f; f[Controls] += 1.0f; }
+    if (suit & 0x20) f[Queens] += 1.0f;
+    if (!suit) f[Voids] += 1.0f;
+  }
+  // lengths, longest first
+  for (int i = 0; i < 4; i++) {
+    for (int j = i+1; j < 4; j++) if (len[j] > len[i]) qSwap(len[i], len[j]);
+    f[Len1+i] = len[i];
+  }
+
+  tSuitProbs probs[5];
+  SuitTables::handProbs(SuitTables::Max, hand, probs);
+  f[TableTricks] = probs[0].tricks;
+  f[Perehvatov] = probs[0].perehvatov;
+
+  if (position == 0) f[FirstHand] = 1.0f;
+  else if (position == 1) f[SecondHand] = 1.0f;
+  if (maxPool > 0) {
+    f[PoolLeft] = qMax(0, maxPool-myPool)/(float)maxPool;
+    f[PoolLead] = (myPool-enemyPool)/(float)maxPool;
+  }
+}
+
+
+float BidEvaluator::predict (const float *f) const {
+#if defined(__AVX__)
+  __m256 sum = _mm256_setzero_ps();
+  for (int i = 0; i < VectorSize; i += 8)
+    sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(f+i), _mm256_loadu_ps(mWeights+i)));
+  __m128 s4 = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+#elif defined(__SSE__)
+  __m128 s4 = _mm_setzero_ps();
+  for (int i = 0; i < VectorSize; i += 4)
+    s4 = _mm_add_ps(s4, _mm_mul_ps(_mm_loadu_ps(f+i), _mm_loadu_ps(mWeights+i)));
+#endif
+#if defined(__AVX__) || defined(__SSE__)
+  s4 = _mm_add_ps(s4, _mm_movehl_ps(s4, s4));
+  s4 = _mm_add_ss(s4, _mm_shuffle_ps(s4, s4, 1));
+  return _mm_cvtss_f32(s4);
+#else
+  float sum = 0.0f;
+  for (int i = 0; i < Features; i++) sum += f[i]*mWeights[i];
+  return sum;
+#endif
+}
+
+
+bool BidEvaluator::load (const QString &fileName) {
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+  float w[VectorSize];
+  memset(w, 0, sizeof(w));
+  // unknown names are skipped, missing ones weigh nothing
+  while (!file.atEnd()) {
+    QByteArray line = file.readLine().simplified();
+    if (line.isEmpty() || line[0] == '#') continue;
+    QList<QByteArray> parts = line.split(' ');
+    bool ok;
+    float v = parts.size() == 2 ? parts[1].toFloat(&ok) : 0.0f;
+    if (parts.size() != 2 || !ok) return false;
+    for (int f = 0; f < Features; f++) {
+      if (parts[0] == sNames[f]) w[f] = v;
+    }
+  }
+  memcpy(mWeights, w, sizeof(w));
+  mLoaded = true;
+  return true;
+}
+
+
+bool BidEvaluator::save (const QString &fileName) const {
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) return false;
+  QByteArray text("# OpenPref bidding weights: expected declarer's tricks\n");
+  for (int f = 0; f < Features; f++) {
+    text += sNames[f];
+    text += ' ';
+    text += QByteArray::number(mWeights[f], 'g', 7);
+    text += '\n';
+  }
+  return file.write(text) == text.size();
+}
+
+
+BidEvaluator &BidEvaluator::global () {
+  static BidEvaluator evaluator;
+  return evaluator;
+}
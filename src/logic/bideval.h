@@ -0,0 +1,88 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef BIDEVAL_H
+#define BIDEVAL_H
+
+#include <QString>
+
+/**
+ * @class BidEvaluator bideval.h
+ * @brief Linear estimate of declarer's tricks for bidding
+ *
+ * A hand is described by a fixed feature vector (suit lengths, honors,
+ * controls, table trick estimates, bidding position and score situation);
+ * the estimate is its dot product with weights read from a text file,
+ * one "name weight" pair per line. Weights are fitted offline by the
+ * bidtrain tool from deal archives, so bidding can be tuned without
+ * touching AiPlayer::makeBid(). Without a weights file AiPlayer keeps its
+ * own thresholds.
+ */
+class BidEvaluator {
+public:
+  enum Feature {
+    Bias = 0,
+    Len1, Len2, Len3, Len4, // suit lengths, longest first
+    Aces, Kings, Queens,
+    Controls,               // ace is two, king is one
+    Voids,
+    TableTricks,            // SuitTables estimate
+    Perehvatov,
+    FirstHand, SecondHand,  // bidding position (third hand is neither)
+    PoolLeft,               // part of the pool I still have to write
+    PoolLead,               // my pool over the best opponent's, in pools
+    Features
+  };
+  // feature vectors are padded to a whole number of vector registers
+  enum { VectorSize = (Features+7)/8*8 };
+
+  BidEvaluator ();
+
+  /**
+   * Features of card mask @a hand into @a f[VectorSize] (padding is zeroed).
+   * @a position is 0 for the first bidder, pools are in points, @a maxPool
+   * is the pool size
+   */
+  static void features (quint32 hand, int position, int myPool, int enemyPool, int maxPool, float *f);
+  /// Name of feature @a f as used in weights files
+  static const char *featureName (int f);
+
+  bool load (const QString &fileName);
+  bool save (const QString &fileName) const;
+  bool isLoaded () const { return mLoaded; }
+
+  /// Expected tricks of declarer (talon included) for features @a f[VectorSize]
+  float predict (const float *f) const;
+
+  float weight (int f) const { return mWeights[f]; }
+  void setWeight (int f, float w) { mWeights[f] = w; mLoaded = true; }
+
+  /// Weights shared by all AI players; loaded once by the application
+  static BidEvaluator &global ();
+
+private:
+  float mWeights[VectorSize];
+  bool mLoaded;
+};
+
+
+#endif
@@ -0,0 +1,212 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#include <math.h>
+
+#include <QThread>
+#include <QThreadStorage>
+#include <QTime>
+#ifndef QT_NO_CONCURRENT
+# include <QtConcurrentMap>
+#endif
+
+#include "bidsim.h"
+#include "ddsolver.h"
+#include "talonenum.h"
+
+
+// confidence for sequential test (about 97.5% one-sided)
+static const double SeqTestZ = 2.0;
+
+
+/// One sampled layout; hands get declarer's cards after the drop for every strain
+struct BidJob {
+  quint32 hands[3];
+  quint32 cards;      // declarer's hand with the talon
+  quint32 drops[5];   // strain-1
+  quint32 misereDrop;
+  int seat, leader;
+  bool misere;        // solve misere too
+  qint8 tricks[5];
+  qint8 misereTricks;
+  SearchStats stats;
+};
+
+
+static QThreadStorage<DDSolver *> sSolvers;
+
+static void solveJob (BidJob &job) {
+  if (!sSolvers.hasLocalData()) sSolvers.setLocalData(new DDSolver(16));
+  DDSolver &solver = *sSolvers.localData();
+  SearchStats before = solver.stats();
+  for (int strain = 1; strain <= DDNoTrump; strain++) {
+    job.hands[job.seat-1] = job.cards & ~job.drops[strain-1];
+    job.tricks[strain-1] = solver.solve(job.hands, strain, job.leader, job.seat);
+  }
+  job.misereTricks = -1;
+  if (job.misere) {
+    job.hands[job.seat-1] = job.cards & ~job.misereDrop;
+    job.misereTricks = solver.solve(job.hands, DDNoTrump, job.leader, job.seat, true);
+  }
+  job.stats = solver.stats();
+  job.stats -= before;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+BidSimulator::BidSimulator () : mTimeBudget(1000), mHand(0), mSeat(0), mLeader(0), mSeparated(false) {
+}
+
+
+int BidSimulator::value (const Sample &s, eGameBid bid) {
+  if (bid == gtPass) return 0;
+  int price = gamePoolPrice(bid);
+  if (bid == g86) {
+    Q_ASSERT(s.misereTricks >= 0);
+    return s.misereTricks ? -price*s.misereTricks : price;
+  }
+  int need = gameTricks(bid), tricks = s.tricks[bid%10-1];
+  return tricks >= need ? price : -price*(need-tricks);
+}
+
+
+// Deals are made here, so the order of samples doesn't depend on threads
+void BidSimulator::addSamples (int cnt, bool misere, Prng &rng) {
+  int unseen[22], n = 0;
+  for (int c = 0; c < 32; c++) if (!(mHand & (1u << c))) unseen[n++] = c;
+  Q_ASSERT(n == 22);
+  int left = mSeat%3+1, right = left%3+1;
+  QVector<BidJob> jobs(cnt);
+  for (int j = 0; j < cnt; j++) {
+    for (int f = n-1; f > 0; f--) {
+      int k = rng.bounded(f+1), t = unseen[f];
+      unseen[f] = unseen[k];
+      unseen[k] = t;
+    }
+    BidJob &job = jobs[j];
+    quint32 talon = (1u << unseen[0]) | (1u << unseen[1]);
+    job.hands[left-1] = job.hands[right-1] = 0;
+    for (int f = 2; f < 12; f++) job.hands[left-1] |= 1u << unseen[f];
+    for (int f = 12; f < 22; f++) job.hands[right-1] |= 1u << unseen[f];
+    job.cards = mHand | talon;
+    int dropTricks[5];
+    TalonEvaluator::bestDrops(job.cards, job.drops, dropTricks);
+    job.misereDrop = misere ? TalonEvaluator::bestMisereDrop(job.cards, 0) : 0;
+    job.seat = mSeat;
+    job.leader = mLeader;
+    job.misere = misere;
+  }
+#ifndef QT_NO_CONCURRENT
+  QtConcurrent::blockingMap(jobs, solveJob);
+#else
+  for (int f = 0; f < jobs.size(); f++) solveJob(jobs[f]);
+#endif
+  for (int f = 0; f < jobs.size(); f++) {
+    Sample s;
+    for (int strain = 0; strain < 5; strain++) s.tricks[strain] = jobs[f].tricks[strain];
+    s.misereTricks = jobs[f].misereTricks;
+    mSamples << s;
+    mStats += jobs[f].stats;
+  }
+}
+
+
+eGameBid BidSimulator::chooseBid (quint32 hand, int seat, int leader, eGameBid minBid, bool misereAllowed,
+  Prng &rng)
+{
+  // misere is allowed on the first bid only: samples dealt without it are of no use then
+  bool misereMissing = misereAllowed && !mSamples.isEmpty() && mSamples[0].misereTricks < 0;
+  if (hand != mHand || seat != mSeat || leader != mLeader || misereMissing) {
+    mHand = hand;
+    mSeat = seat;
+    mLeader = leader;
+    mSamples.clear();
+  }
+
+  // the bidder holds the auction with any of these; only the best one is tested
+  QVector<eGameBid> games;
+  if (minBid <= g105) {
+    eGameBid bid = minBid;
+    if (bid == g86) bid = (eGameBid)succBid(bid);
+    forever {
+      games << bid;
+      if (bid == g105) break;
+      bid = (eGameBid)succBid(bid);
+    }
+  }
+
+  int batch = qMax((int)BatchSamples, QThread::idealThreadCount()), lastBatch = 0;
+  QTime timer;
+  timer.start();
+  if (mSamples.size() < MinSamples) addSamples(MinSamples-mSamples.size(), misereAllowed, rng);
+  forever {
+    int n = mSamples.size(), cnt = 0, best = 0;
+    eGameBid cands[3];
+    cands[cnt++] = gtPass;
+    if (misereAllowed) cands[cnt++] = g86;
+    if (!games.isEmpty()) {
+      int bestGame = 0;
+      qint64 bestSum = 0;
+      for (int g = 0; g < games.size(); g++) {
+        qint64 sum = 0;
+        for (int f = 0; f < n; f++) sum += value(mSamples[f], games[g]);
+        if (!g || sum > bestSum) {
+          bestGame = g;
+          bestSum = sum;
+        }
+      }
+      cands[cnt++] = games[bestGame];
+    }
+    double mean[3];
+    for (int c = 0; c < cnt; c++) {
+      mean[c] = 0;
+      for (int f = 0; f < n; f++) mean[c] += value(mSamples[f], cands[c]);
+      mean[c] /= n;
+      if (mean[c] > mean[best]) best = c;
+    }
+    int elapsed = timer.elapsed();
+    if (n >= MaxSamples || elapsed+lastBatch > mTimeBudget) {
+      mSeparated = false;
+      return cands[best];
+    }
+
+    // paired test: best candidate should beat every other one
+    bool separated = true;
+    for (int c = 0; c < cnt && separated; c++) {
+      if (c == best) continue;
+      double d = mean[best]-mean[c], var = 0;
+      for (int f = 0; f < n; f++) {
+        double x = value(mSamples[f], cands[best])-value(mSamples[f], cands[c])-d;
+        var += x*x;
+      }
+      var /= (n-1);
+      if (var == 0 && d == 0) continue; // the same outcome for every sample
+      if (d-SeqTestZ*sqrt(var/n) <= 0) separated = false;
+    }
+    if (separated) {
+      mSeparated = true;
+      return cands[best];
+    }
+    addSamples(qMin(batch, MaxSamples-n), misereAllowed, rng);
+    lastBatch = timer.elapsed()-elapsed;
+  }
+}
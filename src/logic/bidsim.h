@@ -0,0 +1,95 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef BIDSIM_H
+#define BIDSIM_H
+
+#include <QVector>
+
+#include "prfconst.h"
+#include "searchstats.h"
+#include "prng.h"
+
+/**
+ * @class BidSimulator bidsim.h
+ * @brief Bidding by simulation of unseen cards
+ *
+ * Deals unseen cards to opponents and talon, solves every sample with
+ * DDSolver and estimates value of each contract in pool points (won game
+ * gives its price, failed one costs price for every undertrick).
+ * Only the outcomes the bidder acts on are compared: pass (zero value),
+ * misere and the best game. Sampling stops as soon as sequential test
+ * separates the best of them from the others or the time budget is spent;
+ * samples are solved in batches on the thread pool.
+ *
+ * Declarer's drop in every sample is chosen by TalonEvaluator.
+ * Samples are kept for the hand, so next bids in the same auction
+ * reuse them.
+ */
+class BidSimulator {
+public:
+  BidSimulator ();
+
+  /**
+   * Returns best bid not less than @a minBid, g86 (if @a misereAllowed)
+   * or gtPass. @a seat and @a leader are player numbers 1..3; new samples
+   * are dealt from @a rng
+   */
+  eGameBid chooseBid (quint32 hand, int seat, int leader, eGameBid minBid, bool misereAllowed,
+    Prng &rng);
+
+  /// Number of samples collected for current hand
+  int samples () const { return mSamples.size(); }
+  /// False if the last chooseBid() ran out of samples or time before the test separated its bid
+  bool separated () const { return mSeparated; }
+  /// Solver counters of all simulations so far
+  const SearchStats &stats () const { return mStats; }
+
+  /// Time for one decision, in milliseconds
+  int timeBudget () const { return mTimeBudget; }
+  void setTimeBudget (int ms) { mTimeBudget = ms; }
+
+  static const int MinSamples = 16;
+  static const int BatchSamples = 8;
+  static const int MaxSamples = 128;
+
+private:
+  struct Sample {
+    qint8 tricks[5]; // strain-1
+    qint8 misereTricks; // -1 if misere wasn't solved
+  };
+
+  void addSamples (int cnt, bool misere, Prng &rng);
+  static int value (const Sample &s, eGameBid bid);
+
+private:
+  SearchStats mStats;
+  int mTimeBudget;
+  quint32 mHand;
+  int mSeat;
+  int mLeader;
+  QVector<Sample> mSamples;
+  bool mSeparated;
+};
+
+
+#endif
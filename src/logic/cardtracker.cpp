@@ -0,0 +1,56 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#include "cardtracker.h"
+
+
+void CardTracker::clear () {
+  mStarted = false;
+  mOut = 0;
+  for (int f = 0; f < 3; f++) {
+    mHands[f] = 0;
+    mLists[f].clear();
+  }
+}
+
+
+void CardTracker::start (const quint32 *hands) {
+  clear();
+  mStarted = true;
+  quint32 all = 0;
+  for (int f = 0; f < 3; f++) {
+    mHands[f] = hands[f];
+    all |= hands[f];
+    for (CardId id = 0; id < 32; id++) if (hands[f] & cardIdMask(id)) mLists[f].insertId(id);
+    mLists[f].mySort();
+  }
+  mOut = ~all;
+}
+
+
+void CardTracker::cardPlayed (int who, CardId card) {
+  if (!mStarted || who < 1 || who > 3 || !isValidCardId(card)) return;
+  quint32 bit = cardIdMask(card);
+  if (mHands[who-1] & bit) mLists[who-1].removeId(card);
+  mHands[who-1] &= ~bit;
+  mOut |= bit;
+}
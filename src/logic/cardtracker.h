@@ -0,0 +1,64 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef CARDTRACKER_H
+#define CARDTRACKER_H
+
+#include "cardid.h"
+#include "cardlist.h"
+
+/**
+ * @class CardTracker cardtracker.h
+ * @brief What is known about cards during play of one deal
+ *
+ * Keeps hands of the three players and cards gone out of hands. Both are
+ * card masks updated once per played card by cardPlayed(), so nothing has
+ * to be read from other players' card lists on the next move.
+ */
+class CardTracker {
+public:
+  CardTracker () { clear(); }
+
+  void clear ();
+  /// Starts tracking from hands of players 1..3 (@a hands[0..2])
+  void start (const quint32 *hands);
+  bool isStarted () const { return mStarted; }
+
+  /// Player @a who (1..3) played @a card
+  void cardPlayed (int who, CardId card);
+
+  /// Cards still in hand of player @a who (1..3)
+  quint32 hand (int who) const { Q_ASSERT(who >= 1 && who <= 3); return mHands[who-1]; }
+  /// The same hand as a list sorted by CardList::mySort(); played cards leave empty slots
+  const CardList &list (int who) const { Q_ASSERT(who >= 1 && who <= 3); return mLists[who-1]; }
+  /// Cards out of hands: played, talon and drop
+  quint32 out () const { return mOut; }
+
+private:
+  bool mStarted;
+  quint32 mHands[3];
+  CardList mLists[3];
+  quint32 mOut;
+};
+
+
+#endif
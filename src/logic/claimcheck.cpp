@@ -0,0 +1,161 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#include "claimcheck.h"
+
+
+static inline int bitCount (quint32 m) {
+#ifdef __GNUC__
+  return __builtin_popcount(m);
+#else
+  int res = 0;
+  while (m) { m &= m-1; res++; }
+  return res;
+#endif
+}
+
+
+static inline int lowBit (quint32 m) {
+#ifdef __GNUC__
+  return __builtin_ctz(m);
+#else
+  int res = 0;
+  while (!(m & 1)) { m >>= 1; res++; }
+  return res;
+#endif
+}
+
+
+static inline int highBit (quint32 m) {
+#ifdef __GNUC__
+  return 31-__builtin_clz(m);
+#else
+  int res = 31;
+  while (!(m & 0x80000000u)) { m <<= 1; res--; }
+  return res;
+#endif
+}
+
+
+static inline quint32 suitMask (int suitNo) {
+  return 0xffu << (suitNo*8);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+ClaimCheck::ClaimCheck (int nodeBudget) : mNodeBudget(nodeBudget), mNodes(0), mNodeLimit(0) {
+}
+
+
+bool ClaimCheck::check (const quint32 hands[3], int strain, int leader, int tricks[3]) {
+  int cnt = bitCount(hands[0]);
+  if (!cnt || bitCount(hands[1]) != cnt || bitCount(hands[2]) != cnt) return false;
+  for (int f = 0; f < 3; f++) {
+    mHands[f] = hands[f];
+    mTaken[f] = 0;
+  }
+  mTrump = (strain >= 1 && strain <= 4) ? strain-1 : -1;
+
+  if (leaderTakesAll(leader-1)) {
+    for (int f = 0; f < 3; f++) tricks[f] = (f == leader-1) ? cnt : 0;
+    return true;
+  }
+  if (cnt > MaxSearchCards) return false;
+
+  mHaveResult = false;
+  mNodeLimit = mNodes+mNodeBudget;
+  if (!searchPlay(leader-1, 0)) return false;
+  for (int f = 0; f < 3; f++) tricks[f] = mResult[f];
+  return true;
+}
+
+
+// Every card of the leader is above the cards others have in its suit and
+// nobody can ruff it, so the leader keeps winning and leading
+bool ClaimCheck::leaderTakesAll (int leader) const {
+  quint32 others = mHands[(leader+1)%3] | mHands[(leader+2)%3];
+  bool othersRuff = mTrump >= 0 && (others & suitMask(mTrump));
+  for (int s = 0; s < 4; s++) {
+    quint32 mine = mHands[leader] & suitMask(s);
+    if (!mine) continue;
+    quint32 theirs = others & suitMask(s);
+    if (theirs && highBit(theirs) > lowBit(mine)) return false;
+    if (s != mTrump && othersRuff) return false;
+  }
+  return true;
+}
+
+
+// Plays out all lines from card @a turn of the trick led by @a leader (0..2);
+// false if two lines end differently or the budget is spent
+bool ClaimCheck::searchPlay (int leader, int turn) {
+  if (++mNodes > mNodeLimit) return false;
+  if (turn == 3) {
+    int w = 0;
+    for (int f = 1; f < 3; f++) {
+      int c = mTable[f], b = mTable[w];
+      if ((c >> 3) == (b >> 3)) {
+        if (c > b) w = f;
+      } else if ((c >> 3) == mTrump) w = f;
+    }
+    w = (leader+w)%3;
+    mTaken[w]++;
+    bool ok = true;
+    if (mHands[0]) {
+      // next tricks use the table, the lines of this one go on after them
+      int table[3] = { mTable[0], mTable[1], mTable[2] };
+      ok = searchPlay(w, 0);
+      for (int f = 0; f < 3; f++) mTable[f] = table[f];
+    }
+    else if (!mHaveResult) {
+      for (int f = 0; f < 3; f++) mResult[f] = mTaken[f];
+      mHaveResult = true;
+    } else {
+      for (int f = 0; f < 3; f++) if (mResult[f] != mTaken[f]) ok = false;
+    }
+    mTaken[w]--;
+    return ok;
+  }
+
+  int plr = (leader+turn)%3;
+  quint32 hand = mHands[plr], moves = hand;
+  if (turn) {
+    quint32 m = hand & suitMask(mTable[0] >> 3);
+    if (!m && mTrump >= 0) m = hand & suitMask(mTrump);
+    if (m) moves = m;
+  }
+  // cards on the table split sequences too
+  quint32 live = mHands[0] | mHands[1] | mHands[2];
+  for (int f = 0; f < turn; f++) live |= 1u << mTable[f];
+  for (; moves; moves &= moves-1) {
+    int c = lowBit(moves);
+    // the next higher live card is ours: both give the same lines
+    quint32 above = live & suitMask(c >> 3) & ~((2u << c)-1);
+    if (above && (hand & above & (0u-above))) continue;
+    mHands[plr] &= ~(1u << c);
+    mTable[turn] = c;
+    bool ok = searchPlay(leader, turn+1);
+    mHands[plr] |= 1u << c;
+    if (!ok) return false;
+  }
+  return true;
+}
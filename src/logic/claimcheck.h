@@ -0,0 +1,75 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef CLAIMCHECK_H
+#define CLAIMCHECK_H
+
+#include <QtGlobal>
+
+/**
+ * @class ClaimCheck claimcheck.h
+ * @brief Finds positions where play can't change the rest of the deal
+ *
+ * Hands are card masks (see cardIdMask()). A position can be claimed when
+ * every legal line of play gives each seat the same number of tricks, no
+ * matter how well or badly the cards are played. A cheap bound goes
+ * first (the leader wins every trick with any card); small endings are
+ * then played out line by line, cards of a sequence in one hand counted
+ * once. A search that spends its node budget doesn't claim.
+ */
+class ClaimCheck {
+public:
+  explicit ClaimCheck (int nodeBudget=DefaultBudget);
+
+  /**
+   * Checks the position where player @a leader (1..3) leads the next trick
+   * in @a strain (trump suit 1..4, anything else is no trumps). Returns
+   * true and puts tricks of players 1..3 in the rest of the deal into
+   * @a tricks if they don't depend on play
+   */
+  bool check (const quint32 hands[3], int strain, int leader, int tricks[3]);
+
+  /// Number of searched nodes since construction
+  quint64 nodes () const { return mNodes; }
+
+  enum { DefaultBudget = 20000, MaxSearchCards = 5 };
+
+private:
+  bool leaderTakesAll (int leader) const;
+  bool searchPlay (int leader, int turn);
+
+private:
+  int mNodeBudget;
+  quint64 mNodes;
+  quint64 mNodeLimit; // of current check()
+
+  // current search
+  quint32 mHands[3];
+  int mTrump; // 0..3 or -1
+  int mTable[3];
+  int mTaken[3];
+  bool mHaveResult;
+  int mResult[3];
+};
+
+
+#endif
@@ -0,0 +1,366 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#include "ddsolver.h"
+
+
+static inline int bitCount (quint32 m) {
+#ifdef __GNUC__
+  return __builtin_popcount(m);
+#else
+  int res = 0;
+  while (m) { m &= m-1; res++; }
+  return res;
+#endif
+}
+
+
+static inline int lowBit (quint32 m) {
+#ifdef __GNUC__
+  return __builtin_ctz(m);
+#else
+  int res = 0;
+  while (!(m & 1)) { m >>= 1; res++; }
+  return res;
+#endif
+}
+
+
+static inline int highBit (quint32 m) {
+#ifdef __GNUC__
+  return 31-__builtin_clz(m);
+#else
+  int res = 31;
+  while (!(m & 0x80000000u)) { m <<= 1; res--; }
+  return res;
+#endif
+}
+
+
+static inline quint32 suitMask (int suitNo) {
+  return 0xffu << (suitNo*8);
+}
+
+
+// trump suit number 0..3 or -1 for no-trump
+static inline int trumpNo (int strain) {
+  return (strain >= 1 && strain <= 4) ? strain-1 : -1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+DDSolver::DDSolver (int ttBits) : mNodes(0), mDepth(0), mGeneration(0) {
+  mTableMask = (1u << ttBits)-1;
+  mTable = new TTEntry[mTableMask+1];
+  mOwner[0] = mOwner[1] = mOwner[2] = 0;
+  clearCache();
+}
+
+
+DDSolver::~DDSolver () {
+  delete [] mTable;
+}
+
+
+void DDSolver::clearCache () {
+  for (quint32 f = 0; f <= mTableMask; f++) {
+    mTable[f].key = 0;
+    mTable[f].generation = 0;
+  }
+  mGeneration = 1;
+  mOwner[0] = mOwner[1] = mOwner[2] = 0;
+}
+
+
+quint32 DDSolver::legalMoves (quint32 hand, const int *table, int tableCnt, int strain) {
+  if (!tableCnt) return hand;
+  quint32 m = hand & suitMask(table[0] >> 3);
+  if (m) return m;
+  int trump = trumpNo(strain);
+  if (trump >= 0) {
+    m = hand & suitMask(trump);
+    if (m) return m;
+  }
+  return hand;
+}
+
+
+int DDSolver::trickWinner (const int *table, int strain, int tableCnt) {
+  int trump = trumpNo(strain);
+  int res = 0;
+  for (int f = 1; f < tableCnt; f++) {
+    int c = table[f], w = table[res];
+    if ((c >> 3) == (w >> 3)) {
+      if (c > w) res = f;
+    } else if ((c >> 3) == trump) res = f;
+  }
+  return res;
+}
+
+
+// Cached positions are valid while every card keeps its owner; new deal starts
+// new generation, so table needn't be cleared between deals.
+void DDSolver::setup (const quint32 hands[3], int strain, int leader, int seat, bool misere) {
+  bool sameDeal = true;
+  for (int f = 0; f < 3; f++) {
+    if (hands[f] & (mOwner[(f+1)%3] | mOwner[(f+2)%3])) sameDeal = false;
+  }
+  if (!sameDeal) {
+    if (++mGeneration == 0) clearCache();
+    mOwner[0] = mOwner[1] = mOwner[2] = 0;
+  }
+  for (int f = 0; f < 3; f++) {
+    mHands[f] = hands[f];
+    mOwner[f] |= hands[f];
+  }
+  mStrain = strain;
+  mLeader = leader-1;
+  mSeat = seat-1;
+  mMisere = misere;
+  mTrickCnt = 0;
+  mDepth = 0;
+}
+
+
+quint64 DDSolver::makeKey () const {
+  quint32 rest = mHands[0] | mHands[1] | mHands[2];
+  int strain = mStrain;
+  // without trumps in hands the game is just the same as no-trump one
+  if (trumpNo(strain) >= 0 && !(rest & suitMask(trumpNo(strain)))) strain = DDNoTrump;
+  quint64 res = rest;
+  res |= (quint64)mLeader << 32;
+  res |= (quint64)strain << 34;
+  res |= (quint64)mSeat << 37;
+  res |= (quint64)(mMisere ? 1 : 0) << 39;
+  return res;
+}
+
+
+// value of trick taken by player @a who for the searching seat
+#define TRICK_VALUE(who) ((mMisere ? (who) != mSeat : (who) == mSeat) ? 1 : 0)
+
+
+int DDSolver::searchTrick (int alpha, int beta) {
+  quint32 rest = mHands[0] | mHands[1] | mHands[2];
+  int left = bitCount(rest)/3;
+  if (!left) return 0;
+  if (left == 1) {
+    // all moves are forced
+    mNodes++;
+    mStats.nodes[qMin(mDepth, (int)SearchStats::MaxDepth-1)]++;
+    int table[3];
+    for (int f = 0; f < 3; f++) table[f] = lowBit(mHands[(mLeader+f)%3]);
+    int who = (mLeader+trickWinner(table, mStrain))%3;
+    return TRICK_VALUE(who);
+  }
+  if (beta <= 0) return 0;
+  if (alpha >= left) return left;
+
+  quint64 key = makeKey();
+  TTEntry *e = &mTable[(quint32)((key*Q_UINT64_C(0x9E3779B97F4A7C15)) >> 40) & mTableMask];
+  int lower = 0, upper = left;
+  mStats.probes++;
+  if (e->generation == mGeneration && e->key == key) {
+    mStats.hits++;
+    lower = e->lower;
+    upper = e->upper;
+    if (lower >= beta) return lower;
+    if (upper <= alpha) return upper;
+    if (lower > alpha) alpha = lower;
+    if (upper < beta) beta = upper;
+  }
+
+  int res = searchPlay(0, alpha, beta);
+
+  if (res <= alpha) upper = res;
+  else if (res >= beta) lower = res;
+  else lower = upper = res;
+  mStats.stores++;
+  e->key = key;
+  e->generation = mGeneration;
+  e->lower = lower;
+  e->upper = upper;
+  return res;
+}
+
+
+int DDSolver::searchPlay (int turn, int alpha, int beta) {
+  mNodes++;
+  mStats.nodes[qMin(mDepth, (int)SearchStats::MaxDepth-1)]++;
+  int plr = (mLeader+turn)%3;
+  quint32 hand = mHands[plr];
+  quint32 moves = legalMoves(hand, mTrick, turn, mStrain);
+  quint32 all = mHands[0] | mHands[1] | mHands[2];
+  for (int f = 0; f < turn; f++) all |= 1u << mTrick[f];
+  // skip cards that are equivalent to the next higher card in the same hand
+  quint32 cands = 0;
+  for (quint32 m = moves; m; m &= m-1) {
+    int c = lowBit(m);
+    quint32 higher = all & suitMask(c >> 3) & ~((2u << c)-1);
+    if (higher && (hand & (1u << lowBit(higher)))) {
+      mStats.equivSkips++;
+      continue;
+    }
+    cands |= 1u << c;
+  }
+  Q_ASSERT(cands);
+
+  bool maximize = (plr == mSeat);
+  // follower tries the lowest card that takes the trick from the enemy first,
+  // then the rest from the lowest one; leader goes from the highest card
+  quint32 first = 0;
+  if (turn) {
+    int w = (mLeader+trickWinner(mTrick, mStrain, turn))%3;
+    if (!mMisere && (w == mSeat) != maximize) {
+      for (quint32 m = cands; m; m &= m-1) {
+        mTrick[turn] = lowBit(m);
+        if (trickWinner(mTrick, mStrain, turn+1) == turn) {
+          first = 1u << mTrick[turn];
+          break;
+        }
+      }
+    }
+  }
+  int best = maximize ? -1 : 99, moveNo = 0;
+  mDepth++;
+  while (cands) {
+    int c;
+    if (first) {
+      c = lowBit(first);
+      first = 0;
+    } else c = turn ? lowBit(cands) : highBit(cands);
+    cands &= ~(1u << c);
+    mHands[plr] &= ~(1u << c);
+    mTrick[turn] = c;
+    int v;
+    if (turn < 2) {
+      v = searchPlay(turn+1, alpha, beta);
+    } else {
+      int who = (mLeader+trickWinner(mTrick, mStrain))%3;
+      int won = TRICK_VALUE(who);
+      int oldLeader = mLeader, t0 = mTrick[0], t1 = mTrick[1];
+      mLeader = who;
+      v = won+searchTrick(alpha-won, beta-won);
+      mLeader = oldLeader;
+      mTrick[0] = t0;
+      mTrick[1] = t1;
+    }
+    mHands[plr] |= 1u << c;
+    if (maximize) {
+      if (v > best) best = v;
+      if (best > alpha) alpha = best;
+    } else {
+      if (v < best) best = v;
+      if (best < beta) beta = best;
+    }
+    if (alpha >= beta) {
+      mStats.cutoffs[qMin(moveNo, (int)SearchStats::MaxMoves-1)]++;
+      break;
+    }
+    moveNo++;
+  }
+  mDepth--;
+  return best;
+}
+
+
+// MTD-like driver: series of zero-window searches from current position
+int DDSolver::search (int tricksLeft) {
+  int lo = 0, hi = tricksLeft;
+  while (lo < hi) {
+    int mid = (lo+hi+1)/2;
+    int v = mTrickCnt ? searchPlay(mTrickCnt, mid-1, mid) : searchTrick(mid-1, mid);
+    if (v >= mid) lo = v; else hi = v;
+  }
+  return lo;
+}
+
+
+int DDSolver::solve (const quint32 hands[3], int strain, int leader, int seat, bool misere) {
+  return solvePosition(hands, strain, leader, 0, 0, seat, misere);
+}
+
+
+int DDSolver::solvePosition (const quint32 hands[3], int strain, int leader,
+  const int *table, int tableCnt, int seat, bool misere)
+{
+  setup(hands, strain, leader, seat, misere);
+  for (int f = 0; f < tableCnt; f++) mTrick[f] = table[f];
+  mTrickCnt = tableCnt;
+  int left = (bitCount(mHands[0] | mHands[1] | mHands[2])+tableCnt)/3;
+  int res = search(left);
+  return misere ? left-res : res;
+}
+
+
+quint32 DDSolver::solveMoves (const quint32 hands[3], int strain, int leader,
+  const int *table, int tableCnt, int seat, bool misere, int *values)
+{
+  setup(hands, strain, leader, seat, misere);
+  for (int f = 0; f < tableCnt; f++) mTrick[f] = table[f];
+  int left = (bitCount(mHands[0] | mHands[1] | mHands[2])+tableCnt)/3;
+  int plr = (mLeader+tableCnt)%3;
+  quint32 moves = legalMoves(mHands[plr], mTrick, tableCnt, mStrain);
+  for (quint32 m = moves; m; m &= m-1) {
+    int c = lowBit(m), v;
+    mHands[plr] &= ~(1u << c);
+    mTrick[tableCnt] = c;
+    if (tableCnt < 2) {
+      mTrickCnt = tableCnt+1;
+      v = search(left);
+    } else {
+      int who = (mLeader+trickWinner(mTrick, mStrain))%3;
+      int oldLeader = mLeader;
+      mLeader = who;
+      mTrickCnt = 0;
+      v = TRICK_VALUE(who)+search(left-1);
+      mLeader = oldLeader;
+      for (int f = 0; f < tableCnt; f++) mTrick[f] = table[f];
+    }
+    mHands[plr] |= 1u << c;
+    values[c] = misere ? left-v : v;
+  }
+  mTrickCnt = tableCnt;
+  return moves;
+}
+
+
+bool DDSolver::misereClean (const quint32 hands[3], int leader, int seat) {
+  setup(hands, DDNoTrump, leader, seat, true);
+  int left = bitCount(mHands[0] | mHands[1] | mHands[2])/3;
+  // single null-window search: can the seat give away every trick?
+  return searchTrick(left-1, left) >= left;
+}
+
+
+void DDSolver::calcTable (const quint32 hands[3], DDTable &res) {
+  // no-trump goes first: suit strains reuse its positions without trumps
+  static const int strains[5] = { DDNoTrump, 1, 2, 3, 4 };
+  for (int s = 0; s < 5; s++) {
+    int strain = strains[s];
+    for (int leader = 1; leader <= 3; leader++) {
+      for (int seat = 1; seat <= 3; seat++) {
+        res.mTricks[strain-1][leader-1][seat-1] = solve(hands, strain, leader, seat);
+      }
+    }
+  }
+}
@@ -0,0 +1,133 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef DDSOLVER_H
+#define DDSOLVER_H
+
+#include <QtGlobal>
+
+#include "searchstats.h"
+
+/// Strain number for no-trump games (same as eGameBid%10 for g65, g75, ...)
+const int DDNoTrump = 5;
+
+/**
+ * @struct DDTable
+ *
+ * Double-dummy trick table: tricks each seat takes in every strain
+ * (suits 1..4 and DDNoTrump) with each possible leader (players 1..3)
+ */
+struct DDTable {
+  qint8 mTricks[5][3][3]; // [strain-1][leader-1][seat-1]
+
+  int tricks (int strain, int leader, int seat) const {
+    return mTricks[strain-1][leader-1][seat-1];
+  }
+};
+
+/**
+ * @class DDSolver ddsolver.h
+ * @brief Double-dummy solver for preferans
+ *
+ * Hands are 32-bit card masks (see cardBitNo()). Every search counts
+ * tricks of one seat playing against the coalition of two others.
+ * In misere mode the seat tries to take as few tricks as possible.
+ *
+ * Solver keeps transposition table between calls, so one object should be
+ * reused for related positions. Different objects are independent and can
+ * be used from different threads.
+ */
+class DDSolver {
+public:
+  explicit DDSolver (int ttBits=18);
+  ~DDSolver ();
+
+  /// Tricks @a seat takes from the start of the deal led by @a leader
+  int solve (const quint32 hands[3], int strain, int leader, int seat, bool misere=false);
+  /**
+   * Tricks @a seat takes from the position where @a tableCnt cards are
+   * already on the table (@a table[0] is the first one, played by @a leader)
+   */
+  int solvePosition (const quint32 hands[3], int strain, int leader,
+    const int *table, int tableCnt, int seat, bool misere=false);
+  /**
+   * Evaluates every legal card of the player to move.
+   * @a values receives tricks of @a seat after each card (indexed by card bit);
+   * returns mask of legal cards.
+   */
+  quint32 solveMoves (const quint32 hands[3], int strain, int leader,
+    const int *table, int tableCnt, int seat, bool misere, int *values);
+
+  /// Returns true if misere player @a seat takes no tricks (faster than solve())
+  bool misereClean (const quint32 hands[3], int leader, int seat);
+
+  /// Fills complete table for all strains and leaders in one batch
+  void calcTable (const quint32 hands[3], DDTable &res);
+
+  /// Drops all cached positions
+  void clearCache ();
+
+  /// Number of searched nodes since construction
+  quint64 nodes () const { return mNodes; }
+  /// Counters of all searches since construction (time isn't counted)
+  const SearchStats &stats () const { return mStats; }
+
+  /// Returns mask of cards player with @a hand can play after @a table
+  static quint32 legalMoves (quint32 hand, const int *table, int tableCnt, int strain);
+  /// Returns index of card that takes the trick (or leads after @a tableCnt cards)
+  static int trickWinner (const int *table, int strain, int tableCnt=3);
+
+private:
+  struct TTEntry {
+    quint64 key;
+    quint32 generation;
+    qint8 lower;
+    qint8 upper;
+  };
+
+  void setup (const quint32 hands[3], int strain, int leader, int seat, bool misere);
+  int search (int target);
+  int searchTrick (int alpha, int beta);
+  int searchPlay (int turn, int alpha, int beta);
+  quint64 makeKey () const;
+
+private:
+  TTEntry *mTable;
+  quint32 mTableMask;
+  quint64 mNodes;
+  SearchStats mStats;
+  int mDepth; // cards played since the root of current search
+  quint32 mGeneration;
+  quint32 mOwner[3]; // cards seen in each hand during current generation
+
+  // current search
+  quint32 mHands[3];
+  int mStrain;
+  int mLeader; // 0..2
+  int mSeat;   // 0..2
+  bool mMisere;
+  int mTrick[3];
+  int mTrickCnt;
+};
+
+
+#endif
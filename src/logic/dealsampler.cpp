@@ -0,0 +1,247 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#include "dealsampler.h"
+
+#include "cardlist.h"
+#include "prng.h"
+
+
+// Uniform number in [0, 1) with 53 random bits
+static inline double uniform (Prng &rng) {
+  double hi = rng.next() >> 5;
+  double lo = rng.next() >> 6;
+  return (hi*67108864.0+lo)/9007199254740992.0;
+}
+
+
+DealSampler::DealSampler () {
+  CardList deck;
+  deck.newDeck();
+  mDeck = deck.mask();
+  clear();
+}
+
+
+void DealSampler::clear () {
+  mKnown = 0;
+  mSlotCnt = 0;
+  for (int f = 0; f < 5; f++) mCount[f].clear();
+}
+
+
+void DealSampler::setKnown (quint32 known) {
+  mKnown = known;
+}
+
+
+int DealSampler::addSlot (int size) {
+  Q_ASSERT(mSlotCnt < MaxSlots);
+  int slot = mSlotCnt++;
+  mSize[slot] = size;
+  mAllow[slot] = ~0u;
+  for (int s = 0; s < 4; s++) {
+    mMinLen[slot][s] = 0;
+    mMaxLen[slot][s] = 8;
+  }
+  return slot;
+}
+
+
+void DealSampler::restrict (int slot, quint32 allow) {
+  Q_ASSERT(slot >= 0 && slot < mSlotCnt);
+  mAllow[slot] &= allow;
+}
+
+
+void DealSampler::setSuitLength (int slot, int suit, int minLen, int maxLen) {
+  Q_ASSERT(slot >= 0 && slot < mSlotCnt && suit >= 1 && suit <= 4);
+  mMinLen[slot][suit-1] = qMax(0, minLen);
+  mMaxLen[slot][suit-1] = qMin(8, maxLen);
+}
+
+
+void DealSampler::prepareSuit (int s) {
+  quint32 cards = unknown() & (0xffu << (s*8));
+  int n = 0;
+  for (int c = s*8; c < s*8+8; c++) if (cards & (1u << c)) mSuitCards[s][n++] = c;
+  mSuitN[s] = n;
+
+  int stride[MaxSlots], codes = 1;
+  for (int sl = 0; sl < mSlotCnt; sl++) {
+    int allowed = 0;
+    for (quint32 m = cards & mAllow[sl]; m; m &= m-1) allowed++;
+    mRadix[s][sl] = qMin(qMin(n, allowed), qMin(mSize[sl], (int)mMaxLen[sl][s]))+1;
+    stride[sl] = codes;
+    codes *= mRadix[s][sl];
+  }
+
+  // ways[i][k]: ways to deal cards i..n-1 so that slot sl gets k[sl] of them
+  QVector<double> &ways = mWays[s];
+  ways.fill(0.0, (n+1)*codes);
+  ways[n*codes] = 1.0;
+  for (int i = n-1; i >= 0; i--) {
+    quint32 card = 1u << mSuitCards[s][i];
+    for (int code = 0; code < codes; code++) {
+      double sum = 0.0;
+      for (int sl = 0, rest = code; sl < mSlotCnt; sl++) {
+        int k = rest%mRadix[s][sl];
+        rest /= mRadix[s][sl];
+        if (k && (mAllow[sl] & card)) sum += ways[(i+1)*codes+code-stride[sl]];
+      }
+      ways[i*codes+code] = sum;
+    }
+  }
+
+  mSplits[s].clear();
+  for (int code = 0; code < codes; code++) {
+    if (ways[code] == 0.0) continue;
+    Split sp;
+    bool ok = true;
+    for (int sl = 0, rest = code; sl < MaxSlots; sl++) {
+      sp.k[sl] = 0;
+      if (sl >= mSlotCnt) continue;
+      sp.k[sl] = rest%mRadix[s][sl];
+      rest /= mRadix[s][sl];
+      if (sp.k[sl] < mMinLen[sl][s]) ok = false;
+    }
+    if (!ok) continue;
+    sp.ways = ways[code];
+    mSplits[s] << sp;
+  }
+}
+
+
+int DealSampler::capCode (const int *cap) const {
+  int res = 0;
+  for (int sl = mSlotCnt-1; sl >= 0; sl--) res = res*(mSize[sl]+1)+cap[sl];
+  return res;
+}
+
+
+bool DealSampler::prepare () {
+  int total = 0, n = 0, codes = 1;
+  for (int sl = 0; sl < mSlotCnt; sl++) {
+    total += mSize[sl];
+    codes *= mSize[sl]+1;
+  }
+  for (quint32 m = unknown(); m; m &= m-1) n++;
+  for (int f = 0; f < 5; f++) mCount[f].clear();
+  if (!mSlotCnt || total != n) return false;
+
+  for (int s = 0; s < 4; s++) prepareSuit(s);
+  // count[s][cap]: ways to deal suits s..3 filling capacities cap exactly
+  mCount[4].fill(0.0, codes);
+  mCount[4][0] = 1.0;
+  for (int s = 3; s >= 0; s--) {
+    QVector<double> &cnt = mCount[s];
+    const QVector<double> &next = mCount[s+1];
+    cnt.fill(0.0, codes);
+    for (int code = 0; code < codes; code++) {
+      int cap[MaxSlots];
+      for (int sl = 0, rest = code; sl < mSlotCnt; sl++) {
+        cap[sl] = rest%(mSize[sl]+1);
+        rest /= mSize[sl]+1;
+      }
+      double sum = 0.0;
+      for (int f = 0; f < mSplits[s].size(); f++) {
+        const Split &sp = mSplits[s][f];
+        int left[MaxSlots], sl;
+        for (sl = 0; sl < mSlotCnt; sl++) {
+          left[sl] = cap[sl]-sp.k[sl];
+          if (left[sl] < 0) break;
+        }
+        if (sl == mSlotCnt) sum += sp.ways*next[capCode(left)];
+      }
+      cnt[code] = sum;
+    }
+  }
+  return layouts() > 0.0;
+}
+
+
+double DealSampler::layouts () const {
+  if (mCount[0].isEmpty()) return 0.0;
+  return mCount[0][capCode(mSize)];
+}
+
+
+void DealSampler::sample (Prng &rng, quint32 *res) const {
+  int cap[MaxSlots];
+  for (int sl = 0; sl < mSlotCnt; sl++) {
+    cap[sl] = mSize[sl];
+    res[sl] = 0;
+  }
+  if (layouts() <= 0.0) {
+    Q_ASSERT(0);
+    return;
+  }
+  for (int s = 0; s < 4; s++) {
+    // split of the suit, by number of layouts it leaves for other suits
+    const QVector<Split> &splits = mSplits[s];
+    const QVector<double> &next = mCount[s+1];
+    double r = uniform(rng)*mCount[s][capCode(cap)];
+    int chosen = -1;
+    for (int f = 0; f < splits.size(); f++) {
+      int left[MaxSlots], sl;
+      for (sl = 0; sl < mSlotCnt; sl++) {
+        left[sl] = cap[sl]-splits[f].k[sl];
+        if (left[sl] < 0) break;
+      }
+      if (sl < mSlotCnt) continue;
+      double w = splits[f].ways*next[capCode(left)];
+      if (w == 0.0) continue;
+      chosen = f;
+      if (r < w) break;
+      r -= w;
+    }
+    Q_ASSERT(chosen >= 0);
+    const Split &sp = splits[chosen];
+
+    // cards of the suit, each by number of ways to deal the rest
+    int n = mSuitN[s], codes = 1, stride[MaxSlots], code = 0;
+    for (int sl = 0; sl < mSlotCnt; sl++) {
+      stride[sl] = codes;
+      code += sp.k[sl]*codes;
+      codes *= mRadix[s][sl];
+      cap[sl] -= sp.k[sl];
+    }
+    const double *ways = mWays[s].constData();
+    for (int i = 0; i < n; i++) {
+      quint32 card = 1u << mSuitCards[s][i];
+      const double *w = ways+(i+1)*codes;
+      double rc = uniform(rng)*ways[i*codes+code];
+      int pick = -1;
+      for (int sl = 0, rest = code; sl < mSlotCnt; sl++) {
+        int k = rest%mRadix[s][sl];
+        rest /= mRadix[s][sl];
+        if (!k || !(mAllow[sl] & card) || w[code-stride[sl]] == 0.0) continue;
+        pick = sl;
+        if (rc < w[code-stride[sl]]) break;
+        rc -= w[code-stride[sl]];
+      }
+      Q_ASSERT(pick >= 0);
+      res[pick] |= card;
+      code -= stride[pick];
+    }
+  }
+}
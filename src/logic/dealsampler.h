@@ -0,0 +1,101 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef DEALSAMPLER_H
+#define DEALSAMPLER_H
+
+#include <QVector>
+
+#include "cardid.h"
+
+class Prng;
+
+/**
+ * @class DealSampler dealsampler.h
+ * @brief Uniform layouts of unseen cards under known constraints
+ *
+ * Cards not known to the player are dealt to slots of given sizes. Slots
+ * follow AiPlayer::loadLists(): left player, right player and the cards
+ * out of play (talon or drop); one more slot may be added. A slot can be
+ * restricted to a card mask (shown voids, cards known to lie elsewhere)
+ * and to a range of lengths in every suit (inferred from bidding).
+ *
+ * Nothing is rejected: prepare() counts the layouts that fit the
+ * constraints suit by suit, and sample() picks split of every suit with
+ * probability proportional to the number of layouts it leaves, so every
+ * fitting layout is equally likely and each sample costs the same.
+ */
+class DealSampler {
+public:
+  enum { Left = 0, Right = 1, Out = 2, MaxSlots = 4 };
+
+  DealSampler ();
+
+  /// Forgets cards and slots
+  void clear ();
+  /// Cards seen by the player (own hand, played cards, open talon); the rest of the deck is dealt
+  void setKnown (quint32 known);
+  /// Adds slot for @a size cards, returns its index
+  int addSlot (int size);
+  /// Slot @a slot gets only cards from @a allow
+  void restrict (int slot, quint32 allow);
+  /// Slot @a slot gets from @a minLen to @a maxLen cards of suit @a suit (1..4)
+  void setSuitLength (int slot, int suit, int minLen, int maxLen);
+
+  /// Builds tables for sample(); returns false if no layout fits
+  bool prepare ();
+  /// Number of fitting layouts (valid after prepare())
+  double layouts () const;
+  /// Deals unseen cards, @a res[slot] gets card mask of every slot
+  void sample (Prng &rng, quint32 *res) const;
+
+  quint32 unknown () const { return mDeck & ~mKnown; }
+  int slotCount () const { return mSlotCnt; }
+
+private:
+  // one way to split a suit among slots
+  struct Split {
+    qint8 k[MaxSlots];
+    double ways;
+  };
+
+  void prepareSuit (int s);
+  int capCode (const int *cap) const;
+
+private:
+  quint32 mDeck;
+  quint32 mKnown;
+  int mSlotCnt;
+  int mSize[MaxSlots];
+  quint32 mAllow[MaxSlots];
+  qint8 mMinLen[MaxSlots][4], mMaxLen[MaxSlots][4];
+  // prepared tables
+  CardId mSuitCards[4][8];
+  int mSuitN[4];
+  int mRadix[4][MaxSlots]; // per suit: possible lengths of slot in suit + 1
+  QVector<double> mWays[4]; // [card index][k code]: ways to deal rest of suit
+  QVector<Split> mSplits[4];
+  QVector<double> mCount[5]; // [cap code]: ways to fill capacities with suits s..3
+};
+
+
+#endif
@@ -5,10 +5,34 @@ HEADERS += \
   $$PWD/player.h \
   $$PWD/aiplayer.h \
   $$PWD/human.h \
-  $$PWD/aialphabeta.h
+  $$PWD/aialphabeta.h \
+  $$PWD/ddsolver.h \
+  $$PWD/abcsearch.h \
+  $$PWD/claimcheck.h \
+  $$PWD/bidsim.h \
+  $$PWD/talonenum.h \
+  $$PWD/whistsim.h \
+  $$PWD/miseredrop.h \
+  $$PWD/dealsampler.h \
+  $$PWD/cardtracker.h \
+  $$PWD/suittables.h \
+  $$PWD/bideval.h \
+  $$PWD/searchstats.h
 
 SOURCES += \
   $$PWD/player.cpp \
   $$PWD/human.cpp \
   $$PWD/aiplayer.cpp \
-  $$PWD/aialphabeta.cpp
+  $$PWD/aialphabeta.cpp \
+  $$PWD/ddsolver.cpp \
+  $$PWD/abcsearch.cpp \
+  $$PWD/claimcheck.cpp \
+  $$PWD/bidsim.cpp \
+  $$PWD/talonenum.cpp \
+  $$PWD/whistsim.cpp \
+  $$PWD/miseredrop.cpp \
+  $$PWD/dealsampler.cpp \
+  $$PWD/cardtracker.cpp \
+  $$PWD/suittables.cpp \
+  $$PWD/bideval.cpp \
+  $$PWD/searchstats.cpp
@@ -0,0 +1,150 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#include "miseredrop.h"
+
+#include <QThreadStorage>
+#include <QTime>
+#include <QVector>
+#include <QtAlgorithms>
+#ifndef QT_NO_CONCURRENT
+# include <QtConcurrentMap>
+#endif
+
+#include "ddsolver.h"
+#include "talonenum.h"
+
+
+struct DropCandidate {
+  quint32 drop;
+  int caught;
+  int estimate; // TalonEvaluator::estimateMisere()
+  int ranks;    // sum of dropped ranks
+
+  bool operator < (const DropCandidate &c) const {
+    if (caught != c.caught) return caught < c.caught;
+    if (estimate != c.estimate) return estimate < c.estimate;
+    return ranks > c.ranks;
+  }
+};
+
+
+// checks one candidate on layouts [from, to)
+struct DropCheck {
+  quint32 hand;
+  const quint32 *layouts; // pairs of defender hands
+  int from, to;
+  int seat, leader;
+  int caught;
+};
+
+
+static QThreadStorage<DDSolver *> sSolvers;
+
+static void runCheck (DropCheck &check) {
+  if (!sSolvers.hasLocalData()) sSolvers.setLocalData(new DDSolver(16));
+  DDSolver *solver = sSolvers.localData();
+  int left = check.seat%3, right = (check.seat+1)%3;
+  check.caught = 0;
+  for (int f = check.from; f < check.to; f++) {
+    quint32 hands[3];
+    hands[check.seat-1] = check.hand;
+    hands[left] = check.layouts[f*2];
+    hands[right] = check.layouts[f*2+1];
+    if (!solver->misereClean(hands, check.leader, check.seat)) check.caught++;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+MisereDropSearch::MisereDropSearch () : mTimeBudget(1500), mCatchRate(0) {
+}
+
+
+quint32 MisereDropSearch::bestDrop (quint32 cards, int seat, int leader, Prng &rng) {
+  int bits[12], cnt = 0, t;
+  for (int c = 0; c < 32; c++) if (cards & (1u << c)) bits[cnt++] = c;
+  Q_ASSERT(cnt == 12);
+  TalonEvaluator::bestMisereDrop(cards, &t); // makes tables ready
+
+  QVector<DropCandidate> cands;
+  for (int f = 0; f < cnt; f++) {
+    for (int j = f+1; j < cnt; j++) {
+      DropCandidate c;
+      c.drop = (1u << bits[f]) | (1u << bits[j]);
+      c.caught = 0;
+      c.estimate = TalonEvaluator::estimateMisere(cards & ~c.drop, c.drop);
+      c.ranks = (bits[f] & 7)+(bits[j] & 7);
+      cands << c;
+    }
+  }
+
+  // the same layouts for every candidate, so they are compared fairly
+  QVector<quint32> layouts(MaxLayouts*2);
+  int unseen[20], n = 0;
+  for (int c = 0; c < 32; c++) if (!(cards & (1u << c))) unseen[n++] = c;
+  Q_ASSERT(n == 20);
+  for (int l = 0; l < MaxLayouts; l++) {
+    for (int f = n-1; f > 0; f--) {
+      int k = rng.bounded(f+1), x = unseen[f];
+      unseen[f] = unseen[k];
+      unseen[k] = x;
+    }
+    layouts[l*2] = layouts[l*2+1] = 0;
+    for (int f = 0; f < 20; f++) layouts[l*2+f/10] |= 1u << unseen[f];
+  }
+
+  QTime timer;
+  timer.start();
+  int done = 0, step = FirstLayouts, lastRound = 0;
+  while (done < MaxLayouts) {
+    int started = timer.elapsed(), to = qMin(done+step, MaxLayouts);
+    QVector<DropCheck> checks(cands.size());
+    for (int f = 0; f < cands.size(); f++) {
+      DropCheck &c = checks[f];
+      c.hand = cards & ~cands[f].drop;
+      c.layouts = layouts.constData();
+      c.from = done;
+      c.to = to;
+      c.seat = seat;
+      c.leader = leader;
+    }
+#ifndef QT_NO_CONCURRENT
+    QtConcurrent::blockingMap(checks, runCheck);
+#else
+    for (int f = 0; f < checks.size(); f++) runCheck(checks[f]);
+#endif
+    for (int f = 0; f < cands.size(); f++) cands[f].caught += checks[f].caught;
+    done = to;
+    qSort(cands.begin(), cands.end());
+    // next round costs about the same: twice the layouts for half the candidates
+    lastRound = timer.elapsed()-started;
+    if (cands.size() == 1 || timer.elapsed()+lastRound > mTimeBudget) break;
+    // keep the better half and everything that ties with its last one
+    int keep = (cands.size()+1)/2;
+    while (keep < cands.size() && cands[keep].caught == cands[keep-1].caught) keep++;
+    cands.resize(keep);
+    step = done;
+  }
+  mCatchRate = (double)cands[0].caught/done;
+  return cands[0].drop;
+}
@@ -0,0 +1,66 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef MISEREDROP_H
+#define MISEREDROP_H
+
+#include <QtGlobal>
+
+#include "prng.h"
+
+/**
+ * @class MisereDropSearch miseredrop.h
+ * @brief Misere drop by search
+ *
+ * Every one of 66 discards is checked against the same sampled defender
+ * layouts with DDSolver::misereClean(). Candidates go in rounds with
+ * doubling number of layouts; the worse half is dropped after each round
+ * (successive halving), so most of the time goes to close candidates.
+ * Checks are spread over the thread pool; the search stops when the time
+ * budget is spent or layouts are exhausted.
+ */
+class MisereDropSearch {
+public:
+  MisereDropSearch ();
+
+  /**
+   * Returns mask of two cards to drop from 12 @a cards of player @a seat;
+   * @a leader makes the first move; layouts are dealt from @a rng
+   */
+  quint32 bestDrop (quint32 cards, int seat, int leader, Prng &rng);
+
+  /// Share of layouts where the chosen drop was caught
+  double catchRate () const { return mCatchRate; }
+
+  int timeBudget () const { return mTimeBudget; }
+  void setTimeBudget (int ms) { mTimeBudget = ms; }
+
+  static const int FirstLayouts = 4;
+  static const int MaxLayouts = 256;
+
+private:
+  int mTimeBudget;
+  double mCatchRate;
+};
+
+
+#endif
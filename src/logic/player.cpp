@@ -30,7 +30,7 @@
 #define NEW_SUIT_OFFSET     ((mDeskView->CardWidth)+8)
 #define CLOSED_CARD_OFFSET  ((mDeskView->CardWidth)*0.55)
 
-Player::Player (int number, PrefModel *model) : mDeskView(model->view()), m_model(model),
+Player::Player (int number, PrefModel *model) : mDeskView(model->hasView() ? model->view() : 0), m_model(model),
                         mIStart(false), mPlayerNo(number), mScore(model) {
   internalInit();
 }
@@ -65,7 +65,7 @@ void Player::clear () {
 
 inline bool Player::invisibleHand () const {
   /// @todo should be dispatched by model
-  return mDeskView->optDebugHands ? false : mInvisibleHand;
+  return (mDeskView && mDeskView->optDebugHands) ? false : mInvisibleHand;
 }
 
 
@@ -84,6 +84,12 @@ void Player::returnDrop () {
   mCardsOut.clear();
 }
 
+
+void Player::dropCards (quint32 drop) {
+  for (CardId id = 0; id < 32; id++) if (drop & cardIdMask(id)) mCards.removeId(id);
+  mCards.clearNulls();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // build array with cards offsets and indicies
 // at least 28 ints (14 int pairs); return # of used ints; the last int is -1
@@ -157,7 +163,7 @@ void Player::drawAt (int left, int top, int selNo) {
 
 void Player::draw () {
   int left, top;
-  Q_ASSERT(mDeskView);
+  if (!mDeskView) return;
   mDeskView->getLeftTop(mPlayerNo, left, top);
   drawAt(left, top, mPrevHiCardIdx);
   mDeskView->drawPlayerMessage(mPlayerNo, mMessage, mPlayerNo!=m_model->mPlayerHi);
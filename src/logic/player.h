@@ -69,10 +69,17 @@ public:
   virtual eGameBid makeFinalBid (eGameBid MaxGame, int nPlayerPass) = 0; // после получения игроком прикупа -- пасс или вист
   virtual eGameBid makeDrop() = 0;
   virtual void returnDrop (); // вернуть сброс
+  /// Drops the cards of mask @a drop as makeDrop() would, for a deal replayed from a saved game
+  virtual void dropCards (quint32 drop);
 
   /// Player's decision on open or closed whist
   virtual bool chooseClosedWhist () = 0;
 
+  /**
+   * Called for every player after player @a who played @a card
+   */
+  virtual void cardPlayed (int who, CardId card) { Q_UNUSED(who) Q_UNUSED(card) }
+
   /// @todo Move to view delegate
   virtual void draw ();
   virtual void highlightCard (int lx, int ly); // подсветить карту по данным координатам (и перерисовать руку, если надо)
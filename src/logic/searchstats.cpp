@@ -0,0 +1,150 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#include <string.h>
+
+#include "searchstats.h"
+
+
+void SearchStats::clear () {
+  memset(this, 0, sizeof(*this));
+}
+
+
+quint64 SearchStats::totalNodes () const {
+  quint64 res = 0;
+  for (int f = 0; f < MaxDepth; f++) res += nodes[f];
+  return res;
+}
+
+
+quint64 SearchStats::totalCutoffs () const {
+  quint64 res = 0;
+  for (int f = 0; f < MaxMoves; f++) res += cutoffs[f];
+  return res;
+}
+
+
+SearchStats &SearchStats::operator += (const SearchStats &s) {
+  for (int f = 0; f < MaxDepth; f++) nodes[f] += s.nodes[f];
+  for (int f = 0; f < MaxMoves; f++) cutoffs[f] += s.cutoffs[f];
+  probes += s.probes;
+  hits += s.hits;
+  stores += s.stores;
+  equivSkips += s.equivSkips;
+  msec += s.msec;
+  return *this;
+}
+
+
+SearchStats &SearchStats::operator -= (const SearchStats &s) {
+  for (int f = 0; f < MaxDepth; f++) nodes[f] -= s.nodes[f];
+  for (int f = 0; f < MaxMoves; f++) cutoffs[f] -= s.cutoffs[f];
+  probes -= s.probes;
+  hits -= s.hits;
+  stores -= s.stores;
+  equivSkips -= s.equivSkips;
+  msec -= s.msec;
+  return *this;
+}
+
+
+// array without trailing zeros
+static QByteArray jsonArray (const quint64 *vals, int cnt) {
+  while (cnt > 0 && !vals[cnt-1]) cnt--;
+  QByteArray res("[");
+  for (int f = 0; f < cnt; f++) {
+    if (f) res += ',';
+    res += QByteArray::number(vals[f]);
+  }
+  return res+']';
+}
+
+
+QByteArray SearchStats::toJson () const {
+  QByteArray res;
+  res += "\"ms\":"+QByteArray::number(msec);
+  res += ",\"nodes\":"+QByteArray::number(totalNodes());
+  res += ",\"depthNodes\":"+jsonArray(nodes, MaxDepth);
+  res += ",\"cutoffs\":"+jsonArray(cutoffs, MaxMoves);
+  res += ",\"probes\":"+QByteArray::number(probes);
+  res += ",\"hits\":"+QByteArray::number(hits);
+  res += ",\"stores\":"+QByteArray::number(stores);
+  res += ",\"equivSkips\":"+QByteArray::number(equivSkips);
+  return res;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+SearchStatsLog::SearchStatsLog () : mDealNo(0), mDecisions(0) {
+}
+
+
+SearchStatsLog &SearchStatsLog::instance () {
+  static SearchStatsLog log;
+  return log;
+}
+
+
+bool SearchStatsLog::open (const QString &fileName) {
+  close();
+  mFile.setFileName(fileName);
+  return mFile.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+
+void SearchStatsLog::close () {
+  if (mFile.isOpen()) mFile.close();
+}
+
+
+void SearchStatsLog::startDeal (int dealNo) {
+  mDealNo = dealNo;
+  mDecisions = 0;
+  mDeal.clear();
+}
+
+
+void SearchStatsLog::endDeal () {
+  if (mDecisions) {
+    writeLine("{\"type\":\"deal\",\"deal\":"+QByteArray::number(mDealNo)+
+      ",\"decisions\":"+QByteArray::number(mDecisions)+','+mDeal.toJson()+'}');
+  }
+  mDecisions = 0;
+  mDeal.clear();
+}
+
+
+void SearchStatsLog::decision (int player, const char *what, const SearchStats &stats) {
+  mLast = stats;
+  mDeal += stats;
+  mDecisions++;
+  writeLine("{\"type\":\"decision\",\"deal\":"+QByteArray::number(mDealNo)+
+    ",\"player\":"+QByteArray::number(player)+",\"what\":\""+what+"\","+stats.toJson()+'}');
+}
+
+
+void SearchStatsLog::writeLine (const QByteArray &line) {
+  if (!mFile.isOpen()) return;
+  mFile.write(line+'\n');
+  mFile.flush();
+}
@@ -0,0 +1,101 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef SEARCHSTATS_H
+#define SEARCHSTATS_H
+
+#include <QByteArray>
+#include <QFile>
+
+/**
+ * @struct SearchStats
+ *
+ * Counters of one search or of several of them. Depth is the number of
+ * cards played since the root; move index is the number of the move in
+ * its node (0 is the first one tried).
+ */
+struct SearchStats {
+  enum { MaxDepth = 32, MaxMoves = 10 };
+
+  SearchStats () { clear(); }
+  void clear ();
+
+  quint64 totalNodes () const;
+  quint64 totalCutoffs () const;
+
+  SearchStats &operator += (const SearchStats &s);
+  SearchStats &operator -= (const SearchStats &s);
+
+  /// Fields as JSON object members, without braces
+  QByteArray toJson () const;
+
+  quint64 nodes[MaxDepth];   // nodes at every depth
+  quint64 cutoffs[MaxMoves]; // cutoffs by index of the move that caused them
+  quint64 probes;            // transposition table lookups
+  quint64 hits;
+  quint64 stores;
+  quint64 equivSkips;        // moves not searched as equal to a searched one
+  quint64 msec;              // elapsed time
+};
+
+/**
+ * @class SearchStatsLog searchstats.h
+ * @brief Search statistics of AI decisions
+ *
+ * Players report every searched decision; the log keeps the last one
+ * and the sum over the current deal and, if a file is open, writes one
+ * JSON line per decision and one per deal. Decisions are made in the
+ * game thread only, so there is no locking.
+ */
+class SearchStatsLog {
+public:
+  static SearchStatsLog &instance ();
+
+  /// Starts writing to @a fileName (appends to existing one)
+  bool open (const QString &fileName);
+  void close ();
+  bool isOpen () const { return mFile.isOpen(); }
+
+  void startDeal (int dealNo);
+  /// Writes the sum over the deal and clears it
+  void endDeal ();
+  /// Decision @a what ("move", "bid", ...) of player @a player
+  void decision (int player, const char *what, const SearchStats &stats);
+
+  const SearchStats &lastDecision () const { return mLast; }
+  const SearchStats &dealStats () const { return mDeal; }
+  int dealDecisions () const { return mDecisions; }
+
+private:
+  SearchStatsLog ();
+  void writeLine (const QByteArray &line);
+
+private:
+  QFile mFile;
+  int mDealNo;
+  int mDecisions;
+  SearchStats mLast;
+  SearchStats mDeal;
+};
+
+
+#endif
@@ -0,0 +1,184 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#include "suittables.h"
+
+
+bool SuitTables::sReady = false;
+quint16 SuitTables::sPow3[256];
+quint8 SuitTables::sLen[256];
+quint8 SuitTables::sSum[256];
+SuitTables::Entry SuitTables::sTable[SuitTables::Modes][6561];
+
+
+static inline int lowBit (quint32 m) {
+  int res = 0;
+  while (!(m & 1)) { m >>= 1; res++; }
+  return res;
+}
+
+
+static inline int topBit (quint32 m) {
+  int res = 7;
+  while (!(m & 0x80)) { m <<= 1; res--; }
+  return res;
+}
+
+
+static inline int bitCount (quint32 m) {
+  int res = 0;
+  for (; m; m &= m-1) res++;
+  return res;
+}
+
+
+// lowest card of @a m not lower than @a c, -1 if none
+static inline int greaterIn (quint32 m, int c) {
+  m &= ~((1u << c)-1);
+  return m ? lowBit(m) : -1;
+}
+
+
+// highest card of @a m not higher than @a c, -1 if none
+static inline int lesserIn (quint32 m, int c) {
+  m &= (2u << c)-1;
+  return m ? topBit(m) : -1;
+}
+
+
+void SuitTables::init () {
+  if (sReady) return;
+  for (int m = 0; m < 256; m++) {
+    int p3 = 0, pw = 1, sum = 0;
+    for (int c = 0; c < 8; c++, pw *= 3) {
+      if (m & (1 << c)) {
+        p3 += pw;
+        sum += c+7;
+      }
+    }
+    sPow3[m] = p3;
+    sLen[m] = bitCount(m);
+    sSum[m] = sum;
+  }
+  for (int my = 0; my < 256; my++) {
+    for (int enemy = 0; enemy < 256; enemy++) {
+      if (my & enemy) continue;
+      for (int mode = 0; mode < Modes; mode++)
+        sTable[mode][index(my, enemy)] = calc((Mode)mode, my, enemy);
+    }
+  }
+  sReady = true;
+}
+
+
+tSuitProbs SuitTables::probs (Mode mode, quint8 my, quint8 enemy) {
+  Q_ASSERT(sReady);
+  enemy &= ~my;
+  const Entry &e = sTable[mode][index(my, enemy)];
+  tSuitProbs res;
+  res.tricks = e.tricks;
+  res.perehvatov = e.perehvatov;
+  res.len = sLen[my];
+  res.sum = sSum[my];
+  return res;
+}
+
+
+tSuitProbs SuitTables::gameProbs (Mode mode, quint8 my) {
+  quint8 enemy = ~my;
+  if (sLen[my] >= 4 && sLen[my] <= 5) enemy &= enemy-1;
+  return probs(mode, my, enemy);
+}
+
+
+void SuitTables::handProbs (Mode mode, quint32 hand, tSuitProbs *res) {
+  res[0].tricks = res[0].perehvatov = res[0].len = res[0].sum = 0;
+  for (int f = 1; f <= 4; f++, hand >>= 8) {
+    res[f] = gameProbs(mode, hand & 0xff);
+    res[0].tricks += res[f].tricks;
+    res[0].perehvatov += res[f].perehvatov;
+    res[0].len += res[f].len;
+    res[0].sum += res[f].sum;
+  }
+}
+
+
+// The card by card play AiPlayer used to run on card lists
+SuitTables::Entry SuitTables::calc (Mode mode, quint8 my, quint8 enemy) {
+  Entry res;
+  res.tricks = res.perehvatov = 0;
+  quint32 m = my, e = enemy;
+  int nMaxLen = qMax(bitCount(m), bitCount(e)), nIget = 1;
+  for (int f = 1; f <= nMaxLen; f++) {
+    if (mode == Max) {
+      // my highest card against his lowest higher one (or his lowest)
+      if (!m) break;
+      if (!e) {
+        res.tricks += bitCount(m);
+        break;
+      }
+      int myMax = topBit(m), enemyMax = greaterIn(e, myMax);
+      if (enemyMax < 0) enemyMax = lowBit(e);
+      m &= ~(1u << myMax);
+      if (myMax > enemyMax) {
+        e &= ~(1u << lowBit(e));
+        res.tricks++;
+        if (!nIget) res.perehvatov++;
+        nIget = 1;
+      } else {
+        e &= ~(1u << enemyMax);
+        nIget = 0;
+      }
+    } else if (mode == MaxH23) {
+      // his highest card against my lowest higher one (or my lowest)
+      if (!e) {
+        res.tricks += bitCount(m);
+        break;
+      }
+      int enemyMax = topBit(e), myMax = greaterIn(m, enemyMax);
+      if (myMax < 0) {
+        if (!m) break;
+        m &= ~(1u << lowBit(m));
+        nIget = 0;
+      } else {
+        m &= ~(1u << myMax);
+        res.tricks++;
+        if (!nIget) res.perehvatov++;
+        nIget = 1;
+      }
+      e &= ~(1u << enemyMax);
+    } else {
+      // my lowest card under his highest lower one (or his lowest)
+      if (!m || !e) break;
+      int myMin = lowBit(m), enemyMin = lesserIn(e, myMin);
+      if (enemyMin < 0) enemyMin = lowBit(e);
+      m &= ~(1u << myMin);
+      if (myMin > enemyMin) {
+        e &= ~(1u << enemyMin);
+        res.tricks++;
+      } else {
+        e &= ~(1u << topBit(e));
+      }
+    }
+  }
+  return res;
+}
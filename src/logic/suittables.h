@@ -0,0 +1,87 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef SUITTABLES_H
+#define SUITTABLES_H
+
+#include <QtGlobal>
+
+typedef struct {
+  int tricks;
+  int perehvatov;
+  int len;
+  int sum;
+} tSuitProbs;
+
+/**
+ * @class SuitTables suittables.h
+ * @brief AiPlayer trick estimates for every holding of one suit
+ *
+ * Holdings are 8-bit masks of faces (bit 0 is the seven, bit 7 the ace),
+ * as in one byte of a card mask. Every pair of my and enemy holdings is
+ * evaluated once by init(); a pair is stored at a base-3 index (each face
+ * is mine, enemy's or nobody's), so each table takes 6561 entries and a
+ * lookup is two table reads.
+ */
+class SuitTables {
+public:
+  enum Mode {
+    Max = 0, // taking tricks, I lead
+    MaxH23,  // taking tricks, I play second or third
+    Min,     // avoiding tricks (pass-out, misere)
+    Modes
+  };
+
+  /// Fills the tables; cheap, does the work only on first call
+  static void init ();
+
+  /// Estimate for my holding @a my against @a enemy
+  static tSuitProbs probs (Mode mode, quint8 my, quint8 enemy);
+  /**
+   * Estimate for my holding @a my against all other cards of the suit
+   * (without the lowest of them if I hold 4 or 5 cards)
+   */
+  static tSuitProbs gameProbs (Mode mode, quint8 my);
+  /**
+   * gameProbs() of all four suits of card mask @a hand at once into
+   * @a res[1..4]; @a res[0] gets sums of tricks, perehvatov and sums
+   */
+  static void handProbs (Mode mode, quint32 hand, tSuitProbs *res);
+
+private:
+  struct Entry {
+    quint8 tricks;
+    quint8 perehvatov;
+  };
+
+  static Entry calc (Mode mode, quint8 my, quint8 enemy);
+  static int index (quint8 my, quint8 enemy) { return sPow3[my]+2*sPow3[enemy]; }
+
+  static bool sReady;
+  static quint16 sPow3[256]; // sum of 3^face over faces of a holding
+  static quint8 sLen[256];
+  static quint8 sSum[256];
+  static Entry sTable[Modes][6561];
+};
+
+
+#endif
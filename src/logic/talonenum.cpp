@@ -0,0 +1,314 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#include <string.h>
+
+#include "talonenum.h"
+
+#include <QVector>
+#ifndef QT_NO_CONCURRENT
+# include <QtConcurrentMap>
+#endif
+
+#include "ddsolver.h"
+
+
+// per-suit tables indexed by [my cards][enemy cards] (8-bit suit masks)
+static qint8 sLongTricks[256][256]; // no-trump or trump suit
+static qint8 sSideTricks[256][256]; // side suit in trump game
+static qint8 sMisereTricks[256][256];
+static bool sTablesReady = false;
+
+
+static inline int bitCount (quint32 m) {
+  int res = 0;
+  for (; m; m &= m-1) res++;
+  return res;
+}
+
+
+static inline int highBit (quint32 m) {
+  int res = 31;
+  while (!(m & 0x80000000u)) { m <<= 1; res--; }
+  return res;
+}
+
+
+// Declarer plays the suit from the top; enemies follow with the lowest cards.
+// In side suit tricks stop when one of enemies has no more cards (ruff).
+static int suitTricks (quint32 mine, quint32 enemy, bool side) {
+  int res = 0;
+  while (mine) {
+    int hi = highBit(mine);
+    if (!enemy || hi > highBit(enemy)) {
+      if (side && bitCount(enemy) < 2) break;
+      res++;
+      mine &= ~(1u << hi);
+      // both enemies follow with the lowest cards
+      if (enemy) enemy &= enemy-1;
+      if (enemy) enemy &= enemy-1;
+    } else {
+      enemy &= ~(1u << highBit(enemy));
+      mine &= mine-1;
+      if (enemy) enemy &= enemy-1;
+    }
+  }
+  return res;
+}
+
+
+// Enemies lead their lowest card; misere player goes under it with the
+// highest possible card or takes the trick with the highest one
+static int suitMisereTricks (quint32 mine, quint32 enemy) {
+  int res = 0;
+  while (mine && enemy) {
+    quint32 low = enemy & ~(enemy-1);
+    quint32 under = mine & (low-1);
+    if (under) mine &= ~(1u << highBit(under));
+    else {
+      res++;
+      mine &= ~(1u << highBit(mine));
+    }
+    enemy &= enemy-1;
+    if (enemy) enemy &= enemy-1;
+  }
+  return res;
+}
+
+
+void TalonEvaluator::initTables () {
+  if (sTablesReady) return;
+  for (int m = 0; m < 256; m++) {
+    for (int e = 0; e < 256; e++) {
+      if (m & e) continue;
+      sLongTricks[m][e] = suitTricks(m, e, false);
+      sSideTricks[m][e] = suitTricks(m, e, true);
+      sMisereTricks[m][e] = suitMisereTricks(m, e);
+    }
+  }
+  sTablesReady = true;
+}
+
+
+int TalonEvaluator::estimateTricks (quint32 hand, quint32 out, int strain) {
+  quint32 enemy = ~(hand | out);
+  int res = 0;
+  for (int s = 0; s < 4; s++) {
+    int m = (hand >> (s*8)) & 0xff, e = (enemy >> (s*8)) & 0xff;
+    res += (strain == DDNoTrump || strain == s+1) ? sLongTricks[m][e] : sSideTricks[m][e];
+  }
+  return qMin(res, 10);
+}
+
+
+// Tricks of @a hand for the five strains, a byte each (strains 1..4, no-trump
+// last): a suit gives long tricks when it is trumps and in no-trump, side
+// tricks otherwise. Sums never exceed a byte, so suits are added as words.
+static inline quint64 strainTricks (quint32 hand, quint32 out) {
+  quint32 enemy = ~(hand | out);
+  quint64 res = 0;
+  for (int s = 0; s < 4; s++) {
+    int m = (hand >> (s*8)) & 0xff, e = (enemy >> (s*8)) & 0xff;
+    quint64 side = sSideTricks[m][e], lng = sLongTricks[m][e];
+    res += side*Q_UINT64_C(0x01010101)+((lng-side) << (s*8))+(lng << 32);
+  }
+  return res;
+}
+
+
+int TalonEvaluator::estimateMisere (quint32 hand, quint32 out) {
+  quint32 enemy = ~(hand | out);
+  int res = 0;
+  for (int s = 0; s < 4; s++) res += sMisereTricks[(hand >> (s*8)) & 0xff][(enemy >> (s*8)) & 0xff];
+  return res;
+}
+
+
+// Tries all 66 drops; ties are broken by rank sum of dropped cards
+// (lower cards go first in game, higher ones in misere)
+static quint32 searchDrop (quint32 cards, int strain, int *tricks) {
+  int bits[12], cnt = 0;
+  for (int c = 0; c < 32; c++) if (cards & (1u << c)) bits[cnt++] = c;
+  Q_ASSERT(cnt == 12);
+  quint32 best = 0;
+  int bestTricks = 0, bestRanks = 0;
+  for (int f = 0; f < cnt; f++) {
+    for (int j = f+1; j < cnt; j++) {
+      quint32 drop = (1u << bits[f]) | (1u << bits[j]);
+      int ranks = (bits[f] & 7)+(bits[j] & 7), t;
+      if (strain) {
+        t = TalonEvaluator::estimateTricks(cards & ~drop, drop, strain);
+        if (best && (t < bestTricks || (t == bestTricks && ranks >= bestRanks))) continue;
+      } else {
+        t = TalonEvaluator::estimateMisere(cards & ~drop, drop);
+        if (best && (t > bestTricks || (t == bestTricks && ranks <= bestRanks))) continue;
+      }
+      best = drop;
+      bestTricks = t;
+      bestRanks = ranks;
+    }
+  }
+  if (tricks) *tricks = bestTricks;
+  return best;
+}
+
+
+// searchDrop() for all five strains; strains keep their own best drops
+static void searchDrops (quint32 cards, quint32 *drops, int *tricks) {
+  int bits[12], cnt = 0;
+  for (int c = 0; c < 32; c++) if (cards & (1u << c)) bits[cnt++] = c;
+  Q_ASSERT(cnt == 12);
+  int bestRanks[5];
+  for (int s = 0; s < 5; s++) {
+    drops[s] = 0;
+    tricks[s] = bestRanks[s] = 0;
+  }
+  for (int f = 0; f < cnt; f++) {
+    for (int j = f+1; j < cnt; j++) {
+      quint32 drop = (1u << bits[f]) | (1u << bits[j]);
+      int ranks = (bits[f] & 7)+(bits[j] & 7);
+      quint64 v = strainTricks(cards & ~drop, drop);
+      for (int s = 0; s < 5; s++, v >>= 8) {
+        int t = qMin((int)(v & 0xff), 10);
+        if (drops[s] && (t < tricks[s] || (t == tricks[s] && ranks >= bestRanks[s]))) continue;
+        drops[s] = drop;
+        tricks[s] = t;
+        bestRanks[s] = ranks;
+      }
+    }
+  }
+}
+
+
+quint32 TalonEvaluator::bestDrop (quint32 cards, int strain, int *tricks) {
+  initTables();
+  return searchDrop(cards, strain, tricks);
+}
+
+
+quint32 TalonEvaluator::bestMisereDrop (quint32 cards, int *tricks) {
+  initTables();
+  return searchDrop(cards, 0, tricks);
+}
+
+
+void TalonEvaluator::bestDrops (quint32 cards, quint32 *drops, int *tricks) {
+  initTables();
+  searchDrops(cards, drops, tricks);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+double TalonEval::value (eGameBid bid) const {
+  if (bid == gtPass || !mTalons) return 0;
+  int price = gamePoolPrice(bid);
+  double res = 0;
+  if (bid == g86) {
+    for (int t = 0; t <= 10; t++) res += mMisere[t]*(t ? -price*t : price);
+  } else {
+    int need = gameTricks(bid);
+    const quint16 *cnt = mTricks[bid%10-1];
+    for (int t = 0; t <= 10; t++) res += cnt[t]*(t >= need ? price : -price*(need-t));
+  }
+  return res/mTalons;
+}
+
+
+eGameBid TalonEval::bestBid (eGameBid minBid, bool misereAllowed) const {
+  eGameBid res = gtPass;
+  double best = 0;
+  if (misereAllowed && value(g86) > best) {
+    res = g86;
+    best = value(g86);
+  }
+  if (minBid > g105) return res;
+  eGameBid bid = minBid;
+  if (bid == g86) bid = (eGameBid)succBid(bid);
+  forever {
+    if (value(bid) > best) {
+      res = bid;
+      best = value(bid);
+    }
+    if (bid == g105) break;
+    bid = (eGameBid)succBid(bid);
+  }
+  return res;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+struct TalonJob {
+  quint32 hand;
+  quint32 talon;
+  qint8 tricks[5];
+  qint8 misere;
+};
+
+
+static void evalTalon (TalonJob &job) {
+  quint32 cards = job.hand | job.talon, drops[5];
+  int t, tricks[5];
+  searchDrops(cards, drops, tricks);
+  for (int f = 0; f < 5; f++) job.tricks[f] = tricks[f];
+  searchDrop(cards, 0, &t);
+  job.misere = t;
+}
+
+
+TalonEvaluator::TalonEvaluator () {
+}
+
+
+const TalonEval &TalonEvaluator::evaluate (quint32 hand) {
+  QHash<quint32, TalonEval>::const_iterator i = mCache.constFind(hand);
+  if (i != mCache.constEnd()) return i.value();
+  if (mCache.size() >= 64) mCache.clear();
+
+  initTables(); // before threads start
+  int unseen[22], n = 0;
+  for (int c = 0; c < 32; c++) if (!(hand & (1u << c))) unseen[n++] = c;
+  Q_ASSERT(n == 22);
+  QVector<TalonJob> jobs;
+  jobs.reserve(n*(n-1)/2);
+  for (int f = 0; f < n; f++) {
+    for (int j = f+1; j < n; j++) {
+      TalonJob job;
+      job.hand = hand;
+      job.talon = (1u << unseen[f]) | (1u << unseen[j]);
+      jobs << job;
+    }
+  }
+#ifndef QT_NO_CONCURRENT
+  QtConcurrent::blockingMap(jobs, evalTalon);
+#else
+  for (int f = 0; f < jobs.size(); f++) evalTalon(jobs[f]);
+#endif
+
+  TalonEval res;
+  memset(&res, 0, sizeof(res));
+  res.mTalons = jobs.size();
+  for (int f = 0; f < jobs.size(); f++) {
+    for (int s = 0; s < 5; s++) res.mTricks[s][jobs[f].tricks[s]]++;
+    res.mMisere[jobs[f].misere]++;
+  }
+  return mCache.insert(hand, res).value();
+}
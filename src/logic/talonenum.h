@@ -0,0 +1,92 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef TALONENUM_H
+#define TALONENUM_H
+
+#include <QHash>
+
+#include "prfconst.h"
+
+/**
+ * @struct TalonEval
+ *
+ * Distribution of declarer's tricks over all 231 possible talons
+ */
+struct TalonEval {
+  quint16 mTricks[5][11]; // [strain-1][tricks]: number of talons
+  quint16 mMisere[11];    // misere tricks
+  int mTalons;
+
+  /// Expected value of contract @a bid in pool points (gtPass gives zero)
+  double value (eGameBid bid) const;
+  /// Best of gtPass, g86 (if @a misereAllowed) and contracts from @a minBid up
+  eGameBid bestBid (eGameBid minBid, bool misereAllowed) const;
+};
+
+/**
+ * @class TalonEvaluator talonenum.h
+ * @brief Exact enumeration of talons for bidding and drop
+ *
+ * Bidder sees 10 cards, so only C(22,2) talons are possible. For every
+ * talon the drop optimizer tries all 66 discards; tricks of the remaining
+ * hand are estimated by precomputed per-suit tables, so the optimizer
+ * doesn't allocate anything. All five strains are estimated together:
+ * every suit adds its tricks to one 64-bit word holding a byte per strain.
+ * Talons are spread over QThreadPool.
+ *
+ * Results are cached by hand mask.
+ */
+class TalonEvaluator {
+public:
+  TalonEvaluator ();
+
+  /// Evaluates 10-card @a hand against every possible talon
+  const TalonEval &evaluate (quint32 hand);
+
+  /**
+   * Best drop from 12 @a cards for @a strain (1..4, DDNoTrump);
+   * returns mask of two dropped cards, estimated tricks go to @a tricks
+   */
+  static quint32 bestDrop (quint32 cards, int strain, int *tricks);
+  /// Best misere drop from 12 @a cards; estimated misere tricks go to @a tricks
+  static quint32 bestMisereDrop (quint32 cards, int *tricks);
+  /**
+   * bestDrop() for strains 1..4 and DDNoTrump in one pass over the drops;
+   * @a drops and @a tricks get 5 entries, no-trump last
+   */
+  static void bestDrops (quint32 cards, quint32 *drops, int *tricks);
+
+  /// Estimated tricks of 10-card @a hand; all cards outside @a out are enemy's
+  static int estimateTricks (quint32 hand, quint32 out, int strain);
+  /// Estimated tricks misere player with @a hand can be forced to take
+  static int estimateMisere (quint32 hand, quint32 out);
+
+private:
+  static void initTables ();
+
+private:
+  QHash<quint32, TalonEval> mCache;
+};
+
+
+#endif
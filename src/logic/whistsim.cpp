@@ -0,0 +1,311 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#include "whistsim.h"
+
+#include <QThread>
+#include <QThreadStorage>
+#include <QTime>
+#ifndef QT_NO_CONCURRENT
+# include <QtConcurrentMap>
+#endif
+
+#include "dealsampler.h"
+#include "ddsolver.h"
+#include "desktop.h"
+#include "scoreboard.h"
+#include "talonenum.h"
+
+
+// layouts per card in closed play
+static const int PlayoutSamples = 2;
+
+
+static inline int bitCount (quint32 m) {
+  int res = 0;
+  for (; m; m &= m-1) res++;
+  return res;
+}
+
+
+static inline int lowBit (quint32 m) {
+  int res = 0;
+  while (!(m & 1)) { m >>= 1; res++; }
+  return res;
+}
+
+
+// Card for player @a p (0..2) in closed play: he sees his own hand, played
+// cards, shown voids and the talon; declarer knows his drop
+static int chooseCard (DDSolver &solver, DealSampler &sampler, WhistJob &job, const quint32 *hands,
+  const quint32 *voids, int p, int leader, const int *table, int turn, quint32 legal)
+{
+  if (!(legal & (legal-1))) return lowBit(legal);
+  int decl = job.declarer-1;
+  quint32 unknown = 0, allow[3], res[3];
+  int size[3], owner[3], slotCnt = 0;
+  for (int q = 0; q < 3; q++) {
+    if (q == p) continue;
+    unknown |= hands[q];
+    size[slotCnt] = bitCount(hands[q]);
+    allow[slotCnt] = ~voids[q];
+    if (q != decl) allow[slotCnt] &= ~job.talon;
+    owner[slotCnt++] = q;
+  }
+  if (p != decl) {
+    unknown |= job.drop;
+    size[slotCnt] = 2;
+    allow[slotCnt] = ~0u;
+    owner[slotCnt++] = -1;
+  }
+
+  // every layout that fits what he has seen is equally likely; the real one fits
+  sampler.clear();
+  sampler.setKnown(~unknown);
+  for (int f = 0; f < slotCnt; f++) sampler.restrict(sampler.addSlot(size[f]), allow[f]);
+  bool fits = sampler.prepare();
+  Q_ASSERT(fits);
+  Q_UNUSED(fits);
+
+  int sum[32];
+  for (quint32 m = legal; m; m &= m-1) sum[lowBit(m)] = 0;
+  for (int k = 0; k < PlayoutSamples; k++) {
+    quint32 s[3];
+    sampler.sample(job.rng, res);
+    s[p] = hands[p];
+    for (int f = 0; f < slotCnt; f++) if (owner[f] >= 0) s[owner[f]] = res[f];
+    int values[32];
+    solver.solveMoves(s, job.strain, leader+1, table, turn, job.declarer, false, values);
+    for (quint32 m = legal; m; m &= m-1) sum[lowBit(m)] += values[lowBit(m)];
+  }
+
+  // declarer maximizes his tricks, defenders minimize; lower card on ties
+  int best = -1;
+  for (quint32 m = legal; m; m &= m-1) {
+    int c = lowBit(m);
+    if (best < 0) {
+      best = c;
+      continue;
+    }
+    int d = (p == decl) ? sum[c]-sum[best] : sum[best]-sum[c];
+    if (d > 0 || (d == 0 && (c & 7) < (best & 7))) best = c;
+  }
+  return best;
+}
+
+
+static void playClosed (DDSolver &solver, WhistJob &job) {
+  DealSampler sampler;
+  quint32 hands[3], voids[3] = { 0, 0, 0 };
+  int tricks[3] = { 0, 0, 0 };
+  for (int f = 0; f < 3; f++) hands[f] = job.hands[f];
+  int trump = job.strain <= 4 ? job.strain-1 : -1;
+  int leader = job.leader-1;
+  for (int t = 0; t < 10; t++) {
+    int table[3];
+    for (int turn = 0; turn < 3; turn++) {
+      int p = (leader+turn)%3;
+      quint32 legal = DDSolver::legalMoves(hands[p], table, turn, job.strain);
+      int card = chooseCard(solver, sampler, job, hands, voids, p, leader, table, turn, legal);
+      if (turn && (card >> 3) != (table[0] >> 3)) {
+        // everybody sees that the player has no cards of this suit
+        voids[p] |= 0xffu << ((table[0] >> 3)*8);
+        if (trump >= 0 && (card >> 3) != trump) voids[p] |= 0xffu << (trump*8);
+      }
+      table[turn] = card;
+      hands[p] &= ~(1u << card);
+    }
+    leader = (leader+DDSolver::trickWinner(table, job.strain))%3;
+    tricks[leader]++;
+  }
+  for (int f = 0; f < 3; f++) job.closedTricks[f] = tricks[f];
+}
+
+
+static QThreadStorage<DDSolver *> sSolvers;
+
+static void playJob (WhistJob &job) {
+  if (!sSolvers.hasLocalData()) sSolvers.setLocalData(new DDSolver(16));
+  DDSolver &solver = *sSolvers.localData();
+  int decl = job.declarer, me = job.me, partner = 6-decl-me;
+  // defenders' tricks are split by what I can take against both others
+  int dt = solver.solve(job.hands, job.strain, job.leader, decl);
+  int mt = qMin(solver.solve(job.hands, job.strain, job.leader, me), 10-dt);
+  job.open[decl-1] = dt;
+  job.open[me-1] = mt;
+  job.open[partner-1] = 10-dt-mt;
+  if (job.closed) playClosed(solver, job);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+WhistSimulator::WhistSimulator (PrefModel *model) : m_model(model), mTimeBudget(1000),
+  mGame(gtPass), mDeclarer(0), mMe(0), mPartner(0)
+{
+}
+
+
+void WhistSimulator::simulate (quint32 hand, int me, bool closed) {
+  mGame = m_model->currentGame();
+  mDeclarer = m_model->activePlayerNumber();
+  mMe = me;
+  mPartner = 6-mDeclarer-me;
+  mJobs.clear();
+
+  Prng &rng = m_model->aiRandom();
+  quint32 talon = m_model->talonMask();
+  int strain = mGame%10, leader = m_model->nCurrentStart.nValue;
+  int batch = qMax(1, QThread::idealThreadCount())*2, lastBatch = 0;
+  QTime timer;
+  timer.start();
+  while (mJobs.size() < MaxSamples) {
+    int elapsed = timer.elapsed();
+    if (mJobs.size() >= MinSamples && elapsed+lastBatch > mTimeBudget) break;
+    QVector<WhistJob> jobs;
+    for (int n = 0; n < batch; n++) {
+      // a talon nobody has seen goes to declarer with his hand
+      int unseen[32], cnt = 0;
+      for (int c = 0; c < 32; c++) if (!((hand | talon) & (1u << c))) unseen[cnt++] = c;
+      int declCnt = cnt-10;
+      WhistJob job;
+      // declarer's cards should justify his contract (one trick of tolerance)
+      for (int attempt = 0; attempt < 64; attempt++) {
+        for (int f = cnt-1; f > 0; f--) {
+          int k = rng.bounded(f+1), t = unseen[f];
+          unseen[f] = unseen[k];
+          unseen[k] = t;
+        }
+        quint32 decl = talon;
+        for (int f = 0; f < declCnt; f++) decl |= 1u << unseen[f];
+        int tricks;
+        job.drop = TalonEvaluator::bestDrop(decl, strain, &tricks);
+        job.hands[mDeclarer-1] = decl & ~job.drop;
+        if (tricks >= gameTricks(mGame)-1) break;
+      }
+      job.hands[me-1] = hand;
+      job.hands[mPartner-1] = 0;
+      for (int f = declCnt; f < cnt; f++) job.hands[mPartner-1] |= 1u << unseen[f];
+      job.talon = talon;
+      // every job has its own stream, so threads don't share one
+      job.rng = rng.split();
+      job.strain = strain;
+      job.declarer = mDeclarer;
+      job.me = me;
+      job.leader = leader;
+      job.closed = closed;
+      jobs << job;
+    }
+#ifndef QT_NO_CONCURRENT
+    QtConcurrent::blockingMap(jobs, playJob);
+#else
+    for (int f = 0; f < jobs.size(); f++) playJob(jobs[f]);
+#endif
+    for (int f = 0; f < jobs.size(); f++) mJobs << jobs[f];
+    lastBatch = timer.elapsed()-elapsed;
+  }
+}
+
+
+// Score of player @a who (in whists) after the deal, as the score sheet counts it
+int WhistSimulator::dealScore (const eGameBid bids[3], const int tricks[3], int who) const {
+  ScoreBoard b1(m_model), b2(m_model), b3(m_model);
+  ScoreBoard *boards[3] = { &b1, &b2, &b3 };
+  int nqVist = 2;
+  for (int f = 0; f < 3; f++) if (bids[f] == gtPass) nqVist--;
+  for (int f = 0; f < 3; f++) {
+    int ret = boards[f]->recordScores(mGame, bids[f], tricks[mDeclarer-1], tricks[f], mDeclarer, f+1, nqVist);
+    if (ret) boards[f]->mountainDown(ret);
+  }
+  const ScoreBoard *sb[3] = { &b1, &b2, &b3 };
+  int scores[3];
+  ScoreBoard::settle(sb, scores);
+  return scores[who-1];
+}
+
+
+int WhistSimulator::outcomeScore (const WhistJob &job, eGameBid myBid, eGameBid partnerBid, int who,
+  bool closed) const
+{
+  eGameBid bids[3];
+  int tricks[3];
+  bids[mDeclarer-1] = mGame;
+  bids[mMe-1] = myBid;
+  bids[mPartner-1] = partnerBid;
+  if (myBid != whist && partnerBid != whist) {
+    // nobody whists: declarer gets his game, halfwhist gets half of whists
+    for (int f = 0; f < 3; f++) tricks[f] = 0;
+    tricks[mDeclarer-1] = gameTricks(mGame);
+    if (myBid == halfwhist) tricks[mMe-1] = m_model->gameWhists(mGame)/2;
+    if (partnerBid == halfwhist) tricks[mPartner-1] = m_model->gameWhists(mGame)/2;
+  } else {
+    const qint8 *t = closed ? job.closedTricks : job.open;
+    for (int f = 0; f < 3; f++) tricks[f] = t[f];
+  }
+  return dealScore(bids, tricks, who);
+}
+
+
+// The other defender doesn't see my cards: he whists when his own tricks
+// cover his half of the whists (if I whist) or all of them (if I don't)
+eGameBid WhistSimulator::partnerReply (const WhistJob &job, eGameBid myBid) const {
+  int need = m_model->gameWhists(mGame), his = job.open[mPartner-1];
+  if (myBid == whist) return his >= qMax(1, need/2) ? whist : gtPass;
+  return his >= need ? whist : gtPass;
+}
+
+
+eGameBid WhistSimulator::chooseFinalBid (quint32 hand, int me, eGameBid partnerBid, int nPlayerPass) {
+  simulate(hand, me, false);
+  bool canHalfwhist = nPlayerPass == 1 && partnerBid == gtPass && m_model->gameWhists(mGame) > 1;
+  bool redecide = nPlayerPass == 2 && partnerBid == halfwhist;
+
+  eGameBid options[3] = { gtPass, whist, halfwhist };
+  double sum[3] = { 0, 0, 0 };
+  for (int f = 0; f < mJobs.size(); f++) {
+    const WhistJob &job = mJobs[f];
+    for (int o = 0; o < (canHalfwhist ? 3 : 2); o++) {
+      eGameBid my = options[o], other = partnerBid;
+      if (partnerBid == undefined) other = partnerReply(job, my);
+      else if (redecide && my == whist) other = gtPass;
+      else if (my == halfwhist && partnerReply(job, halfwhist) == whist) {
+        // partner whists after my halfwhist, so I pass
+        my = gtPass;
+        other = whist;
+      }
+      sum[o] += outcomeScore(job, my, other, mMe);
+    }
+  }
+  int best = 0;
+  for (int o = 1; o < (canHalfwhist ? 3 : 2); o++) if (sum[o] > sum[best]) best = o;
+  return options[best];
+}
+
+
+bool WhistSimulator::chooseClosed (quint32 hand, int me) {
+  simulate(hand, me, true);
+  qint64 open = 0, closed = 0;
+  for (int f = 0; f < mJobs.size(); f++) {
+    closed += outcomeScore(mJobs[f], whist, gtPass, mMe, true);
+    open += outcomeScore(mJobs[f], whist, gtPass, mMe, false);
+  }
+  return closed > open;
+}
@@ -0,0 +1,100 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef WHISTSIM_H
+#define WHISTSIM_H
+
+#include <QVector>
+
+#include "prfconst.h"
+#include "prng.h"
+
+class PrefModel;
+
+/// One sampled layout of hidden cards with its outcomes
+struct WhistJob {
+  quint32 hands[3]; // after declarer's drop
+  quint32 drop;
+  quint32 talon;
+  Prng rng; // of closed play
+  int strain;
+  int declarer, me, leader; // player numbers
+  bool closed;          // play closed game too
+  qint8 open[3];        // tricks in open (double-dummy) play
+  qint8 closedTricks[3];
+};
+
+/**
+ * @class WhistSimulator whistsim.h
+ * @brief Whist, pass and open/closed decisions by simulation
+ *
+ * Deals hidden cards (declarer gets the seen talon and drops with
+ * TalonEvaluator; layouts that don't justify his contract are mostly
+ * rejected), plays the deal out and passes the tricks through
+ * ScoreBoard::recordScores() and ScoreBoard::settle(), so every option is
+ * valued by its expected score in whists under current conventions.
+ *
+ * Open play is solved double-dummy; closed play is played card by card,
+ * every player choosing by double-dummy results on layouts consistent
+ * with what he has seen. Samples are processed in batches on the thread
+ * pool until the time budget is spent.
+ */
+class WhistSimulator {
+public:
+  explicit WhistSimulator (PrefModel *model);
+
+  /**
+   * Returns whist, gtPass or halfwhist for defender @a me.
+   * @a partnerBid is the other defender's bid (undefined if he hasn't
+   * decided yet), @a nPlayerPass is passed from makeFinalBid()
+   */
+  eGameBid chooseFinalBid (quint32 hand, int me, eGameBid partnerBid, int nPlayerPass);
+  /// Returns true if lone whister @a me should play closed
+  bool chooseClosed (quint32 hand, int me);
+
+  /// Time for one decision, in milliseconds
+  int timeBudget () const { return mTimeBudget; }
+  void setTimeBudget (int ms) { mTimeBudget = ms; }
+  /// Samples used by the last decision
+  int samples () const { return mJobs.size(); }
+
+  static const int MinSamples = 8;
+  static const int MaxSamples = 256;
+
+private:
+  void simulate (quint32 hand, int me, bool closed);
+  int dealScore (const eGameBid bids[3], const int tricks[3], int who) const;
+  int outcomeScore (const WhistJob &job, eGameBid myBid, eGameBid partnerBid, int who,
+    bool closed=false) const;
+  eGameBid partnerReply (const WhistJob &job, eGameBid myBid) const;
+
+private:
+  PrefModel *m_model;
+  int mTimeBudget;
+  // current decision
+  eGameBid mGame;
+  int mDeclarer, mMe, mPartner;
+  QVector<WhistJob> mJobs;
+};
+
+
+#endif
@@ -32,6 +32,7 @@
 #include "debug.h"
 #include "kpref.h"
 #include "prfconst.h"
+#include "searchstats.h"
 
 #ifdef USE_CONAN
   #include "Conan.h"
@@ -40,6 +41,8 @@
 using namespace std;
 
 int main (int argc, char *argv[]) {
+  // resources are linked from a static library in the CMake build
+  Q_INIT_RESOURCE(openpref);
   QCoreApplication::setOrganizationName("OpenPref");
   QCoreApplication::setOrganizationDomain("openpref.sourceforge.net");
   QCoreApplication::setApplicationName("OpenPref");
@@ -48,6 +51,9 @@ int main (int argc, char *argv[]) {
   char *e = getenv("DEBUG");
   if (!(!e || !strcmp(e, "0") || !strcasecmp(e, "off") || strcasecmp(e, "on"))) allowDebugLog = 1;
 #endif
+  // JSON lines with AI search statistics of every decision and deal
+  char *statsFile = getenv("OPENPREF_SEARCH_STATS");
+  if (statsFile && *statsFile) SearchStatsLog::instance().open(QString::fromLocal8Bit(statsFile));
 
   for (int f = 1; f < argc; f++) {
     if (!strcmp(argv[f], "-d")) {
@@ -20,26 +20,57 @@
  *      http://www.gnu.org/licenses 
  */
 
+#include <string.h>
+
 #include "baser.h"
 #include <QByteArray>
 
+
+char *serializeGrow (QByteArray &ba, int size) {
+  int ofs = ba.size();
+  // QByteArray grows its buffer geometrically, so this is amortized O(size)
+  ba.resize(ofs+size);
+  return ba.data()+ofs;
+}
+
+
 void serializeInt (QByteArray &ba, int i) {
-  for (int f = 3; f >= 0; f--) {
-    unsigned char c = (i&0xff); i >>= 8;
-    ba.append((char)c);
-  }
+  storeInt(serializeGrow(ba, 4), i);
 }
 
+
 bool unserializeInt (QByteArray &ba, int *pos, int *i) {
-  unsigned char buf[4];
-  if (*pos+4 > ba.size()) return false;
-  const unsigned char *u = (const unsigned char *)ba.constData();
-  u += *pos; *pos += 4;
-  for (int f = 3; f >= 0; f--) buf[f] = *u++;
-  *i = 0;
-  for (int f = 0; f < 4; f++) {
-    *i <<= 8;
-    *i |= buf[f];
-  }
+  if (*pos < 0 || *pos+4 > ba.size()) return false;
+  *i = loadInt(ba.constData()+*pos);
+  *pos += 4;
+  return true;
+}
+
+
+void serializeInt64 (QByteArray &ba, quint64 i) {
+  char *d = serializeGrow(ba, 8);
+  storeInt(d, (int)(i & 0xffffffffu));
+  storeInt(d+4, (int)(i >> 32));
+}
+
+
+bool unserializeInt64 (QByteArray &ba, int *pos, quint64 *i) {
+  if (*pos < 0 || *pos+8 > ba.size()) return false;
+  const char *s = ba.constData()+*pos;
+  *i = (quint32)loadInt(s) | ((quint64)(quint32)loadInt(s+4) << 32);
+  *pos += 8;
+  return true;
+}
+
+
+void serializeBytes (QByteArray &ba, const void *data, int size) {
+  memcpy(serializeGrow(ba, size), data, size);
+}
+
+
+bool unserializeBytes (QByteArray &ba, int *pos, void *data, int size) {
+  if (*pos < 0 || *pos+size > ba.size()) return false;
+  memcpy(data, ba.constData()+*pos, size);
+  *pos += size;
   return true;
 }
@@ -23,10 +23,35 @@
 #ifndef BASER_H
 #define BASER_H
 
+#include <QtGlobal>
+
 class QByteArray;
 
+/*
+ * Values are stored little-endian. Writers that know how much they'll
+ * write take the space at once with serializeGrow() and fill it with
+ * storeInt(), instead of growing the array for every value.
+ */
+
+/// Appends @a size bytes to @a ba and returns them for writing
+char *serializeGrow (QByteArray &ba, int size);
+
+inline void storeInt (char *dest, int i) {
+  uchar *d = (uchar *)dest;
+  d[0] = i; d[1] = i >> 8; d[2] = i >> 16; d[3] = i >> 24;
+}
+
+inline int loadInt (const char *src) {
+  const uchar *s = (const uchar *)src;
+  return (int)(s[0] | (s[1] << 8) | (s[2] << 16) | ((quint32)s[3] << 24));
+}
+
 void serializeInt (QByteArray &ba, int i);
 bool unserializeInt (QByteArray &ba, int *pos, int *i);
+void serializeInt64 (QByteArray &ba, quint64 i);
+bool unserializeInt64 (QByteArray &ba, int *pos, quint64 *i);
+void serializeBytes (QByteArray &ba, const void *data, int size);
+bool unserializeBytes (QByteArray &ba, int *pos, void *data, int size);
 
 
 #endif
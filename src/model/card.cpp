@@ -56,27 +56,7 @@ int Card::compareWith (const Card &c1) const {
 
 
 QString Card::toString () const {
-  QString res("???");
-  if (!mValid) return res;
-  switch (mFace) {
-    case 7: res = " 7"; break;
-    case 8: res = " 8"; break;
-    case 9: res = " 9"; break;
-    case 10: res = "10"; break;
-    case 11: res = " J"; break;
-    case 12: res = " Q"; break;
-    case 13: res = " K"; break;
-    case 14: res = " A"; break;
-    default: return res;
-  }
-  switch (mSuit) {
-    case 1: res += "s"; break;
-    case 2: res += "c"; break;
-    case 3: res += "d"; break;
-    case 4: res += "h"; break;
-    default: res = "???";
-  }
-  return res;
+  return QString(cardIdName(id()));
 }
 
 QString Card::toUniString () const {
@@ -135,23 +115,27 @@ int operator != (const Card &c0, const Card &c1) {
 
 
 ///////////////////////////////////////////////////////////////////////////////
+// indexed by CardId
 static Card *cList[33];
 static bool inited = false;
 
 
 void initCardList () {
   if (inited) return;
-  for (int f = 0; f < 32; f++) cList[f] = new Card(f/4+7, f%4+1);
+  for (int f = 0; f < 32; f++) cList[f] = new Card(cardIdFace(f), cardIdSuit(f));
   cList[32] = 0;
   inited = true;
 }
 
 
 Card *getCard (int aFace, int aSuit) {
+  return cardFromId(cardId(aFace, aSuit));
+}
+
+
+Card *cardFromId (CardId id) {
   initCardList();
-  int no = 32;
-  if (aFace >= 7 && aFace <= FACE_ACE && aSuit >= 1 && aSuit <= 4) no = (aFace-7)*4+(aSuit-1);
-  return cList[no];
+  return cList[isValidCardId(id) ? id : 32];
 }
 
 
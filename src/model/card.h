@@ -26,6 +26,8 @@
 #include <QList>
 #include <QString>
 
+#include "cardid.h"
+
 enum eSuit {
   SuitSpades=1,
   SuitClubs,
@@ -53,6 +55,8 @@ public:
   int face () const { return mFace; }
   int suit () const { return mSuit; }
   bool isValid () const { return mValid; }
+  /// Returns packed id of card (CardNone for invalid one)
+  CardId id () const { return mValid ? cardId(mFace, mSuit) : CardNone; }
 
   int pack () const;
 
@@ -87,6 +91,13 @@ typedef QList<Card *> QCardList;
 void initCardList ();
 Card *getCard (int aFace, int aSuit);
 Card *cardFromName (const char *str);
+/// Returns singleton for @a id; null for CardNone
+Card *cardFromId (CardId id);
+/// @overload
+inline CardId cardId (const Card *c) { return c ? c->id() : CardNone; }
+
+/// Returns number of bit for given card in 32-bit card masks
+inline int cardBitNo (int aFace, int aSuit) { return (aSuit-1)*8+(aFace-7); }
 
 
 #endif
@@ -0,0 +1,111 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef CARDID_H
+#define CARDID_H
+
+#include <QtGlobal>
+
+/**
+ * Card identifier: number of card's bit in 32-bit card masks, that is
+ * (suit-1)*8+(face-7). Ids compare like cards do (by suit, then by face).
+ */
+typedef quint8 CardId;
+
+/// Empty slot in card lists
+const CardId CardNone = 0xff;
+
+static const quint8 sCardIdFace[32] = {
+  7, 8, 9, 10, 11, 12, 13, 14,
+  7, 8, 9, 10, 11, 12, 13, 14,
+  7, 8, 9, 10, 11, 12, 13, 14,
+  7, 8, 9, 10, 11, 12, 13, 14
+};
+
+static const quint8 sCardIdSuit[32] = {
+  1, 1, 1, 1, 1, 1, 1, 1,
+  2, 2, 2, 2, 2, 2, 2, 2,
+  3, 3, 3, 3, 3, 3, 3, 3,
+  4, 4, 4, 4, 4, 4, 4, 4
+};
+
+// last entry is for CardNone
+static const char * const sCardIdName[33] = {
+  " 7s", " 8s", " 9s", "10s", " Js", " Qs", " Ks", " As",
+  " 7c", " 8c", " 9c", "10c", " Jc", " Qc", " Kc", " Ac",
+  " 7d", " 8d", " 9d", "10d", " Jd", " Qd", " Kd", " Ad",
+  " 7h", " 8h", " 9h", "10h", " Jh", " Qh", " Kh", " Ah",
+  "???"
+};
+
+// order of CardList::mySort(): by suit, higher cards first
+static const quint8 sCardIdOrder[32] = {
+   7,  6,  5,  4,  3,  2,  1,  0,
+  15, 14, 13, 12, 11, 10,  9,  8,
+  23, 22, 21, 20, 19, 18, 17, 16,
+  31, 30, 29, 28, 27, 26, 25, 24
+};
+
+
+inline bool isValidCardId (int id) { return id >= 0 && id < 32; }
+
+/// Returns id of card or CardNone if @a aFace or @a aSuit is out of range
+inline CardId cardId (int aFace, int aSuit) {
+  if (aFace < 7 || aFace > 14 || aSuit < 1 || aSuit > 4) return CardNone;
+  return (CardId)((aSuit-1)*8+(aFace-7));
+}
+
+inline int cardIdFace (CardId id) { Q_ASSERT(isValidCardId(id)); return sCardIdFace[id]; }
+inline int cardIdSuit (CardId id) { Q_ASSERT(isValidCardId(id)); return sCardIdSuit[id]; }
+/// Returns name like " 7s" or "10h"; "???" for CardNone
+inline const char *cardIdName (CardId id) { return sCardIdName[isValidCardId(id) ? id : 32]; }
+/// Sort key; CardNone goes after all cards
+inline int cardIdOrder (CardId id) { return isValidCardId(id) ? sCardIdOrder[id] : 255; }
+/// Returns bit of card in card masks; 0 for CardNone
+inline quint32 cardIdMask (CardId id) { return isValidCardId(id) ? 1u << id : 0; }
+
+/**
+ * Returns who takes the trick of cards @a p1, @a p2, @a p3 (in order of
+ * play): 1, 2 or 3. @a trump is a suit, anything else means no trumps
+ */
+inline int whoseTrick (CardId p1, CardId p2, CardId p3, int trump) {
+  Q_ASSERT(p1 != CardNone);
+  Q_ASSERT(p2 != CardNone);
+  Q_ASSERT(p3 != CardNone);
+  // The next assert doesn't work because of dirty hack passing values > 4 here
+  //Q_ASSERT((trump >= 0) && (trump <= 4)); // 0 is no trumps
+  CardId maxC = p1;
+  int res = 1;
+  // ids of one suit are ordered by face
+  if ((cardIdSuit(maxC) == cardIdSuit(p2) && maxC < p2) || (cardIdSuit(maxC) != trump && cardIdSuit(p2) == trump)) {
+    maxC = p2;
+    res = 2;
+  }
+  if ((cardIdSuit(maxC) == cardIdSuit(p3) && maxC < p3) || (cardIdSuit(maxC) != trump && cardIdSuit(p3) == trump)) {
+    maxC = p3;
+    res = 3;
+  }
+  return res;
+}
+
+
+#endif
@@ -23,6 +23,7 @@
 #include "cardlist.h"
 
 #include "baser.h"
+#include "prng.h"
 
 
 CardList::CardList () {
@@ -40,27 +41,25 @@ CardList::~CardList () {
 
 
 void CardList::clear () {
-  mList.clear();
+  mIds.clear();
 }
 
 void CardList::clearNulls() {
   int j;
-  while((j = mList.indexOf(0)) != -1)
-    mList.removeAt(j);
+  while((j = mIds.indexOf(CardNone)) != -1)
+    mIds.remove(j);
 }
 
 
 Card *CardList::exists (int aFace, int aSuit) const {
-  Card *c = getCard(aFace, aSuit);
-  return exists(c);
+  CardId id = cardId(aFace, aSuit);
+  return hasId(id) ? cardFromId(id) : 0;
 }
 
 
-// can compare pointers, 'cause cards are singletones
 Card *CardList::exists (Card *cc) const {
-  if (!cc) return 0;
-  if (mList.indexOf(cc) >= 0) return cc;
-  return 0;
+  if (!cc || !hasId(cc->id())) return 0;
+  return cc;
 }
 
 
@@ -74,23 +73,23 @@ Card *CardList::maxFace () const {
 }
 
 
-Card *CardList::minInSuit (int aSuit) const {
-  Card *res = 0;
-  foreach (Card *c, mList) {
-    if (!c) continue;
-    if (aSuit > 0 && c->suit() != aSuit) continue;
-    if (!res || res->face() > c->face()) res = c;
+CardId CardList::minIdInSuit (int aSuit) const {
+  CardId res = CardNone;
+  foreach (CardId id, mIds) {
+    if (id == CardNone) continue;
+    if (aSuit > 0 && cardIdSuit(id) != aSuit) continue;
+    if (res == CardNone || cardIdFace(res) > cardIdFace(id)) res = id;
   }
   return res;
 }
 
 
-Card * CardList::maxInSuit (int aSuit) const {
-  Card *res = 0;
-  foreach (Card *c, mList) {
-    if (!c) continue;
-    if (aSuit > 0 && c->suit() != aSuit) continue;
-    if (!res || res->face() < c->face()) res = c;
+CardId CardList::maxIdInSuit (int aSuit) const {
+  CardId res = CardNone;
+  foreach (CardId id, mIds) {
+    if (id == CardNone) continue;
+    if (aSuit > 0 && cardIdSuit(id) != aSuit) continue;
+    if (res == CardNone || cardIdFace(res) < cardIdFace(id)) res = id;
   }
   return res;
 }
@@ -98,36 +97,26 @@ Card * CardList::maxInSuit (int aSuit) const {
 
 int CardList::cardsInSuit (int aSuit) const {
   int res = 0;
-  foreach (Card *c, mList) if (c && c->suit() == aSuit) res++;
+  foreach (CardId id, mIds) if (id != CardNone && cardIdSuit(id) == aSuit) res++;
   return res;
 }
 
 
 int CardList::count () const {
   int res = 0;
-  foreach (Card *c, mList)
-    if (c) res++;
+  foreach (CardId id, mIds)
+    if (id != CardNone) res++;
   return res;
 }
 
 
 void CardList::mySort () {
-  int cnt = mList.size();
-  // bubble sort
-  for (int f = 0; f < cnt; f++) {
-    for (int c = cnt-1; c > f; c--) {
-      Card *cf = mList[f], *cc = mList[c];
-      if (cf || cc) {
-        int r = 0;
-        if (cf && cc) {
-          r = (cf->suit())-(cc->suit());
-          if (!r) r = (cc->face())-(cf->face());
-        } else if (!cf) r = 1; // so nulls will go down
-        if (r > 0) mList.swap(f, c);
-      } else {
-        // both empty
-      }
-    }
+  // insertion sort by cardIdOrder(), nulls go down
+  for (int f = 1; f < mIds.size(); f++) {
+    CardId id = mIds[f];
+    int key = cardIdOrder(id), c = f;
+    for (; c > 0 && cardIdOrder(mIds[c-1]) > key; c--) mIds[c] = mIds[c-1];
+    mIds[c] = id;
   }
 }
 
@@ -169,9 +158,16 @@ Card *CardList::lesserInSuit (Card *card) const {
 }
 
 
+quint32 CardList::mask () const {
+  quint32 res = 0;
+  foreach (CardId id, mIds) res |= cardIdMask(id);
+  return res;
+}
+
+
 bool CardList::hasSuit (int aSuit) const {
-  foreach (Card *c, mList) {
-    if (c && c->suit() == aSuit) return true;
+  foreach (CardId id, mIds) {
+    if (id != CardNone && cardIdSuit(id) == aSuit) return true;
   }
   return false;
 }
@@ -188,20 +184,13 @@ int CardList::emptySuit (int aSuit) const {
 
 void CardList::copySuit (const CardList *src, eSuit aSuit) {
   // remove existing cards
-/*
-  QMutableListIterator<Card *> i(mList);
-  while (i.hasNext()) {
-    Card *c = i.next();
-    if (c->suit() == (int)aSuit) i.remove();
-  }
-*/
-  for (int f = mList.size()-1; f >= 0; f--) {
-    Card *c = mList[f];
-    if (c && c->suit() == aSuit) mList[f] = 0;
+  for (int f = mIds.size()-1; f >= 0; f--) {
+    CardId id = mIds[f];
+    if (id != CardNone && cardIdSuit(id) == aSuit) mIds[f] = CardNone;
   }
   // copy cards
-  foreach (Card *c, src->mList) {
-    if (c && c->suit() == (int)aSuit) insert(c);
+  foreach (CardId id, src->mIds) {
+    if (id != CardNone && cardIdSuit(id) == (int)aSuit) insertId(id);
   }
 }
 
@@ -209,23 +198,23 @@ void CardList::copySuit (const CardList *src, eSuit aSuit) {
 void CardList::shallowCopy (const CardList *list) {
   clear();
   if (!list) return;
-  foreach (Card *c, list->mList) mList << c;
+  mIds = list->mIds;
 }
 
 
 void CardList::shallowCopy (const CardList &list) {
-  clear();
-  foreach (Card *c, list.mList) mList << c;
+  mIds = list.mIds;
 }
 
 
 void CardList::serialize (QByteArray &ba) const {
-  serializeInt(ba, mList.size());
-  for (int f = 0; f < mList.size(); f++) {
-    Card *c = mList[f];
+  char *d = serializeGrow(ba, (mIds.size()+1)*4);
+  storeInt(d, mIds.size());
+  for (int f = 0; f < mIds.size(); f++) {
+    CardId id = mIds[f];
     int i = 0;
-    if (c) i = (c->face()-7)*10+c->suit();
-    serializeInt(ba, i);
+    if (id != CardNone) i = (cardIdFace(id)-7)*10+cardIdSuit(id);
+    storeInt(d += 4, i);
   }
 }
 
@@ -238,11 +227,8 @@ bool CardList::unserialize (QByteArray &ba, int *pos) {
     int t;
     if (!unserializeInt(ba, pos, &t)) return false;
     if (t < 1 || t > 74) t = 0;
-    if (t) {
-      int face = (t/10)+7, suit = t%10;
-      if (face >= 7 && face <= FACE_ACE && suit >= 1 && suit <= 4) mList << getCard(face, suit);
-      else mList << 0;
-    } else mList << 0;
+    if (t) mIds << cardId((t/10)+7, t%10);
+    else mIds << CardNone;
   }
   return true;
 }
@@ -267,25 +253,22 @@ CardList &CardList::operator << (Card *cc) {
 
 
 void CardList::newDeck () {
-  mList.clear();
+  mIds.clear();
   for (int suit = 1; suit <= 4; suit++) {
     for (int face = 7; face <= FACE_ACE; face++) {
-      mList << getCard(face, suit);
+      mIds << cardId(face, suit);
     }
   }
 }
 
 
-void CardList::shuffle () {
-  // remove nulls
-  QMutableListIterator<Card *> i(mList);
-  while (i.hasNext()) {
-    Card *c = i.next();
-    if (!c) i.remove();
-  }
+void CardList::shuffle (Prng &rng) {
+  clearNulls();
   // Fisher-Yates shuffler
-  for (int f = mList.size()-1; f >= 0; f--) {
-    int n = (qrand()/256)%(f+1); // 0<=n<=f
-    mList.swap(f, n);
+  for (int f = mIds.size()-1; f > 0; f--) {
+    int n = rng.bounded(f+1); // 0<=n<=f
+    CardId t = mIds[f];
+    mIds[f] = mIds[n];
+    mIds[n] = t;
   }
 }
@@ -25,16 +25,20 @@
 #define CARDLIST_H
 
 #include <QByteArray>
+#include <QVector>
 
 #include "prfconst.h"
 #include "card.h"
 
+class Prng;
+
 /**
  * @class CardList cardlist.h
- * @brief Wrapper for QList<Card>
+ * @brief List of cards
  *
- * This class provides lists of cards with set of sonvenience functions
- * List doesn't own Card pointers, they will not be deleted on list destruction
+ * This class provides lists of cards with set of sonvenience functions.
+ * Cards are kept as CardId, empty slots are CardNone. Functions taking and
+ * returning Card pointers are left for the view; they use Card singletons
  */
 class CardList {
 public:
@@ -50,14 +54,16 @@ public:
   void mySort ();
   Card *exists (int aFace, int aSuit) const;
   Card *exists (Card *cc) const;
+  /// Returns true if card @a id is in list
+  bool hasId (CardId id) const { return id != CardNone && mIds.indexOf(id) >= 0; }
 
   /// Returns card with minimal face and given suit @a aSuit
-  Card *minInSuit (int aSuit) const;
+  Card *minInSuit (int aSuit) const { return cardFromId(minIdInSuit(aSuit)); }
   /// @overload
   /// Returns card with minimal face and suit of card @a c
   Card *minInSuit (Card *c) const { Q_ASSERT(c != 0); return minInSuit(c->suit()); }
   /// Returns card with maximal face and given suit @a aSuit
-  Card *maxInSuit (int aSuit) const;
+  Card *maxInSuit (int aSuit) const { return cardFromId(maxIdInSuit(aSuit)); }
   /// @overload
   /// Returns card with maximal face and suit of card @a c
   Card *maxInSuit (Card *c) const { Q_ASSERT(c != 0); return maxInSuit(c->suit()); }
@@ -65,6 +71,10 @@ public:
   Card *minFace () const;
   /// Returns card with maximal face
   Card *maxFace () const;
+  /// Id of card with minimal face in suit @a aSuit (any suit if @a aSuit <= 0)
+  CardId minIdInSuit (int aSuit) const;
+  /// Id of card with maximal face in suit @a aSuit (any suit if @a aSuit <= 0)
+  CardId maxIdInSuit (int aSuit) const;
 
   /// Returns true if card with suit @a aSuit is present
   bool hasSuit (int aSuit) const;
@@ -84,31 +94,40 @@ public:
   int count () const;
   int emptySuit (int aSuit) const; //возврат масти (за исключение данной) в которой нет карт
 
-  int indexOf (Card *cc) const {
-    if (!cc) return -1;
-    return mList.indexOf(cc);
+  int indexOf (Card *cc) const { return indexOfId(cardId(cc)); }
+  Card *at (int idx) const { return cardFromId(idAt(idx)); }
+  void putAt (int idx, Card *c) { putIdAt(idx, cardId(c)); }
+  void removeAt (int idx) { if (idx >= 0 && idx < mIds.size()) mIds[idx] = CardNone; }
+  void remove (Card *c) { removeId(cardId(c)); }
+  int insert (Card *c) { return insertId(cardId(c)); }
+
+  int indexOfId (CardId id) const {
+    if (id == CardNone) return -1;
+    return mIds.indexOf(id);
   }
-  Card *at (int idx) const {
-    if (idx < 0 || idx >= mList.size()) return 0;
-    return mList[idx];
+  CardId idAt (int idx) const {
+    if (idx < 0 || idx >= mIds.size()) return CardNone;
+    return mIds[idx];
   }
-  void putAt (int idx, Card *c) {
+  void putIdAt (int idx, CardId id) {
     if (idx < 0) return;
-    while (idx >= mList.size()) mList << 0;
-    mList[idx] = c;
+    while (idx >= mIds.size()) mIds << CardNone;
+    mIds[idx] = id;
   }
-  void removeAt (int idx) { if (idx >= 0 && idx < mList.size()) mList[idx] = 0; }
-  void remove (Card *c) { removeAt(mList.indexOf(c)); }
-  int insert (Card *c) {
-    int idx = mList.indexOf(0);
+  void removeId (CardId id) { removeAt(indexOfId(id)); }
+  int insertId (CardId id) {
+    int idx = mIds.indexOf(CardNone);
     if (idx < 0) {
-      idx = mList.size();
-      mList << c;
-    } else mList[idx] = c;
+      idx = mIds.size();
+      mIds << id;
+    } else mIds[idx] = id;
     return idx;
   }
 
-  inline int size () const { return mList.size(); }
+  inline int size () const { return mIds.size(); }
+
+  /// Returns bit mask of all cards in list (see cardBitNo())
+  quint32 mask () const;
 
   void serialize (QByteArray &ba) const;
   bool unserialize (QByteArray &ba, int *pos);
@@ -118,7 +137,8 @@ public:
   CardList &operator << (Card *cc);
 
   void newDeck ();
-  void shuffle ();
+  /// Removes empty slots and shuffles cards with @a rng
+  void shuffle (Prng &rng);
 
 protected:
   //void removeNulls ();
@@ -126,7 +146,7 @@ protected:
   void shallowCopy (const CardList &list);
 
 protected:
-  QCardList mList;
+  QVector<CardId> mIds;
 };
 
 
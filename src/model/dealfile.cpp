@@ -0,0 +1,361 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#include <string.h>
+
+#include "dealfile.h"
+#include "cardlist.h"
+
+
+static inline void put16 (uchar *p, quint16 v) {
+  p[0] = v & 0xff;
+  p[1] = v >> 8;
+}
+
+
+static inline void put32 (uchar *p, quint32 v) {
+  for (int f = 0; f < 4; f++, v >>= 8) p[f] = v & 0xff;
+}
+
+
+static inline quint16 get16 (const uchar *p) {
+  return p[0] | (p[1] << 8);
+}
+
+
+static inline quint32 get32 (const uchar *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((quint32)p[3] << 24);
+}
+
+
+static int bitCount (quint32 m) {
+  int res = 0;
+  for (; m; m &= m-1) res++;
+  return res;
+}
+
+
+/*
+ * Card name at @a s ("7s", "10h", "Qd"; case doesn't matter) followed by
+ * space or end of string. Returns CardNone if there is none; moves @a s
+ * past the name
+ */
+static CardId parseCard (const char *&s) {
+  int face;
+  switch (*s++) {
+    case '7': face = 7; break;
+    case '8': face = 8; break;
+    case '9': face = 9; break;
+    case '1':
+      if (*s++ != '0') return CardNone;
+      face = 10;
+      break;
+    case 'J': case 'j': face = 11; break;
+    case 'Q': case 'q': face = 12; break;
+    case 'K': case 'k': face = 13; break;
+    case 'A': case 'a': face = 14; break;
+    default: return CardNone;
+  }
+  int suit;
+  switch (*s++) {
+    case 'S': case 's': suit = 1; break;
+    case 'C': case 'c': suit = 2; break;
+    case 'D': case 'd': suit = 3; break;
+    case 'H': case 'h': suit = 4; break;
+    default: return CardNone;
+  }
+  if ((uchar)*s > ' ') return CardNone;
+  return cardId(face, suit);
+}
+
+
+// " 7s" or " 10h" at @a d, returns the end
+static char *putCardName (char *d, CardId id) {
+  const char *n = cardIdName(id);
+  if (*n == ' ') n++;
+  *d++ = ' ';
+  while (*n) *d++ = *n++;
+  return d;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+void PresetDeal::clear () {
+  hands[0] = hands[1] = hands[2] = 0;
+  talon[0] = talon[1] = CardNone;
+  first = 0;
+}
+
+
+bool PresetDeal::isValid () const {
+  if (!isValidCardId(talon[0]) || !isValidCardId(talon[1]) || talon[0] == talon[1]) return false;
+  quint32 seen = cardIdMask(talon[0]) | cardIdMask(talon[1]);
+  for (int f = 0; f < 3; f++) {
+    if (bitCount(hands[f]) != 10 || (hands[f] & seen)) return false;
+    seen |= hands[f];
+  }
+  return first <= 3;
+}
+
+
+// dealing in runGame(): two cards to every player in turn, starting with
+// the player after the first bidder; talon after the first four pairs
+void PresetDeal::toDeck (CardList &deck, int aFirst) const {
+  quint32 left[3] = { hands[0], hands[1], hands[2] };
+  if (deck.size() != 32) deck.clear();
+  int cc = aFirst%3+1, pos = 0;
+  for (int f = 0; f < 15; f++) {
+    if (f == 4) {
+      deck.putIdAt(pos++, talon[0]);
+      deck.putIdAt(pos++, talon[1]);
+    }
+    for (int k = 0; k < 2; k++) {
+      CardId id = 0;
+      while (id < 32 && !(left[cc-1] & cardIdMask(id))) id++;
+      left[cc-1] &= ~cardIdMask(id);
+      deck.putIdAt(pos++, id < 32 ? id : CardNone);
+    }
+    cc = cc%3+1;
+  }
+}
+
+
+void PresetDeal::fromDeck (const CardList &deck, int aFirst) {
+  clear();
+  int cc = aFirst%3+1, pos = 0;
+  for (int f = 0; f < 15; f++) {
+    if (f == 4) {
+      talon[0] = deck.idAt(pos++);
+      talon[1] = deck.idAt(pos++);
+    }
+    hands[cc-1] |= cardIdMask(deck.idAt(pos++));
+    hands[cc-1] |= cardIdMask(deck.idAt(pos++));
+    cc = cc%3+1;
+  }
+  first = aFirst;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+const char DealFileWriter::Magic[4] = { 'O', 'P', 'D', 'L' };
+
+
+DealFileWriter::DealFileWriter () : mBinary(false), mUsed(0) {
+}
+
+
+DealFileWriter::~DealFileWriter () {
+  close();
+}
+
+
+bool DealFileWriter::open (const QString &fileName, bool binary) {
+  close();
+  mFile.setFileName(fileName);
+  if (!mFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+  mBinary = binary;
+  mUsed = 0;
+  if (mBinary) {
+    uchar *hdr = (uchar *)mBuf;
+    memset(hdr, 0, HeaderSize);
+    memcpy(hdr, Magic, 4);
+    put16(hdr+4, Version);
+    put16(hdr+6, RecordSize);
+    mUsed = HeaderSize;
+  } else {
+    static const char title[] = "# first bidder, hands of players 1, 2, 3 and talon\n";
+    memcpy(mBuf, title, sizeof(title)-1);
+    mUsed = sizeof(title)-1;
+  }
+  return true;
+}
+
+
+bool DealFileWriter::close () {
+  if (!mFile.isOpen()) return true;
+  bool ok = flush();
+  mFile.close();
+  return ok;
+}
+
+
+bool DealFileWriter::append (const PresetDeal &deal) {
+  if (!mFile.isOpen()) return false;
+  if (mUsed+MaxLine > BufSize && !flush()) return false;
+  char *d = mBuf+mUsed;
+  if (mBinary) {
+    uchar *r = (uchar *)d;
+    for (int f = 0; f < 3; f++) put32(r+f*4, deal.hands[f]);
+    r[12] = deal.talon[0];
+    r[13] = deal.talon[1];
+    r[14] = deal.first;
+    r[15] = 0;
+    mUsed += RecordSize;
+    return true;
+  }
+  *d++ = '0'+deal.first%10;
+  *d++ = ' ';
+  for (int h = 0; h < 3; h++) {
+    if (h) {
+      *d++ = ' ';
+      *d++ = '/';
+    }
+    for (CardId id = 0; id < 32; id++)
+      if (deal.hands[h] & cardIdMask(id)) d = putCardName(d, id);
+  }
+  // talon isn't sorted: its cards lead the first tricks of pass-out
+  *d++ = ' ';
+  *d++ = '/';
+  d = putCardName(d, deal.talon[0]);
+  d = putCardName(d, deal.talon[1]);
+  *d++ = '\n';
+  mUsed = d-mBuf;
+  return true;
+}
+
+
+bool DealFileWriter::flush () {
+  if (!mFile.isOpen()) return false;
+  bool ok = mFile.write(mBuf, mUsed) == mUsed;
+  mUsed = 0;
+  return mFile.flush() && ok;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+DealFileReader::DealFileReader () : mBinary(false), mPos(0), mLine(0), mErrorLine(0), mBufPos(0), mBufUsed(0) {
+}
+
+
+DealFileReader::~DealFileReader () {
+  close();
+}
+
+
+bool DealFileReader::open (const QString &fileName) {
+  close();
+  mFile.setFileName(fileName);
+  if (!mFile.open(QIODevice::ReadOnly)) return false;
+  if (!rewind()) {
+    mFile.close();
+    return false;
+  }
+  return true;
+}
+
+
+void DealFileReader::close () {
+  if (mFile.isOpen()) mFile.close();
+  mPos = mLine = mErrorLine = 0;
+  mBufPos = mBufUsed = 0;
+}
+
+
+bool DealFileReader::rewind () {
+  if (!mFile.isOpen() || !mFile.seek(0)) return false;
+  mPos = mLine = mErrorLine = 0;
+  mBufPos = mBufUsed = 0;
+  uchar hdr[DealFileWriter::HeaderSize];
+  mBinary = mFile.read((char *)hdr, sizeof(hdr)) == (qint64)sizeof(hdr) && !memcmp(hdr, DealFileWriter::Magic, 4);
+  if (mBinary) {
+    return get16(hdr+4) == DealFileWriter::Version && get16(hdr+6) == DealFileWriter::RecordSize;
+  }
+  return mFile.seek(0);
+}
+
+
+bool DealFileReader::next (PresetDeal *deal) {
+  if (!mFile.isOpen() || mErrorLine) return false;
+  if (!(mBinary ? nextBinary(deal) : nextText(deal))) return false;
+  mPos++;
+  return true;
+}
+
+
+bool DealFileReader::nextBinary (PresetDeal *deal) {
+  if (mBufPos+DealFileWriter::RecordSize > mBufUsed) {
+    // records are read a buffer at a time; a torn record at the end is ignored
+    qint64 n = mFile.read(mBuf, sizeof(mBuf)-sizeof(mBuf)%DealFileWriter::RecordSize);
+    if (n < DealFileWriter::RecordSize) return false;
+    mBufUsed = (int)n;
+    mBufPos = 0;
+  }
+  const uchar *r = (const uchar *)mBuf+mBufPos;
+  mBufPos += DealFileWriter::RecordSize;
+  mLine++;
+  for (int f = 0; f < 3; f++) deal->hands[f] = get32(r+f*4);
+  deal->talon[0] = r[12];
+  deal->talon[1] = r[13];
+  deal->first = r[14];
+  if (!deal->isValid()) {
+    mErrorLine = mLine;
+    return false;
+  }
+  return true;
+}
+
+
+bool DealFileReader::nextText (PresetDeal *deal) {
+  for (;;) {
+    qint64 len = mFile.readLine(mBuf, sizeof(mBuf));
+    if (len <= 0) return false;
+    mLine++;
+    if (mBuf[len-1] != '\n' && !mFile.atEnd()) {
+      // not even a comment is this long
+      mErrorLine = mLine;
+      return false;
+    }
+    const char *s = mBuf;
+    while (*s && (uchar)*s <= ' ') s++;
+    if (!*s || *s == '#') continue;
+
+    deal->clear();
+    if (*s < '0' || *s > '3' || (uchar)s[1] > ' ') {
+      mErrorLine = mLine;
+      return false;
+    }
+    deal->first = *s++-'0';
+    int part = 0, talonCnt = 0;
+    for (;;) {
+      while (*s && (uchar)*s <= ' ') s++;
+      if (!*s) break;
+      if (*s == '/') {
+        s++;
+        if (++part > 3) break;
+        continue;
+      }
+      CardId id = parseCard(s);
+      if (id == CardNone) {
+        part = 4;
+        break;
+      }
+      if (part < 3) deal->hands[part] |= cardIdMask(id);
+      else if (talonCnt < 2) deal->talon[talonCnt++] = id;
+      else talonCnt++;
+    }
+    if (part != 3 || talonCnt != 2 || !deal->isValid()) {
+      mErrorLine = mLine;
+      return false;
+    }
+    return true;
+  }
+}
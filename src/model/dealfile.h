@@ -0,0 +1,142 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef DEALFILE_H
+#define DEALFILE_H
+
+#include <QFile>
+
+#include "cardid.h"
+
+class CardList;
+
+/**
+ * @struct PresetDeal
+ *
+ * Predetermined deal: cards of players 1..3, talon and first bidder
+ */
+struct PresetDeal {
+  PresetDeal () { clear(); }
+  void clear ();
+
+  /// 10 cards for every player, 2 in talon, none twice
+  bool isValid () const;
+  /**
+   * Puts into @a deck the order of cards that PrefModel::runGame() deals
+   * into this deal when bidding starts with player @a aFirst. The deck is
+   * filled in place, so a deck of 32 slots isn't reallocated
+   */
+  void toDeck (CardList &deck, int aFirst) const;
+  /// Takes the deal that dealing @a deck gives when bidding starts with player @a aFirst
+  void fromDeck (const CardList &deck, int aFirst);
+
+  quint32 hands[3]; // card masks, see cardIdMask()
+  CardId talon[2];
+  quint8 first; // first bidder, 0 if not given
+};
+
+/**
+ * @class DealFileWriter dealfile.h
+ * @brief Writes many deals to one file
+ *
+ * Text files have one deal per line: the first bidder (0 if not given),
+ * then three hands and the talon separated by slashes:
+ * @code
+ * 1  7s 9s Js As 8c Qc 9d 10d Kh Ah / 8s ... / 7c ... / Jh Qh
+ * @endcode
+ * Empty lines and lines starting with '#' are skipped. Binary files are
+ * a 16-byte header ("OPDL", version, record size) followed by RecordSize
+ * byte records: three u32 hand masks, two talon cards and the first
+ * bidder. Deals are collected in a fixed buffer, so writing doesn't
+ * allocate memory.
+ */
+class DealFileWriter {
+public:
+  DealFileWriter ();
+  ~DealFileWriter ();
+
+  /// Creates @a fileName (overwrites existing file)
+  bool open (const QString &fileName, bool binary);
+  bool close ();
+  bool isOpen () const { return mFile.isOpen(); }
+  bool isBinary () const { return mBinary; }
+
+  bool append (const PresetDeal &deal);
+  bool flush ();
+  QString fileName () const { return mFile.fileName(); }
+
+  static const char Magic[4];
+  enum { HeaderSize = 16, Version = 1, RecordSize = 16 };
+  // the longest text line is 4+32*4+3*2+1 bytes
+  enum { BufSize = 16384, MaxLine = 160 };
+
+private:
+  QFile mFile;
+  bool mBinary;
+  int mUsed;
+  char mBuf[BufSize];
+};
+
+/**
+ * @class DealFileReader dealfile.h
+ * @brief Reads deals of text or binary deal file one by one
+ *
+ * The format is taken from the file, see DealFileWriter. Lines and records
+ * are read into fixed buffers, so going over any number of deals doesn't
+ * allocate memory.
+ */
+class DealFileReader {
+public:
+  DealFileReader ();
+  ~DealFileReader ();
+
+  bool open (const QString &fileName);
+  void close ();
+  bool isOpen () const { return mFile.isOpen(); }
+  bool isBinary () const { return mBinary; }
+
+  /// Reads next deal; false at end of file or on a broken deal (see errorLine())
+  bool next (PresetDeal *deal);
+  /// Starts again from the first deal
+  bool rewind ();
+  /// Number of deals read since open() or rewind()
+  int position () const { return mPos; }
+  /// Line (or record) number of the broken deal, 0 if there was none
+  int errorLine () const { return mErrorLine; }
+  QString fileName () const { return mFile.fileName(); }
+
+private:
+  bool nextBinary (PresetDeal *deal);
+  bool nextText (PresetDeal *deal);
+
+private:
+  QFile mFile;
+  bool mBinary;
+  int mPos;
+  int mLine;
+  int mErrorLine;
+  int mBufPos, mBufUsed; // binary records in mBuf
+  char mBuf[DealFileWriter::BufSize];
+};
+
+
+#endif
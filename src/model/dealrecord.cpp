@@ -0,0 +1,344 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "dealrecord.h"
+
+
+static inline void put16 (uchar *p, quint16 v) {
+  p[0] = v & 0xff;
+  p[1] = v >> 8;
+}
+
+
+static inline void put32 (uchar *p, quint32 v) {
+  for (int f = 0; f < 4; f++, v >>= 8) p[f] = v & 0xff;
+}
+
+
+static inline quint16 get16 (const uchar *p) {
+  return p[0] | (p[1] << 8);
+}
+
+
+static inline quint32 get32 (const uchar *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((quint32)p[3] << 24);
+}
+
+
+// decision time: 11-bit mantissa, 5-bit exponent; exponent is kept below
+// 22 for the time to fit in 32 bits (longer than 71 minutes is clamped)
+static quint16 packTime (quint64 usec) {
+  int e = 0;
+  while (usec >= 0x800 && e < 21) {
+    usec >>= 1;
+    e++;
+  }
+  return (e << 11) | qMin(usec, (quint64)0x7ff);
+}
+
+
+static inline quint32 unpackTime (quint16 code) {
+  return (quint32)(code & 0x7ff) << (code >> 11);
+}
+
+
+static const char *sKindNames[DealRecord::DecisionKinds] = {
+  "bid", "drop", "whist", "closed", "move"
+};
+
+static const char *sEngineNames[DealRecord::Engines] = {
+  "?", "Human", "Original", "AlphaBeta"
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+DealRecord::DealRecord () {
+  clear();
+}
+
+
+void DealRecord::clear () {
+  memset(this, 0, sizeof(*this));
+  talon[0] = talon[1] = drop[0] = drop[1] = CardNone;
+}
+
+
+void DealRecord::addDecision (int seat, int kind, int engine, quint64 usec) {
+  if (decisionCount >= MaxDecisions) return;
+  Decision &d = decisions[decisionCount++];
+  d.seat = seat;
+  d.kind = kind;
+  d.engine = engine;
+  d.usec = unpackTime(packTime(usec));
+}
+
+
+const char *DealRecord::kindName (int kind) {
+  if (kind < 0 || kind >= DecisionKinds) return "";
+  return sKindNames[kind];
+}
+
+
+const char *DealRecord::engineName (int engine) {
+  if (engine < 0 || engine >= Engines) engine = EngineUnknown;
+  return sEngineNames[engine];
+}
+
+
+int DealRecord::engineCode (const QString &type) {
+  for (int f = EngineUnknown+1; f < Engines; f++) {
+    if (type == QLatin1String(sEngineNames[f])) return f;
+  }
+  return EngineUnknown;
+}
+
+
+void DealRecord::pack (uchar *buf) const {
+  memset(buf, 0, RecordSize);
+  for (int f = 0; f < 3; f++) put32(buf+OfsHands+f*4, hands[f]);
+  buf[OfsTalon] = talon[0];
+  buf[OfsTalon+1] = talon[1];
+  buf[OfsDrop] = drop[0];
+  buf[OfsDrop+1] = drop[1];
+  buf[OfsFirst] = first;
+  buf[OfsGame] = game;
+  buf[OfsDeclarer] = declarer;
+  buf[OfsFlags] = flags;
+  for (int f = 0; f < 3; f++) {
+    buf[OfsFinalBids+f] = finalBids[f];
+    buf[OfsTricks+f] = tricks[f];
+  }
+  put16(buf+OfsTime, time);
+  const qint16 *scores[5] = { score, pool, mountain, leftWhists, rightWhists };
+  for (int s = 0; s < 5; s++)
+    for (int f = 0; f < 3; f++) put16(buf+OfsScores+(s*3+f)*2, scores[s][f]);
+  buf[OfsBidCount] = bidCount;
+  for (int f = 0; f < qMin((int)bidCount, (int)MaxBids); f++) buf[OfsBids+f] = bids[f];
+  // 5-bit codes, lowest bits first
+  buf[OfsPlayCount] = playCount;
+  uchar *p = buf+OfsPlay;
+  for (int f = 0; f < playCount; f++) {
+    int bit = f*5;
+    quint32 code = (play[f] & 0x1f) << (bit & 7);
+    p[bit >> 3] |= code & 0xff;
+    if (code >> 8) p[(bit >> 3)+1] |= code >> 8;
+  }
+  buf[OfsDecisionCount] = decisionCount;
+  p = buf+OfsDecisions;
+  for (int f = 0; f < decisionCount; f++, p += 3) {
+    const Decision &d = decisions[f];
+    p[0] = (d.seat & 3) | (d.kind & 7) << 2 | (d.engine & 7) << 5;
+    put16(p+1, packTime(d.usec));
+  }
+}
+
+
+void DealRecord::unpack (const uchar *buf, int size) {
+  clear();
+  for (int f = 0; f < 3; f++) hands[f] = get32(buf+OfsHands+f*4);
+  talon[0] = buf[OfsTalon];
+  talon[1] = buf[OfsTalon+1];
+  drop[0] = buf[OfsDrop];
+  drop[1] = buf[OfsDrop+1];
+  first = buf[OfsFirst];
+  game = buf[OfsGame];
+  declarer = buf[OfsDeclarer];
+  flags = buf[OfsFlags];
+  for (int f = 0; f < 3; f++) {
+    finalBids[f] = buf[OfsFinalBids+f];
+    tricks[f] = buf[OfsTricks+f];
+  }
+  time = get16(buf+OfsTime);
+  qint16 *scores[5] = { score, pool, mountain, leftWhists, rightWhists };
+  for (int s = 0; s < 5; s++)
+    for (int f = 0; f < 3; f++) scores[s][f] = (qint16)get16(buf+OfsScores+(s*3+f)*2);
+  bidCount = buf[OfsBidCount];
+  for (int f = 0; f < qMin((int)bidCount, (int)MaxBids); f++) bids[f] = buf[OfsBids+f];
+  playCount = qMin((int)buf[OfsPlayCount], (int)MaxPlay);
+  const uchar *p = buf+OfsPlay;
+  for (int f = 0; f < playCount; f++) {
+    int bit = f*5;
+    play[f] = (get16(p+(bit >> 3)) >> (bit & 7)) & 0x1f;
+  }
+  if (size < RecordSize) return;
+  decisionCount = qMin((int)buf[OfsDecisionCount], (int)MaxDecisions);
+  p = buf+OfsDecisions;
+  for (int f = 0; f < decisionCount; f++, p += 3) {
+    Decision &d = decisions[f];
+    d.seat = p[0] & 3;
+    d.kind = (p[0] >> 2) & 7;
+    d.engine = p[0] >> 5;
+    d.usec = unpackTime(get16(p+1));
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+const char DealWriter::Magic[4] = { 'O', 'P', 'D', 'A' };
+
+
+DealWriter::DealWriter () : mOpenCount(0) {
+}
+
+
+DealWriter::~DealWriter () {
+  close();
+}
+
+
+bool DealWriter::open (const QString &fileName) {
+  close();
+  if (!upgrade(fileName)) return false;
+  mFile.setFileName(fileName);
+  if (!mFile.open(QIODevice::ReadWrite)) return false;
+  uchar hdr[HeaderSize];
+  qint64 size = mFile.size();
+  if (size < HeaderSize) {
+    // new archive (or one torn inside the header)
+    memset(hdr, 0, sizeof(hdr));
+    memcpy(hdr, Magic, 4);
+    put16(hdr+4, Version);
+    put16(hdr+6, DealRecord::RecordSize);
+    if (!mFile.resize(0) || mFile.write((const char *)hdr, HeaderSize) != HeaderSize) {
+      mFile.close();
+      return false;
+    }
+  } else {
+    if (mFile.read((char *)hdr, HeaderSize) != HeaderSize || memcmp(hdr, Magic, 4) ||
+        get16(hdr+4) != Version || get16(hdr+6) != DealRecord::RecordSize) {
+      mFile.close();
+      return false;
+    }
+    qint64 torn = (size-HeaderSize)%DealRecord::RecordSize;
+    if (torn && !mFile.resize(size-torn)) {
+      mFile.close();
+      return false;
+    }
+  }
+  mFile.flush();
+  mOpenCount = (mFile.size()-HeaderSize)/DealRecord::RecordSize;
+  return mFile.seek(mFile.size());
+}
+
+
+void DealWriter::close () {
+  if (mFile.isOpen()) mFile.close();
+}
+
+
+// rewrites archive of older version (if it is one) in current format
+bool DealWriter::upgrade (const QString &fileName) {
+  DealArchive old;
+  if (!old.open(fileName)) return true; // new file or not an archive: open() decides
+  if (old.version() == Version) return true;
+  QString tmpName = fileName+".new";
+  QFile tmp(tmpName);
+  if (!tmp.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+  uchar hdr[HeaderSize];
+  memset(hdr, 0, sizeof(hdr));
+  memcpy(hdr, Magic, 4);
+  put16(hdr+4, Version);
+  put16(hdr+6, DealRecord::RecordSize);
+  bool ok = tmp.write((const char *)hdr, HeaderSize) == HeaderSize;
+  DealRecord rec;
+  uchar buf[DealRecord::RecordSize];
+  for (int f = 0; ok && f < old.count(); f++) {
+    ok = old.record(f, &rec);
+    rec.pack(buf);
+    ok = ok && tmp.write((const char *)buf, sizeof(buf)) == (qint64)sizeof(buf);
+  }
+  tmp.close();
+  old.close();
+  if (!ok || !QFile::remove(fileName) || !QFile::rename(tmpName, fileName)) {
+    QFile::remove(tmpName);
+    return false;
+  }
+  return true;
+}
+
+
+bool DealWriter::append (const DealRecord &rec) {
+  if (!mFile.isOpen()) return false;
+  uchar buf[DealRecord::RecordSize];
+  rec.pack(buf);
+  if (mFile.write((const char *)buf, sizeof(buf)) != (qint64)sizeof(buf)) return false;
+  return mFile.flush();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+DealArchive::DealArchive () : mData(0), mCount(0), mVersion(0), mRecordSize(DealRecord::RecordSize) {
+}
+
+
+DealArchive::~DealArchive () {
+  close();
+}
+
+
+bool DealArchive::open (const QString &fileName) {
+  close();
+  mFile.setFileName(fileName);
+  if (!mFile.open(QIODevice::ReadOnly)) return false;
+  uchar hdr[DealWriter::HeaderSize];
+  if (mFile.read((char *)hdr, sizeof(hdr)) != (qint64)sizeof(hdr) ||
+      memcmp(hdr, DealWriter::Magic, 4)) {
+    mFile.close();
+    return false;
+  }
+  mVersion = get16(hdr+4);
+  mRecordSize = get16(hdr+6);
+  if (!(mVersion == DealWriter::Version && mRecordSize == DealRecord::RecordSize) &&
+      !(mVersion == 1 && mRecordSize == DealRecord::RecordSizeV1)) {
+    mFile.close();
+    return false;
+  }
+  qint64 cnt = (mFile.size()-DealWriter::HeaderSize)/mRecordSize;
+  mCount = (int)qMin(cnt, (qint64)INT_MAX);
+  if (mCount > 0) mData = mFile.map(0, DealWriter::HeaderSize+(qint64)mCount*mRecordSize);
+  return true;
+}
+
+
+void DealArchive::close () {
+  if (mData) mFile.unmap((uchar *)mData);
+  mData = 0;
+  mCount = 0;
+  if (mFile.isOpen()) mFile.close();
+}
+
+
+bool DealArchive::record (int idx, DealRecord *rec) {
+  if (idx < 0 || idx >= mCount) return false;
+  qint64 ofs = DealWriter::HeaderSize+(qint64)idx*mRecordSize;
+  if (mData) {
+    rec->unpack(mData+ofs, mRecordSize);
+    return true;
+  }
+  uchar buf[DealRecord::RecordSize];
+  if (!mFile.seek(ofs) || mFile.read((char *)buf, mRecordSize) != mRecordSize) return false;
+  rec->unpack(buf, mRecordSize);
+  return true;
+}
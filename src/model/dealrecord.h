@@ -0,0 +1,190 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef DEALRECORD_H
+#define DEALRECORD_H
+
+#include <QFile>
+
+#include "cardid.h"
+
+/**
+ * @struct DealRecord
+ *
+ * One finished deal. On disk it takes RecordSize bytes (little-endian):
+ * @code
+ *  0  hands      3 x u32 card masks as dealt (players 1..3)
+ * 12  talon, drop  4 x CardId (drop is CardNone without one)
+ * 16  first, game, declarer, flags
+ * 20  finalBids  3 bytes; tricks 3 bytes
+ * 26  time       u16, deciseconds
+ * 28  score, pool, mountain, leftWhists, rightWhists  5 x 3 x i16 (after deal)
+ * 58  bidCount, bids[MaxBids]
+ * 75  playCount, play[] 30 x 5-bit card ids in order of play (fewer if
+ *     the rest of the deal was claimed, see FlagClaimed)
+ * 95  reserved
+ * 96  decisionCount, decisions[MaxDecisions] 3 bytes each (since version 2):
+ *     seat | kind << 2 | engine << 5, u16 time
+ * @endcode
+ * Bidders are not stored: bidding goes round from @a first skipping
+ * players who passed, so they follow from the sequence.
+ *
+ * Decision time is in microseconds as 11-bit mantissa and 5-bit exponent
+ * (mantissa << exponent): exact below 2 ms, within 0.1% above. Version 1
+ * records (96 bytes) have no decisions.
+ */
+struct DealRecord {
+  enum { RecordSize = 256, RecordSizeV1 = 96, MaxBids = 16, MaxPlay = 30, MaxDecisions = 52 };
+  enum { FlagClosedWhist = 1, FlagClaimed = 2 };
+  // field offsets in packed record
+  enum {
+    OfsHands = 0, OfsTalon = 12, OfsDrop = 14, OfsFirst = 16, OfsGame = 17,
+    OfsDeclarer = 18, OfsFlags = 19, OfsFinalBids = 20, OfsTricks = 23, OfsTime = 26,
+    OfsScores = 28, OfsBidCount = 58, OfsBids = 59, OfsPlayCount = 75, OfsPlay = 76,
+    OfsDecisionCount = 96, OfsDecisions = 97
+  };
+  enum DecisionKind { DecBid = 0, DecDrop, DecFinalBid, DecClosedWhist, DecMove, DecisionKinds };
+  // who made the decision, see Player::type()
+  enum Engine { EngineUnknown = 0, EngineHuman, EngineOriginal, EngineAlphaBeta, Engines };
+
+  struct Decision {
+    quint8 seat;   // player 1..3
+    quint8 kind;   // DecisionKind
+    quint8 engine; // Engine
+    quint32 usec;  // as stored, i.e. rounded
+  };
+
+  DealRecord ();
+  void clear ();
+
+  void addBid (int bid) { if (bidCount < MaxBids) bids[bidCount] = bid; bidCount++; }
+  void addPlay (CardId id) { if (playCount < MaxPlay) play[playCount++] = id; }
+  void addDecision (int seat, int kind, int engine, quint64 usec);
+
+  static const char *kindName (int kind);
+  static const char *engineName (int engine);
+  /// Engine code of Player::type() string @a type
+  static int engineCode (const QString &type);
+
+  void pack (uchar *buf) const;
+  /// Decodes record of @a size bytes (RecordSizeV1 or RecordSize)
+  void unpack (const uchar *buf, int size = RecordSize);
+
+  quint32 hands[3];
+  CardId talon[2];
+  CardId drop[2];
+  quint8 first;        // first bidder
+  quint8 game;         // eGameBid
+  quint8 declarer;     // 0 in pass-out
+  quint8 flags;
+  quint8 finalBids[3]; // eGameBid of players after whisting
+  quint8 tricks[3];
+  quint16 time;
+  qint16 score[3];
+  qint16 pool[3];
+  qint16 mountain[3];
+  qint16 leftWhists[3];
+  qint16 rightWhists[3];
+  quint8 bidCount;     // may exceed MaxBids, then only first bids are kept
+  quint8 bids[MaxBids];
+  quint8 playCount;
+  CardId play[MaxPlay];
+  quint8 decisionCount;
+  Decision decisions[MaxDecisions];
+};
+
+/**
+ * @class DealWriter dealrecord.h
+ * @brief Append-only archive of deal records
+ *
+ * Archive is a 16-byte header followed by records. Every record is written
+ * with a single write and flushed, so at most the deal being written is
+ * lost on crash; a torn record at the end is cut off on next open().
+ * Archives of older versions are converted on open().
+ */
+class DealWriter {
+public:
+  DealWriter ();
+  ~DealWriter ();
+
+  /// Opens archive @a fileName for appending, creates it if needed
+  bool open (const QString &fileName);
+  void close ();
+  bool isOpen () const { return mFile.isOpen(); }
+
+  bool append (const DealRecord &rec);
+  QString fileName () const { return mFile.fileName(); }
+  /// Number of records the archive had when it was opened
+  int openCount () const { return mOpenCount; }
+
+  static const char Magic[4];
+  enum { HeaderSize = 16, Version = 2 };
+
+private:
+  static bool upgrade (const QString &fileName);
+
+private:
+  QFile mFile;
+  int mOpenCount;
+};
+
+/**
+ * @class DealArchive dealrecord.h
+ * @brief Read-only random access to deal archive
+ *
+ * The file is memory-mapped; records have fixed size, so record @a idx
+ * lies at HeaderSize+idx*recordSize() and no index has to be built. Opening
+ * takes the same time and memory for any number of deals. If the file
+ * can't be mapped, records are read one by one. Version 1 archives are
+ * read as well.
+ */
+class DealArchive {
+public:
+  DealArchive ();
+  ~DealArchive ();
+
+  bool open (const QString &fileName);
+  void close ();
+
+  /// Number of complete records when the archive was opened
+  int count () const { return mCount; }
+  int version () const { return mVersion; }
+  /// Size of packed records, RecordSizeV1 in version 1 archives
+  int recordSize () const { return mRecordSize; }
+  /// Decodes record @a idx into @a rec
+  bool record (int idx, DealRecord *rec);
+  /// Packed record @a idx in mapped memory; null if the file isn't mapped
+  const uchar *rawRecord (int idx) const {
+    if (!mData || idx < 0 || idx >= mCount) return 0;
+    return mData+DealWriter::HeaderSize+(qint64)idx*mRecordSize;
+  }
+
+private:
+  QFile mFile;
+  const uchar *mData;
+  int mCount;
+  int mVersion;
+  int mRecordSize;
+};
+
+
+#endif
@@ -20,17 +20,202 @@
  *      http://www.gnu.org/licenses 
  */
 
-#include <QFile>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QThread>
 
 #include "debug.h"
-#include <cstdlib>
-using namespace std;
 
 
 int allowDebugLog = 0;
 
 
 #ifdef XDEBUG
+/*
+ * Lines go through a fixed ring of slots (bounded multi-producer queue,
+ * see http://www.1024cores.net/home/lock-free-algorithms/queues): callers
+ * copy a formatted line into a slot and never take a lock or touch the
+ * file. A line longer than a slot takes several adjacent ones and the
+ * writer joins them again; only lines over MaxLineSlots slots are cut, and
+ * the cut is marked with "...". A single writer thread takes the slots in
+ * order, adds timestamps and writes them in batches. When the ring is full
+ * new lines are dropped and counted.
+ */
+namespace {
+
+class AsyncLog : public QThread {
+public:
+  enum { Slots = 1024, SlotSize = 256, MaxLineSlots = 64 };
+
+  AsyncLog () : mEnqueuePos(0), mDropped(0), mStop(0), mDequeuePos(0), mFile(0), mLastTime(0) {
+    for (int f = 0; f < Slots; f++) mRing[f].seq = f;
+    mTimeBuf[0] = 0;
+  }
+
+  void addLine (const char *fmt, va_list ap) {
+    char buf[SlotSize];
+    va_list aq;
+    va_copy(aq, ap);
+    int len = vsnprintf(buf, SlotSize, fmt, aq);
+    va_end(aq);
+    if (len < 0) return;
+    if (len < SlotSize) {
+      int pos = claim(1);
+      if (pos < 0) return;
+      Slot *slot = &mRing[pos & (Slots-1)];
+      slot->time = time(0);
+      slot->more = false;
+      memcpy(slot->text, buf, len+1);
+      slot->seq.fetchAndStoreRelease(pos+1);
+      return;
+    }
+
+    // long line: every slot but the last one carries SlotSize-1 bytes
+    const int chunk = SlotSize-1;
+    QByteArray text(len, 0);
+    vsnprintf(text.data(), len+1, fmt, ap);
+    int n = (len+chunk-1)/chunk;
+    if (n > MaxLineSlots) {
+      n = MaxLineSlots;
+      len = n*chunk;
+      memcpy(text.data()+len-3, "...", 3);
+    }
+    int pos = claim(n);
+    if (pos < 0) return;
+    time_t now = time(0);
+    for (int f = 0; f < n; f++) {
+      Slot *slot = &mRing[(pos+f) & (Slots-1)];
+      int size = qMin(chunk, len-f*chunk);
+      slot->time = now;
+      slot->more = f < n-1;
+      memcpy(slot->text, text.constData()+f*chunk, size);
+      slot->text[size] = 0;
+      slot->seq.fetchAndStoreRelease(pos+f+1);
+    }
+  }
+
+  /// Writes everything queued so far and stops the thread
+  void flush () {
+    if (!isRunning()) return;
+    mStop = 1;
+    wait();
+    writeQueued();
+    mStop = 0;
+  }
+
+protected:
+  void run () {
+    while (!mStop) {
+      if (!writeQueued()) msleep(50);
+    }
+  }
+
+private:
+  struct Slot {
+    QAtomicInt seq; // index of the line the slot is ready for (+1 when filled)
+    time_t time;
+    bool more;      // text goes on in the next slot
+    char text[SlotSize];
+  };
+
+  // claims @a n adjacent slots; returns position of the first one or -1
+  // (and counts the line as dropped) if the ring is full
+  int claim (int n) {
+    int pos = mEnqueuePos;
+    for (;;) {
+      // the writer frees slots in order, so the last one is free only when
+      // all the others are
+      Slot *last = &mRing[(pos+n-1) & (Slots-1)];
+      int diff = (int)((unsigned)last->seq.fetchAndAddAcquire(0)-(unsigned)(pos+n-1));
+      if (!diff) {
+        if (mEnqueuePos.testAndSetRelaxed(pos, pos+n)) return pos;
+        pos = mEnqueuePos;
+      } else if (diff < 0) {
+        mDropped.ref();
+        return -1;
+      } else pos = mEnqueuePos;
+    }
+  }
+
+  // writes lines queued so far; returns false if there were none
+  bool writeQueued () {
+    int dropped = mDropped.fetchAndStoreAcquire(0);
+    Slot *slot = &mRing[mDequeuePos & (Slots-1)];
+    if (!dropped && slot->seq.fetchAndAddAcquire(0) != mDequeuePos+1) return false;
+    if (!mFile) mFile = fopen("debug.log", "a");
+    while (slot->seq.fetchAndAddAcquire(0) == mDequeuePos+1) {
+      if (mFile) {
+        if (slot->more) mLong.append(slot->text);
+        else if (!mLong.isEmpty()) {
+          mLong.append(slot->text);
+          writeLine(slot->time, mLong.constData());
+          mLong.clear();
+        } else writeLine(slot->time, slot->text);
+      }
+      slot->seq.fetchAndStoreRelease(mDequeuePos+Slots);
+      mDequeuePos++;
+      slot = &mRing[mDequeuePos & (Slots-1)];
+    }
+    if (mFile) {
+      if (dropped) fprintf(mFile, "%s(%i lines dropped)\n", mTimeBuf, dropped);
+      fflush(mFile);
+    }
+    return true;
+  }
+
+  void writeLine (time_t t, const char *text) {
+    if (t != mLastTime || !mTimeBuf[0]) {
+      struct tm bt;
+      localtime_r(&t, &bt);
+      sprintf(mTimeBuf, "%04i/%02i/%02i %02i:%02i:%02i: ",
+        bt.tm_year+1900, bt.tm_mon+1, bt.tm_mday,
+        bt.tm_hour, bt.tm_min, bt.tm_sec
+      );
+      mLastTime = t;
+    }
+    // every line of the text gets the timestamp
+    for (;;) {
+      const char *eol = strchr(text, '\n');
+      int len = eol ? eol-text : strlen(text);
+      if (!eol && !len) break;
+      fputs(mTimeBuf, mFile);
+      fwrite(text, 1, len, mFile);
+      fputc('\n', mFile);
+      if (!eol || !eol[1]) break;
+      text = eol+1;
+    }
+  }
+
+private:
+  Slot mRing[Slots];
+  QAtomicInt mEnqueuePos;
+  QAtomicInt mDropped;
+  volatile int mStop;
+  // writer thread only
+  int mDequeuePos;
+  FILE *mFile;
+  time_t mLastTime;
+  char mTimeBuf[64];
+  QByteArray mLong; // slots of a long line read so far
+};
+
+
+AsyncLog *sLog = 0;
+
+
+void flushAtExit () {
+  dlogFlush();
+}
+
+}
+
+
 void dlogS (const QString s) {
   QByteArray ba(s.toUtf8());
   dlogf("%s", ba.constData());
@@ -47,48 +232,18 @@ void dlogf (const char *fmt, ...) {
 
 
 void dlogfVA (const char *fmt, va_list ap) {
-  va_list ap2;
-  char buf[256];
-  char *xbuf = NULL;
-  char timebuf[128];
-  time_t t;
-  struct tm bt;
-
   if (!fmt || !allowDebugLog) return;
-
-  va_copy(ap2, ap);
-  int res = vsnprintf(buf, sizeof(buf)/sizeof(char), fmt, ap2);
-  va_end(ap2);
-  if (res > (int)(sizeof(buf)/sizeof(char))-1) { /*(int) for c++*/
-    xbuf = (char *)malloc((res+32)*sizeof(char));
-    if (!xbuf) return;
-    va_copy(ap2, ap);
-    res = vsnprintf(xbuf, res+31, fmt, ap2);
-    va_end(ap2);
-  } else xbuf = buf;
-
-  t = time(NULL);
-  localtime_r(&t, &bt);
-  sprintf(timebuf, "%04i/%02i/%02i %02i:%02i:%02i: ",
-    bt.tm_year+1900, bt.tm_mon, bt.tm_mday,
-    bt.tm_hour, bt.tm_min, bt.tm_sec
-  );
-
-  FILE *outfile = fopen("debug.log", "a");
-  if (outfile) {
-    fputs(timebuf, outfile);
-    char *p = xbuf;
-    while (*p) {
-      fputc(*p, outfile);
-      if (*p == '\n') {
-        if (p[1]) fputs(timebuf, outfile);
-      }
-      p++;
-    }
-    if (p > xbuf && p[-1] != '\n') fputc('\n', outfile);
-    fclose(outfile);
+  if (!sLog) {
+    // lines come from the game thread, so there is no race here
+    sLog = new AsyncLog;
+    atexit(flushAtExit);
   }
+  if (!sLog->isRunning()) sLog->start(QThread::LowPriority);
+  sLog->addLine(fmt, ap);
+}
+
 
-  if (xbuf != buf) free(xbuf);
+void dlogFlush () {
+  if (sLog) sLog->flush();
 }
 #endif
@@ -37,10 +37,13 @@ extern int allowDebugLog;
 void dlogS (const QString s);
 void dlogf (const char *fmt, ...) __attribute__((format(printf, 1, 2)));
 void dlogfVA (const char *fmt, va_list ap);
+/// Writes queued lines to debug.log now (lines are written in background)
+void dlogFlush ();
 #else
 # define dlogS(...)
 # define dlogf(...)
 # define dlogfVA(...)
+# define dlogFlush()
 #endif
 
 
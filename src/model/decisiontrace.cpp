@@ -0,0 +1,250 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "decisiontrace.h"
+
+
+static inline void put16 (uchar *p, quint16 v) {
+  p[0] = v & 0xff;
+  p[1] = v >> 8;
+}
+
+
+static inline void put32 (uchar *p, quint32 v) {
+  for (int f = 0; f < 4; f++, v >>= 8) p[f] = v & 0xff;
+}
+
+
+static inline quint16 get16 (const uchar *p) {
+  return p[0] | (p[1] << 8);
+}
+
+
+static inline quint32 get32 (const uchar *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((quint32)p[3] << 24);
+}
+
+
+static inline quint32 suitMask (int suit) {
+  return 0xffu << ((suit-1)*8);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+TraceRecord::TraceRecord () {
+  clear();
+}
+
+
+void TraceRecord::clear () {
+  memset(this, 0, sizeof(*this));
+  talon[0] = talon[1] = CardNone;
+  left = right = CardNone;
+}
+
+
+quint32 TraceRecord::legalCards (quint32 hand, CardId lead, int trump) {
+  if (!isValidCardId(lead)) return hand;
+  quint32 res = hand & suitMask(cardIdSuit(lead));
+  if (!res && trump >= 1 && trump <= 4) res = hand & suitMask(trump);
+  return res ? res : hand;
+}
+
+
+void TraceRecord::pack (uchar *buf) const {
+  memset(buf, 0, RecordSize);
+  put32(buf, deal);
+  put32(buf+4, usec);
+  buf[8] = kind;
+  buf[9] = seat;
+  buf[10] = engine;
+  buf[11] = flags;
+  for (int f = 0; f < 3; f++) put32(buf+12+f*4, hands[f]);
+  buf[24] = talon[0];
+  buf[25] = talon[1];
+  buf[26] = game;
+  buf[27] = declarer;
+  buf[28] = first;
+  for (int f = 0; f < 3; f++) buf[29+f] = games[f];
+  buf[32] = left;
+  buf[33] = right;
+  put32(buf+34, legal);
+  buf[38] = chosen;
+  buf[39] = options;
+  buf[40] = passCount;
+  put16(buf+42, maxPool);
+  for (int f = 0; f < 3; f++) put16(buf+44+f*2, pools[f]);
+  buf[50] = playCount;
+  memcpy(buf+51, play, playCount);
+  put32(buf+84, aiSeed);
+}
+
+
+void TraceRecord::unpack (const uchar *buf) {
+  clear();
+  deal = get32(buf);
+  usec = get32(buf+4);
+  kind = buf[8];
+  seat = buf[9];
+  engine = buf[10];
+  flags = buf[11];
+  for (int f = 0; f < 3; f++) hands[f] = get32(buf+12+f*4);
+  talon[0] = buf[24];
+  talon[1] = buf[25];
+  game = buf[26];
+  declarer = buf[27];
+  first = buf[28];
+  for (int f = 0; f < 3; f++) games[f] = buf[29+f];
+  left = buf[32];
+  right = buf[33];
+  legal = get32(buf+34);
+  chosen = buf[38];
+  options = buf[39];
+  passCount = buf[40];
+  maxPool = (qint16)get16(buf+42);
+  for (int f = 0; f < 3; f++) pools[f] = (qint16)get16(buf+44+f*2);
+  playCount = qMin((int)buf[50], (int)MaxPlay);
+  memcpy(play, buf+51, playCount);
+  aiSeed = get32(buf+84);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+const char TraceWriter::Magic[4] = { 'O', 'P', 'D', 'T' };
+
+
+TraceWriter::TraceWriter () {
+}
+
+
+TraceWriter::~TraceWriter () {
+  close();
+}
+
+
+bool TraceWriter::open (const QString &fileName) {
+  close();
+  mFile.setFileName(fileName);
+  if (!mFile.open(QIODevice::ReadWrite)) return false;
+  uchar hdr[HeaderSize];
+  qint64 size = mFile.size();
+  if (size < HeaderSize) {
+    memset(hdr, 0, sizeof(hdr));
+    memcpy(hdr, Magic, 4);
+    put16(hdr+4, Version);
+    put16(hdr+6, TraceRecord::RecordSize);
+    if (!mFile.resize(0) || mFile.write((const char *)hdr, HeaderSize) != HeaderSize) {
+      mFile.close();
+      return false;
+    }
+  } else {
+    if (mFile.read((char *)hdr, HeaderSize) != HeaderSize || memcmp(hdr, Magic, 4) ||
+        get16(hdr+4) != Version || get16(hdr+6) != TraceRecord::RecordSize) {
+      mFile.close();
+      return false;
+    }
+    qint64 torn = (size-HeaderSize)%TraceRecord::RecordSize;
+    if (torn && !mFile.resize(size-torn)) {
+      mFile.close();
+      return false;
+    }
+  }
+  mFile.flush();
+  return mFile.seek(mFile.size());
+}
+
+
+void TraceWriter::close () {
+  if (!mFile.isOpen()) return;
+  flush();
+  mFile.close();
+}
+
+
+void TraceWriter::append (const TraceRecord &rec) {
+  if (!mFile.isOpen()) return;
+  int ofs = mBuf.size();
+  mBuf.resize(ofs+TraceRecord::RecordSize);
+  rec.pack((uchar *)mBuf.data()+ofs);
+}
+
+
+bool TraceWriter::flush () {
+  if (!mFile.isOpen()) return false;
+  if (mBuf.isEmpty()) return true;
+  bool ok = mFile.write(mBuf) == mBuf.size();
+  mBuf.resize(0);
+  return mFile.flush() && ok;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+TraceReader::TraceReader () : mData(0), mCount(0) {
+}
+
+
+TraceReader::~TraceReader () {
+  close();
+}
+
+
+bool TraceReader::open (const QString &fileName) {
+  close();
+  mFile.setFileName(fileName);
+  if (!mFile.open(QIODevice::ReadOnly)) return false;
+  uchar hdr[TraceWriter::HeaderSize];
+  if (mFile.read((char *)hdr, sizeof(hdr)) != (qint64)sizeof(hdr) ||
+      memcmp(hdr, TraceWriter::Magic, 4) || get16(hdr+4) != TraceWriter::Version ||
+      get16(hdr+6) != TraceRecord::RecordSize) {
+    mFile.close();
+    return false;
+  }
+  qint64 cnt = (mFile.size()-TraceWriter::HeaderSize)/TraceRecord::RecordSize;
+  mCount = (int)qMin(cnt, (qint64)INT_MAX);
+  if (mCount > 0) mData = mFile.map(0, TraceWriter::HeaderSize+(qint64)mCount*TraceRecord::RecordSize);
+  return true;
+}
+
+
+void TraceReader::close () {
+  if (mData) mFile.unmap((uchar *)mData);
+  mData = 0;
+  mCount = 0;
+  if (mFile.isOpen()) mFile.close();
+}
+
+
+bool TraceReader::record (int idx, TraceRecord *rec) {
+  if (idx < 0 || idx >= mCount) return false;
+  qint64 ofs = TraceWriter::HeaderSize+(qint64)idx*TraceRecord::RecordSize;
+  if (mData) {
+    rec->unpack(mData+ofs);
+    return true;
+  }
+  uchar buf[TraceRecord::RecordSize];
+  if (!mFile.seek(ofs) || mFile.read((char *)buf, sizeof(buf)) != (qint64)sizeof(buf)) return false;
+  rec->unpack(buf);
+  return true;
+}
@@ -0,0 +1,154 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef DECISIONTRACE_H
+#define DECISIONTRACE_H
+
+#include <QByteArray>
+#include <QFile>
+
+#include "cardid.h"
+
+/**
+ * @struct TraceRecord
+ *
+ * One decision of a player with everything needed to ask another engine
+ * the same question. On disk it takes RecordSize bytes (little-endian):
+ * @code
+ *  0  deal        u32, PrefModel::dealNo()
+ *  4  usec        u32, decision time
+ *  8  kind, seat, engine  (see DealRecord::DecisionKind and Engine)
+ * 11  flags
+ * 12  hands       3 x u32 card masks before the decision (players 1..3)
+ * 24  talon       2 x CardId
+ * 26  game        contract being played (bidding: undefined)
+ * 27  declarer    0 if none yet
+ * 28  first       first bidder
+ * 29  games       3 x eGameBid of players before the decision
+ * 32  left, right arguments of the decision: cards on the table for moves
+ *                 (CardNone for none), bids of other players for bids
+ * 34  legal       u32 mask of legal cards (moves only)
+ * 38  chosen      card id, bid, game or 0/1 for closed whist
+ * 39  options     Opt* bits
+ * 40  passCount   PrefModel::optPassCount
+ * 41  reserved
+ * 42  maxPool     i16
+ * 44  pools       3 x i16
+ * 50  playCount, play[30]: cards played in the deal so far, id | who << 5
+ * 81  reserved
+ * 84  aiSeed      u32, seed of the AI random streams for the decision
+ * 88  reserved
+ * @endcode
+ */
+struct TraceRecord {
+  enum { RecordSize = 96, MaxPlay = 30 };
+  enum { FlagPassOut = 1, FlagClosedWhist = 2, FlagFirstBidder = 4 };
+  enum {
+    OptStalingrad = 1, Opt10Whist = 2, OptWhistGreedy = 4, OptAggPass = 8, OptWithoutThree = 16
+  };
+
+  TraceRecord ();
+  void clear ();
+
+  void addPlay (int who, CardId id) { if (playCount < MaxPlay) play[playCount++] = id | who << 5; }
+
+  void pack (uchar *buf) const;
+  void unpack (const uchar *buf);
+
+  /// Cards of @a hand which may follow @a lead (CardNone: any card); @a trump is a suit or 0
+  static quint32 legalCards (quint32 hand, CardId lead, int trump);
+
+  quint32 deal;
+  quint32 usec;
+  quint8 kind;
+  quint8 seat;
+  quint8 engine;
+  quint8 flags;
+  quint32 hands[3];
+  CardId talon[2];
+  quint8 game;
+  quint8 declarer;
+  quint8 first;
+  quint8 games[3];
+  quint8 left, right;
+  quint32 legal;
+  quint8 chosen;
+  quint8 options;
+  quint8 passCount;
+  qint16 maxPool;
+  qint16 pools[3];
+  quint8 playCount;
+  quint8 play[MaxPlay];
+  quint32 aiSeed;
+};
+
+/**
+ * @class TraceWriter decisiontrace.h
+ * @brief Append-only file of decision records
+ *
+ * Same layout as deal archive: 16-byte header and fixed size records.
+ * Records are collected in memory and written by flush(), which the model
+ * calls once a deal; a trace of another version is not appended to.
+ */
+class TraceWriter {
+public:
+  TraceWriter ();
+  ~TraceWriter ();
+
+  bool open (const QString &fileName);
+  void close ();
+  bool isOpen () const { return mFile.isOpen(); }
+
+  void append (const TraceRecord &rec);
+  bool flush ();
+
+  static const char Magic[4];
+  enum { HeaderSize = 16, Version = 1 };
+
+private:
+  QFile mFile;
+  QByteArray mBuf;
+};
+
+/**
+ * @class TraceReader decisiontrace.h
+ * @brief Read-only random access to decision trace
+ */
+class TraceReader {
+public:
+  TraceReader ();
+  ~TraceReader ();
+
+  bool open (const QString &fileName);
+  void close ();
+
+  int count () const { return mCount; }
+  bool record (int idx, TraceRecord *rec);
+
+private:
+  QFile mFile;
+  const uchar *mData;
+  int mCount;
+};
+
+
+#endif
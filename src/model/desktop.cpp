@@ -21,6 +21,7 @@
  */
 
 #include <limits.h>
+#include <string.h>
 
 #include "prfconst.h"
 
@@ -31,13 +32,18 @@
 #include "aialphabeta.h"
 #include "aiplayer.h"
 #include "baser.h"
+#include "claimcheck.h"
+#include "prng.h"
 #include "debug.h"
+#include "decisiontrace.h"
 #include "deskview.h"
 #include "ncounter.h"
 #include "player.h"
 #include "desktop.h"
 #include "scoreboard.h"
+#include "searchstats.h"
 #include "human.h"
+#include "monoclock.h"
 
 /*enum GameStage {
 	Bidding,
@@ -47,52 +53,6 @@
 
 GameStage gameStage = Bidding;*/
 
-typedef struct {
-  int mount, pool, leftWh, rightWh;
-} tScores;
-
-static QHash<int, const char *> gameNames;
-
-const char * sGameName (eGameBid game)
-{
-  if(gameNames.isEmpty()) {
-  gameNames[g86catch] = " ";
-  gameNames[raspass] = "pass-out";
-  gameNames[undefined] = "-----";
-  gameNames[whist] = "whist";
-  gameNames[halfwhist] = "halfwhist";
-  gameNames[gtPass] = "pass";
-  gameNames[g61] = "6\1s";
-  gameNames[g62] = "6\1c";
-  gameNames[g63] = "6\1d";
-  gameNames[g64] = "6\1h";
-  gameNames[g65] = "6NT";
-  gameNames[g71] = "7\1s";
-  gameNames[g72] = "7\1c";
-  gameNames[g73] = "7\1d";
-  gameNames[g74] = "7\1h";
-  gameNames[g75] = "7NT";
-  gameNames[g81] = "8\1s";
-  gameNames[g82] = "8\1c";
-  gameNames[g83] = "8\1d";
-  gameNames[g84] = "8\1h";
-  gameNames[g85] = "8NT";
-  gameNames[g86] = "Misere";
-  gameNames[g91] = "9\1s";
-  gameNames[g92] = "9\1c";
-  gameNames[g93] = "9\1d";
-  gameNames[g94] = "9\1h";
-  gameNames[g95] = "9NT";
-  gameNames[g101] = "10\1s";
-  gameNames[g102] = "10\1c";
-  gameNames[g103] = "10\1d";
-  gameNames[g104] = "10\1h";
-  gameNames[g105] = "10NT";
-  gameNames[zerogame] = "";
-  }
-  return gameNames[game];
-}
-
 const QString PrefModel::bidMessage(const eGameBid game)
 {
         if (game == whist) return tr("whist");
@@ -104,70 +64,54 @@ const QString PrefModel::bidMessage(const eGameBid game)
 }
 
 
-static int whoseTrick (Card *p1, Card *p2, Card *p3, int trump) {
-  Q_ASSERT(p1 != 0);
-  Q_ASSERT(p2 != 0);
-  Q_ASSERT(p3 != 0);
-  // The next assert doesn't work because of dirty hack passing values > 4 here
-  //Q_ASSERT((trump >= 0) && (trump <= 4)); // 0 is no trumps
-  Card *maxC = p1;
-  int res = 1;
-  if ((maxC->suit() == p2->suit() && maxC->face() < p2->face()) || (maxC->suit() != trump && p2->suit() == trump)) {
-    maxC = p2;
-    res = 2;
-  }
-  if ((maxC->suit() == p3->suit() && maxC->face() < p3->face()) || (maxC->suit() != trump && p3->suit() == trump)) {
-    maxC = p3;
-    res = 3;
-  }
-  return res;
-}
-
-/// @todo move to Card class
-static void cardName (char *dest, const Card *c) {
+static void cardName (char *dest, CardId id) {
   Q_ASSERT(dest != 0);
-  Q_ASSERT(c != 0);
-  static const char *faceN[] = {" 7"," 8"," 9","10"," J"," Q"," K"," A"};
-  static const char *suitN[] = {"S","C","D","H"};
-  if (!c) { strcat(dest, "..."); return; }
-  int face = c->face(), suit = c->suit();
-  if (face >= 7 && face <= FACE_ACE && suit >= 1 && suit <= 4) {
-    strcat(dest, faceN[face-7]);
-    strcat(dest, suitN[suit-1]);
-    return;
-  }
-  strcat(dest, "???");
+  if (id == CardNone) { strcat(dest, "..."); return; }
+  strcat(dest, cardIdName(id));
 }
 
 /// @todo move to CardList class
 static void dumpCardList (char *dest, const CardList &lst) {
   CardList tmp(lst); tmp.mySort();
   for (int f = 0; f < tmp.size(); f++) {
-    Card *c = tmp.at(f);
-    if (!c) continue;
+    CardId id = tmp.idAt(f);
+    if (id == CardNone) continue;
     strcat(dest, " ");
-    cardName(dest, c);
+    cardName(dest, id);
   }
 }
 
 
 void PrefModel::initPlayers() {
+  // score sheets survive, so runGame() continues a loaded pool
+  QList<Player *> old(mPlayers);
   mPlayers.clear();
   mPlayers << 0; // 0th player is nobody
 
-  mPlayers << new HumanPlayer(1, this);
-  if (!optAlphaBeta1)
-    mPlayers << new AiPlayer(2, this);
-  else 
-    mPlayers << new AlphaBetaPlayer(2, this);
-  if (!optAlphaBeta2)
-    mPlayers << new AiPlayer(3, this);
-  else 
-    mPlayers << new AlphaBetaPlayer(3, this);
+  if (mEngines[0] != DealRecord::EngineUnknown) {
+    for (int f = 1; f <= 3; f++) {
+      if (mEngines[f-1] == DealRecord::EngineAlphaBeta) mPlayers << new AlphaBetaPlayer(f, this);
+      else mPlayers << new AiPlayer(f, this);
+    }
+  } else {
+    mPlayers << new HumanPlayer(1, this);
+    if (!optAlphaBeta1)
+      mPlayers << new AiPlayer(2, this);
+    else 
+      mPlayers << new AlphaBetaPlayer(2, this);
+    if (!optAlphaBeta2)
+      mPlayers << new AiPlayer(3, this);
+    else 
+      mPlayers << new AlphaBetaPlayer(3, this);
+  }
     
   mPlayers[1]->setNick(optHumanName);  
   mPlayers[2]->setNick(optPlayerName1);
   mPlayers[3]->setNick(optPlayerName2);
+
+  for (int f = 1; f < old.size(); f++) mPlayers[f]->mScore = old[f]->mScore;
+  // a game loaded while another one runs leaves players to the running one
+  if (!mGameRunning) foreach (Player *p, old) delete p;
 }
 
 
@@ -180,8 +124,9 @@ PrefModel::PrefModel (DeskView *aDeskView) : QObject(0), mPlayingRound(false),
  optAlphaBeta1(false),
  optPlayerName2("Player 2"),
  optAlphaBeta2(false),
- m_closedWhist(false),
- m_keepLog(true)
+ optClaim(false),
+ m_closedWhist(false), mDealInProgress(false), mResumeDeal(false), mDecisionNo(0), mReplayCount(0),
+ mInDecision(false), mAiSeed(0), mResumeRng(false), mResumeInDecision(false)
 {
   #if defined Q_WS_X11 || defined Q_WS_QWS || defined Q_WS_MAC
 	QString optHumanName = getenv("USER");
@@ -193,8 +138,17 @@ PrefModel::PrefModel (DeskView *aDeskView) : QObject(0), mPlayingRound(false),
   nCurrentStart.nValue = nCurrentMove.nValue = (qrand()%3)+1;
   nCurrentStart.nMin = nCurrentMove.nMin = 1;
   nCurrentStart.nMax = nCurrentMove.nMax = 3;
-  mCardsOnDesk[0] = mCardsOnDesk[1] = mCardsOnDesk[2] = mCardsOnDesk[3] = 0;
+  m_seed = ((quint64)qrand() << 32) ^ ((quint64)qrand() << 16) ^ qrand();
+  m_tableNo = 0;
+  m_dealNo = 0;
+  mCardsOnDesk[0] = mCardsOnDesk[1] = mCardsOnDesk[2] = mCardsOnDesk[3] = CardNone;
+  mPlayerBids[0] = mPlayerBids[1] = mPlayerBids[2] = mPlayerBids[3] = undefined;
+  m_outCards = 0;
   mOnDeskClosed = false;
+  mPlayerActive = 0;
+  mEngines[0] = mEngines[1] = mEngines[2] = DealRecord::EngineUnknown;
+  mHasNextDeal = false;
+  m_currentGame = undefined;
   initPlayers();
 }
 
@@ -223,39 +177,11 @@ int PrefModel::gameWhists (eGameBid gType) const
 void PrefModel::closePool () {
   if(!mGameRunning)
     return;
-  WrapCounter counter(1, 1, 3);
-  int i;
-  tScores R[4];
-  for (i = 1; i <= 3; i++) {
-    Player *G = player(i);
-    R[i].mount = G->mScore.mountain();
-    R[i].pool = G->mScore.pool();
-    R[i].leftWh = G->mScore.leftWhists();
-    R[i].rightWh = G->mScore.rightWhists();
-  }
-  // svou pulu sebe v visti
-  for (i = 1; i <= 3;i++) {
-    R[i].leftWh += R[i].pool*10/3;
-    R[i].rightWh += R[i].pool*10/3;
-  }
-  // goru - drugim na sebya
-  for (i = 1; i <= 3; i++) {
-    counter.nValue = i;
-    ++counter;
-    R[counter.nValue].rightWh += R[i].mount*10/3;
-    ++counter;
-    R[counter.nValue].leftWh += R[i].mount*10/3;
-  }
-  // schitaem visti
-  for (i = 1; i <= 3; i++) {
-    int i1, i2;
-    counter.nValue = i;
-    ++counter;
-    i1 = counter.nValue;
-    ++counter;
-    i2 = counter.nValue;
-    player(i)->mScore.setScore(R[i].leftWh+R[i].rightWh-R[i1].rightWh-R[i2].leftWh);
-  }
+  const ScoreBoard *boards[3];
+  int scores[3];
+  for (int i = 1; i <= 3; i++) boards[i-1] = &player(i)->mScore;
+  ScoreBoard::settle(boards, scores);
+  for (int i = 1; i <= 3; i++) player(i)->mScore.setScore(scores[i-1]);
 }
 
 
@@ -266,6 +192,15 @@ Card *PrefModel::makeGameMove (Card *lMove, Card *rMove, bool isPassOut) {
   Card *res = 0;
   Player *curPlr = player(nCurrentMove);
   Player *plr = 0;
+  int chosen;
+  if (replayedDecision(&chosen)) {
+    res = cardFromId(chosen);
+    curPlr->mCards.remove(res);
+    curPlr->mCardsOut.insert(res);
+    recordDecision(curPlr, nCurrentMove.nValue, DealRecord::DecMove, 0, chosen);
+    return res;
+  }
+
   // 1. Current player is not human
   // Human's move if current he whists with open cards or catches misere, and current player
   // passes or catches misere
@@ -297,20 +232,105 @@ Card *PrefModel::makeGameMove (Card *lMove, Card *rMove, bool isPassOut) {
     *plr = *curPlr;
     mPlayers[nCurrentMove.nValue] = plr;
     qDebug() << plr->type() << " plays for " << nCurrentMove.nValue;
+    quint64 start = beginDecision(DealRecord::DecMove, nCurrentMove.nValue, cardId(lMove), cardId(rMove));
     res = plr->makeMove(lMove, rMove, player(nextPlayer(nCurrentMove)),
       player(previousPlayer(nCurrentMove)), isPassOut);
+    recordDecision(plr, nCurrentMove.nValue, DealRecord::DecMove, start, cardId(res));
     *curPlr = *plr;
     mPlayers[nCurrentMove.nValue] = curPlr;
     delete plr;
   } else {
     // No swaps, current player makes move himself
+    quint64 start = beginDecision(DealRecord::DecMove, nCurrentMove.nValue, cardId(lMove), cardId(rMove));
     res = curPlr->makeMove(lMove, rMove, player(nextPlayer(nCurrentMove)),
       player(previousPlayer(nCurrentMove)), isPassOut);
+    recordDecision(curPlr, nCurrentMove.nValue, DealRecord::DecMove, start, cardId(res));
   }
   return res;
 }
 
 
+eGameBid PrefModel::makeGameBid (Player *plr, eGameBid lMove, eGameBid rMove) {
+  quint64 start = beginDecision(DealRecord::DecBid, plr->number(), lMove, rMove);
+  eGameBid res;
+  int chosen;
+  if (replayedDecision(&chosen)) {
+    res = (eGameBid)chosen;
+    plr->setGame(res);
+  } else
+    res = plr->makeBid(lMove, rMove);
+  recordDecision(plr, plr->number(), DealRecord::DecBid, start, res);
+  return res;
+}
+
+
+eGameBid PrefModel::makeGameDrop (Player *plr) {
+  quint64 start = beginDecision(DealRecord::DecDrop, plr->number());
+  eGameBid res;
+  int chosen;
+  quint32 before = plr->mCards.mask();
+  if (replayedDecision(&chosen)) {
+    res = (eGameBid)chosen;
+    plr->dropCards(mDecisions[mDecisionNo].cards);
+    // "without three" is an answer to the whisters, the contract stays
+    if (res != withoutThree) plr->setGame(res);
+  } else
+    res = plr->makeDrop();
+  recordDecision(plr, plr->number(), DealRecord::DecDrop, start, res);
+  mDecisions[mDecisionNo-1].cards = before & ~plr->mCards.mask();
+  return res;
+}
+
+
+eGameBid PrefModel::makeGameFinalBid (Player *plr, eGameBid maxGame, int nPlayerPass) {
+  quint64 start = beginDecision(DealRecord::DecFinalBid, plr->number());
+  int chosen;
+  if (replayedDecision(&chosen)) plr->setGame((eGameBid)chosen);
+  else plr->makeFinalBid(maxGame, nPlayerPass);
+  recordDecision(plr, plr->number(), DealRecord::DecFinalBid, start, plr->game());
+  return plr->game();
+}
+
+
+bool PrefModel::makeGameClosedWhist (Player *plr) {
+  quint64 start = beginDecision(DealRecord::DecClosedWhist, plr->number());
+  int chosen;
+  bool res = replayedDecision(&chosen) ? chosen : plr->chooseClosedWhist();
+  recordDecision(plr, plr->number(), DealRecord::DecClosedWhist, start, res);
+  return res;
+}
+
+
+// True while a resumed deal replays its saved decisions; @a chosen gets the next one
+bool PrefModel::replayedDecision (int *chosen) const {
+  if (!replaying()) return false;
+  *chosen = mDecisions[mDecisionNo].chosen;
+  return true;
+}
+
+
+void PrefModel::setEngines (int e1, int e2, int e3) {
+  mEngines[0] = e1;
+  mEngines[1] = e2;
+  mEngines[2] = e3;
+  initPlayers();
+}
+
+
+void PrefModel::setNextDeal (const PresetDeal &deal) {
+  mNextDeal = deal;
+  mHasNextDeal = true;
+}
+
+
+void PrefModel::setSeed (quint64 seed, int table) {
+  m_seed = seed;
+  m_tableNo = table;
+  m_dealNo = 0;
+  nCurrentStart.nValue = nCurrentMove.nValue = Prng::forDeal(seed, table, 0).bounded(3)+1;
+}
+
+
 int PrefModel::playerWithMaxPool () {
   int MaxBullet= -1,CurrBullet=-1,res=0;
   for (int i =1 ;i<=3;i++) {
@@ -339,7 +359,15 @@ inline Player *PrefModel::player (const WrapCounter &cnt) {
 Card *PrefModel::cardOnDesk(int num) const
 {
   Q_ASSERT(num >= 0 && num <= 3);
-  return mCardsOnDesk[num];
+  return cardFromId(mCardsOnDesk[num]);
+}
+
+
+quint32 PrefModel::talonMask () const {
+  if (mDeck.count() < 32) return 0;
+  quint32 res = 0;
+  for (int f = 30; f < 32; f++) res |= cardIdMask(mDeck.idAt(f));
+  return res;
 }
 
 
@@ -386,7 +414,24 @@ bool PrefModel::saveGame (const QString & name)  {
 }
 
 
+/*
+ * Saved game: "OPRF", format version, then the version 0 part (files
+ * written before the header have only this): score sheets, dealer and
+ * conventions. Version 1 adds the other conventions, the deal stream
+ * (seed, table, deal number) and, if a deal was in progress, its deck in
+ * order of dealing. Version 2 adds the rest of the deal in progress:
+ * every decision made in it (chosen value, dropped cards, time, engine),
+ * whether one is being made, its AI seed and the state of the AI stream.
+ * Hands, drop, bids, cards on desk and tricks follow from the deck and
+ * the decisions; runGame() gets them back by replaying the decisions.
+ */
+static const char sSaveMagic[4] = { 'O', 'P', 'R', 'F' };
+enum { SaveVersion = 2 };
+
+
 void PrefModel::serialize (QByteArray &ba) {
+  serializeBytes(ba, sSaveMagic, 4);
+  serializeInt(ba, SaveVersion);
   for (int f = 1; f <= 3; f++) {
     Player *plr = player(f);
     plr->mScore.serialize(ba);
@@ -396,10 +441,54 @@ void PrefModel::serialize (QByteArray &ba) {
   serializeInt(ba, optStalingrad);
   serializeInt(ba, opt10Whist);
   serializeInt(ba, optWhistGreedy);
+  // version 1
+  const int opts[5] = { optQuitAfterMaxRounds, optMaxRounds, optAggPass, optPassCount, optWithoutThree };
+  char *d = serializeGrow(ba, sizeof(opts));
+  for (int f = 0; f < 5; f++) storeInt(d+f*4, opts[f]);
+  serializeInt64(ba, m_seed);
+  serializeInt(ba, m_tableNo);
+  serializeInt(ba, m_dealNo);
+  serializeInt(ba, mDealInProgress);
+  if (!mDealInProgress) return;
+
+  // once it was dealt, the deck is in order of hands, so put it back into
+  // order of dealing
+  CardList deck(mDeck);
+  if (mDealRec.hands[0] | mDealRec.hands[1] | mDealRec.hands[2]) {
+    PresetDeal deal;
+    for (int f = 0; f < 3; f++) deal.hands[f] = mDealRec.hands[f];
+    deal.talon[0] = mDealRec.talon[0];
+    deal.talon[1] = mDealRec.talon[1];
+    deal.toDeck(deck, nCurrentStart.nValue);
+  }
+  deck.serialize(ba);
+  // version 2
+  int cnt = mDecisions.size();
+  serializeInt(ba, cnt);
+  d = serializeGrow(ba, cnt*16+24);
+  for (int f = 0; f < cnt; f++, d += 16) {
+    const Decision &dec = mDecisions[f];
+    storeInt(d, dec.chosen);
+    storeInt(d+4, dec.cards);
+    storeInt(d+8, dec.usec);
+    storeInt(d+12, dec.engine);
+  }
+  // a replay not finished yet has the streams of the save it came from
+  quint32 rng[4];
+  if (mResumeRng) for (int f = 0; f < 4; f++) rng[f] = mResumeRngState[f];
+  else mAiRng.getState(rng);
+  storeInt(d, mResumeRng ? mResumeInDecision : mInDecision);
+  storeInt(d+4, mAiSeed);
+  for (int f = 0; f < 4; f++) storeInt(d+8+f*4, rng[f]);
 }
 
 
 bool PrefModel::unserialize (QByteArray &ba, int *pos) {
+  int version = 0;
+  if (*pos+8 <= ba.size() && !memcmp(ba.constData()+*pos, sSaveMagic, 4)) {
+    *pos += 4;
+    if (!unserializeInt(ba, pos, &version) || version > SaveVersion) return false;
+  }
   for (int f = 1; f <= 3; f++) {
     Player *plr = player(f);
     if (!plr->mScore.unserialize(ba, pos)) return false;
@@ -408,23 +497,97 @@ bool PrefModel::unserialize (QByteArray &ba, int *pos) {
   if (!unserializeInt(ba, pos, &t)) return false;
   nCurrentStart.nValue = t;
   if (!unserializeInt(ba, pos, &t)) return false;
-  optMaxPool = static_cast<bool>(t);
+  optMaxPool = t;
   if (!unserializeInt(ba, pos, &t)) return false;
   optStalingrad = static_cast<bool>(t);
   if (!unserializeInt(ba, pos, &t)) return false;
   opt10Whist = static_cast<bool>(t);
   if (!unserializeInt(ba, pos, &t)) return false;
   optWhistGreedy = static_cast<bool>(t);
+  mDealInProgress = mResumeDeal = mResumeRng = false;
+  if (version < 1) return true;
+
+  int opts[5];
+  for (int f = 0; f < 5; f++) if (!unserializeInt(ba, pos, &opts[f])) return false;
+  optQuitAfterMaxRounds = opts[0];
+  optMaxRounds = opts[1];
+  optAggPass = opts[2];
+  optPassCount = opts[3];
+  optWithoutThree = opts[4];
+  int inDeal;
+  if (!unserializeInt64(ba, pos, &m_seed)) return false;
+  if (!unserializeInt(ba, pos, &m_tableNo)) return false;
+  if (!unserializeInt(ba, pos, &m_dealNo)) return false;
+  if (!unserializeInt(ba, pos, &inDeal)) return false;
+  if (!inDeal) return true;
+
+  if (!mResumeDeck.unserialize(ba, pos)) return false;
+  mResumeDeal = mResumeDeck.count() == 32;
+  mDecisions.clear();
+  if (version < 2) return true; // the deal is played from its start
+
+  int cnt;
+  if (!unserializeInt(ba, pos, &cnt) || cnt < 0 || *pos+cnt*16+24 > ba.size()) return false;
+  const char *d = ba.constData()+*pos;
+  for (int f = 0; f < cnt; f++, d += 16) {
+    Decision dec;
+    dec.chosen = loadInt(d);
+    dec.cards = loadInt(d+4);
+    dec.usec = loadInt(d+8);
+    dec.engine = loadInt(d+12);
+    mDecisions << dec;
+  }
+  mResumeInDecision = loadInt(d);
+  mAiSeed = loadInt(d+4);
+  for (int f = 0; f < 4; f++) mResumeRngState[f] = loadInt(d+8+f*4);
+  *pos += cnt*16+24;
+  mResumeRng = mResumeDeal;
   return true;
 }
 
 
+void PrefModel::viewDraw (bool emitSignal) {
+  if (mDeskView) mDeskView->draw(emitSignal);
+}
+
+
+void PrefModel::viewDrawPool () {
+  if (mDeskView) mDeskView->drawPool();
+}
+
+
+void PrefModel::viewUpdate () {
+  if (mDeskView) mDeskView->update();
+}
+
+
+void PrefModel::viewSleep (int seconds) {
+  if (mDeskView && !replaying()) mDeskView->mySleep(seconds);
+}
+
+
+void PrefModel::viewAniSleep (int milliseconds) {
+  if (mDeskView && !replaying()) mDeskView->aniSleep(milliseconds);
+}
+
+
+void PrefModel::viewLongWait (int n) {
+  if (mDeskView && !replaying()) mDeskView->longWait(n);
+}
+
+
+void PrefModel::viewAnimateTrick (int plrNo, const QCardList &cards) {
+  if (mDeskView && !replaying()) mDeskView->animateTrick(plrNo, cards);
+}
+
+
+bool PrefModel::dealAnimation () const {
+  return mDeskView && mDeskView->optDealAnim && !replaying();
+}
+
+
 void PrefModel::runGame () {
-  eGameBid playerBids[4];
   initPlayers();
-  // Randomize
-  const QTime t = QTime::currentTime();
-  qsrand((double)t.minute()*t.msec()/(t.second()+1)*UINT_MAX/3600);
 
   mGameRunning = true;
   emit clearHint();
@@ -444,35 +607,56 @@ void PrefModel::runGame () {
     int nPassCounter = 0; // number of passes
     int elapsedTime = 0;
     QTime pt;
-    playerBids[3] = playerBids[2] = playerBids[1] = playerBids[0] = undefined;
-    mCardsOnDesk[0] = mCardsOnDesk[1] = mCardsOnDesk[2] = mCardsOnDesk[3] = 0;
+    mPlayerBids[3] = mPlayerBids[2] = mPlayerBids[1] = mPlayerBids[0] = undefined;
+    mCardsOnDesk[0] = mCardsOnDesk[1] = mCardsOnDesk[2] = mCardsOnDesk[3] = CardNone;
     mDeck.newDeck();
-    mDeck.shuffle();
-
-#ifndef QT_NO_DEBUG
-  {
-    QFile dbgD("dbg.deck");
-    QFile dbgDT("dbg.deck.txt");
-    if (dbgDT.open(QIODevice::ReadOnly)) {
-      mDeck.clear();
-      for (int f = 0; f < 32; f++) {
-        QByteArray ba(dbgDT.readLine());
-        Card *c = cardFromName(ba.constData());
-        Q_ASSERT(c != 0);
-        qDebug() << c->toString();
-        mDeck << c;
-        nCurrentStart.nValue = 1;
+    // a deal restored by unserialize() is dealt again from the saved deck
+    // and its decisions are replayed, see beginDecision()
+    if (!mResumeDeal) ++m_dealNo;
+    Prng rng = Prng::forDeal(m_seed, m_tableNo, m_dealNo);
+    mDeck.shuffle(rng);
+    const bool resumed = mResumeDeal;
+    if (mResumeDeal) {
+      mDeck = mResumeDeck;
+      mResumeDeal = false;
+    } else
+      mDecisions.clear();
+    mReplayCount = mDecisions.size();
+    mDecisionNo = 0;
+    mInDecision = false;
+    SearchStatsLog::instance().startDeal(m_dealNo);
+    // AI players draw from qrand(), let them follow the deal's stream too
+    qsrand(rng.next());
+    mAiRng = rng.split();
+    mDealRec.clear();
+    mTraceRec.clear();
+    mDealInProgress = true;
+
+    if (!resumed && mHasNextDeal) {
+      if (mNextDeal.first) nCurrentStart.nValue = mNextDeal.first;
+      mNextDeal.toDeck(mDeck, nCurrentStart.nValue);
+      mHasNextDeal = false;
+    } else if (!resumed && mDealSource.isOpen()) {
+      PresetDeal deal;
+      if (mDealSource.next(&deal)) {
+        if (deal.first) nCurrentStart.nValue = deal.first;
+        deal.toDeck(mDeck, nCurrentStart.nValue);
+      } else {
+        if (mDealSource.errorLine())
+          qWarning("broken deal at line %i of deal file", mDealSource.errorLine());
+        // the rest of the pool is dealt at random
+        mDealSource.close();
       }
-    } else if (dbgD.open(QIODevice::ReadOnly)) {
-      QByteArray ba(dbgD.readAll());
-      dbgD.close();
-      int pos = 0;
-      const bool result = mDeck.unserialize(ba, &pos);
-      Q_ASSERT(result);
-      nCurrentStart.nValue = 1;
-    } else if (allowDebugLog) {
+    }
+    if (mDealExport.isOpen()) {
+      PresetDeal deal;
+      deal.fromDeck(mDeck, nCurrentStart.nValue);
+      mDealExport.append(deal);
+    }
+#ifndef QT_NO_DEBUG
+    if (allowDebugLog) {
+      // deck of every round goes to file "01", "02", ...
       QString fns(QString::number(roundNo));
-      //roundNo++
       while (fns.length() < 2) fns.prepend('0');
       QFile fl(fns);
       if (fl.open(QIODevice::WriteOnly)) {
@@ -482,7 +666,6 @@ void PrefModel::runGame () {
         fl.close();
       }
     }
-  }
 #endif
 
     player(1)->clear();
@@ -500,36 +683,40 @@ void PrefModel::runGame () {
   mOnDeskClosed = true;
 
   /// @todo Probably this block should go to DeskView
-    mDeskView->draw();
+    viewDraw();
     {
-	  if (mDeskView->optDealAnim)
+	  if (dealAnimation())
 	  	player(1)->setInvisibleHand(true);
       for (int f = 0; f < 15; f++) {
         if (f == 4) {
           // talon
           tNo = tPos;
-          mCardsOnDesk[2] = mDeck.at(tPos++);
-          if (mDeskView->optDealAnim) { mDeskView->draw(); mDeskView->aniSleep(40); }
-          mCardsOnDesk[3] = mDeck.at(tPos++);
-          if (mDeskView->optDealAnim) { mDeskView->draw(); mDeskView->aniSleep(40); }
+          mCardsOnDesk[2] = mDeck.idAt(tPos++);
+          if (dealAnimation()) { viewDraw(); viewAniSleep(40); }
+          mCardsOnDesk[3] = mDeck.idAt(tPos++);
+          if (dealAnimation()) { viewDraw(); viewAniSleep(40); }
         }
         Player *plr = player(cc); cc = (cc%3)+1;
         plr->dealCard(mDeck.at(tPos)); tmpDeck << mDeck.at(tPos++);
         //if (optDealAnim) { draw(); mDeskView->aniSleep(40); }
         plr->dealCard(mDeck.at(tPos)); tmpDeck << mDeck.at(tPos++);
-        if (mDeskView->optDealAnim) { mDeskView->draw(); mDeskView->aniSleep(80); }
-        if (mDeskView->optDealAnim) { 
-          if (f%3 == 2) mDeskView->aniSleep(200);
+        if (dealAnimation()) { viewDraw(); viewAniSleep(80); }
+        if (dealAnimation()) { 
+          if (f%3 == 2) viewAniSleep(200);
         }
       }
-	  mDeskView->aniSleep(200);
-	  if (mDeskView->optDealAnim)
+	  viewAniSleep(200);
+	  if (dealAnimation())
 	  	player(1)->setInvisibleHand(false);
       tmpDeck << mDeck.at(tNo++);
       tmpDeck << mDeck.at(tNo);
       if (tmpDeck.count() != 32) abort();
       mDeck = tmpDeck;
-      mDeskView->draw();
+      for (int f = 1; f <= 3; f++) mDealRec.hands[f-1] = player(f)->mCards.mask();
+      mDealRec.talon[0] = mDeck.idAt(30);
+      mDealRec.talon[1] = mDeck.idAt(31);
+      mDealRec.first = nCurrentStart.nValue;
+      viewDraw();
     }
     /*if (!mDeskView->optDealAnim) {
       mDeskView->draw();
@@ -548,8 +735,8 @@ void PrefModel::runGame () {
       dlogf("hand %i:%s", plr->number(), xxBuf);
     }
     xxBuf[0] = 0;
-    cardName(xxBuf, mDeck.at(30));
-    cardName(xxBuf, mDeck.at(31));
+    cardName(xxBuf, mDeck.idAt(30));
+    cardName(xxBuf, mDeck.idAt(31));
     dlogf("talon: %s", xxBuf);
 
     //draw();
@@ -560,44 +747,45 @@ void PrefModel::runGame () {
       //      
       Player *currentPlayer = player(plrCounter);
       mPlayerHi = plrCounter.nValue;
-      if (playerBids[curBidIdx] != gtPass) {
+      if (mPlayerBids[curBidIdx] != gtPass) {
         currentPlayer->setMessage(tr("thinking..."));
-        mDeskView->draw(false);
+        viewDraw(false);
         if (currentPlayer->number() != 1)
-            mDeskView->mySleep(2);
+            viewSleep(2);
         else
-            mDeskView->update();
-        const eGameBid bid = playerBids[curBidIdx]
-                            = currentPlayer->makeBid(playerBids[curBidIdx%3+1], playerBids[(curBidIdx+1)%3+1]);
+            viewUpdate();
+        const eGameBid bid = mPlayerBids[curBidIdx]
+                            = makeGameBid(currentPlayer, mPlayerBids[curBidIdx%3+1], mPlayerBids[(curBidIdx+1)%3+1]);
         qDebug() << "bid:" << bid << bidMessage(bid);
+        mDealRec.addBid(bid);
         currentPlayer->setMessage(bidMessage(bid));
-        mDeskView->draw();
+        viewDraw();
       }
       ++plrCounter;
       curBidIdx = curBidIdx%3+1;
 
-      if ((playerBids[1] != undefined && playerBids[2] != undefined && playerBids[3] != undefined) &&
-          ((playerBids[1] == gtPass?1:0)+(playerBids[2] == gtPass?1:0)+(playerBids[3] == gtPass?1:0) >= 2)) break;
+      if ((mPlayerBids[1] != undefined && mPlayerBids[2] != undefined && mPlayerBids[3] != undefined) &&
+          ((mPlayerBids[1] == gtPass?1:0)+(mPlayerBids[2] == gtPass?1:0)+(mPlayerBids[3] == gtPass?1:0) >= 2)) break;
     }
     mPlayerHi = 0;
-    mDeskView->draw(false); //mDeskView->mySleep(0);
+    viewDraw(false); //mDeskView->mySleep(0);
 
     // calculate max game
     for (int i = 1; i <= 3; i++) {
-      if (playerBids[0] < playerBids[i]) playerBids[0] = playerBids[i];
+      if (mPlayerBids[0] < mPlayerBids[i]) mPlayerBids[0] = mPlayerBids[i];
     }
 
     // deliver talon and choose final bid (or pass-out if no player)
     mPlayerActive = 0;
     mPlayingRound = true;
-    if (playerBids[0] != gtPass) {
+    if (mPlayerBids[0] != gtPass) {
       // no pass-out
       optPassCount = 0;
 	  // who made maximal bid
       for (int i = 1; i <= 3; i++) {
         Player *currentPlayer = player(i);
-        if (currentPlayer->game() == playerBids[0]) {
-          QString gnS(sGameName(playerBids[0]));
+        if (currentPlayer->game() == mPlayerBids[0]) {
+          QString gnS(sGameName(mPlayerBids[0]));
           gnS.prepend("game: ");
           gnS += "; player: ";
           gnS += QString::number(i);
@@ -614,26 +802,26 @@ void PrefModel::runGame () {
           Player *PassOrVistPlayers;
           int PassOrVist = 0; //, nPassOrVist = 0;
           mOnDeskClosed = false;
-          mCardsOnDesk[2] = mDeck.at(30);
-          mCardsOnDesk[3] = mDeck.at(31);
+          mCardsOnDesk[2] = mDeck.idAt(30);
+          mCardsOnDesk[3] = mDeck.idAt(31);
           
 		  // trick with gCurrentGame - shows game on bidboard
-          m_currentGame = playerBids[0];
-          mDeskView->draw();
+          m_currentGame = mPlayerBids[0];
+          viewDraw();
           //drawBidWindows(bids4win, 0);
           if (currentPlayer->number() != 1)
               emit showHint(tr("Try to remember the cards"));
-      mDeskView->longWait(2);
+      viewLongWait(2);
 		  emit clearHint();
 		  // deal talon
           currentPlayer->dealCard(mDeck.at(30));
           currentPlayer->dealCard(mDeck.at(31));
           QCardList cAni;
           for (int f = 0; f < 4; f++) {
-            cAni.append(mCardsOnDesk[f]);
-            mCardsOnDesk[f] = 0;
+            cAni.append(cardFromId(mCardsOnDesk[f]));
+            mCardsOnDesk[f] = CardNone;
           }
-          mDeskView->animateTrick(mPlayerActive, cAni); // will clear mCardsOnDesk[]
+          viewAnimateTrick(mPlayerActive, cAni); // will clear mCardsOnDesk[]
 
           // throw away
           eGameBid maxBid = m_currentGame;
@@ -641,12 +829,12 @@ void PrefModel::runGame () {
           if (currentPlayer->game() != g86) {		//  not misere
             // not misere
             nCurrentMove.nValue = i;
-            mDeskView->draw();
+            viewDraw();
             if (mPlayerActive == 1)
                 emit showHint(tr("Select two cards to drop"));
             else
-				mDeskView->mySleep(2);
-            playerBids[0] = m_currentGame = currentPlayer->makeDrop();
+				viewSleep(2);
+            mPlayerBids[0] = m_currentGame = makeGameDrop(currentPlayer);
 			emit clearHint();
 			emitGameChanged(m_currentGame);
           } else {	// playing misere
@@ -654,29 +842,34 @@ void PrefModel::runGame () {
             int tempint = nCurrentMove.nValue;
             int nVisibleState = currentPlayer->invisibleHand();
             currentPlayer->setInvisibleHand(false);
-            mDeskView->draw(false);
+            viewDraw(false);
             if (!currentPlayer->isHuman())
                 emit showHint(tr("Try to remember the cards"));
             /*else 
 				tmpg->setMessage(tr("Misere"));*/
-            mDeskView->longWait(2);
-            mDeskView->draw(false);
+            viewLongWait(2);
+            viewDraw(false);
 
             currentPlayer->setInvisibleHand(nVisibleState);
             nCurrentMove.nValue = currentPlayer->number();
 
             if (mPlayerActive != 1) 
-				mDeskView->mySleep(2);
+				viewSleep(2);
 
-            playerBids[0] = m_currentGame = currentPlayer->makeDrop();
+            mPlayerBids[0] = m_currentGame = makeGameDrop(currentPlayer);
 			emit clearHint();
 			nCurrentMove.nValue = tempint;
           }		  	
           passOrWhistPlayersCounter.nValue = i;
+          {
+            quint32 drop = (mDealRec.hands[i-1] | talonMask()) & ~currentPlayer->mCards.mask();
+            for (CardId id = 0, n = 0; id < 32 && n < 2; id++)
+              if (drop & cardIdMask(id)) mDealRec.drop[n++] = id;
+          }
 
           // bid
           player(passOrWhistPlayersCounter)->setMessage(bidMessage(m_currentGame));
-          mDeskView->draw();
+          viewDraw();
 
         if (m_currentGame == withoutThree) {
             m_currentGame = maxBid;
@@ -689,7 +882,10 @@ void PrefModel::runGame () {
           ++passOrWhistPlayersCounter;
           PassOrVistPlayers = player(passOrWhistPlayersCounter);
           PassOrVistPlayers->setGame(undefined);
-          
+          // the second one hasn't decided yet either: his pass in the auction
+          // isn't an answer to this game
+          player(nextPlayer(passOrWhistPlayersCounter))->setGame(undefined);
+
 
           // choice of the first player
           int firstWhistPlayer = passOrWhistPlayersCounter.nValue;
@@ -698,10 +894,10 @@ void PrefModel::runGame () {
             && !(!opt10Whist && m_currentGame>=101 && m_currentGame<=105)
             && !(optStalingrad && m_currentGame == g61)) {
 			player(passOrWhistPlayersCounter)->setMessage(tr("thinking..."));
-			mDeskView->draw(false);
-			if (firstWhistPlayer != 1) mDeskView->mySleep(2);
+			viewDraw(false);
+			if (firstWhistPlayer != 1) viewSleep(2);
 		  }
-          PassOrVist = PassOrVistPlayers->makeFinalBid(m_currentGame, nPassCounter);
+          PassOrVist = makeGameFinalBid(PassOrVistPlayers, m_currentGame, nPassCounter);
           if (PassOrVistPlayers->game() == gtPass) {
             nPassCounter++;
             player(passOrWhistPlayersCounter)->setMessage(tr("pass"));
@@ -709,24 +905,24 @@ void PrefModel::runGame () {
             player(passOrWhistPlayersCounter)->setMessage("");
 		  else
 			player(passOrWhistPlayersCounter)->setMessage(tr("whist"));
-		  mDeskView->draw(false);
+		  viewDraw(false);
 
 
           // choice of the second player
           ++passOrWhistPlayersCounter;
           int secondWhistPlayer = passOrWhistPlayersCounter.nValue;
           mPlayerHi = secondWhistPlayer;
-		  mDeskView->draw(false);
+		  viewDraw(false);
 		  PassOrVistPlayers = player(passOrWhistPlayersCounter);
           PassOrVistPlayers->setGame(undefined);
           if ((m_currentGame != g86)
             && !(!opt10Whist && m_currentGame>=101 && m_currentGame<=105)
             && !(optStalingrad && m_currentGame == g61)) {
 			player(passOrWhistPlayersCounter)->setMessage(tr("thinking..."));
-			mDeskView->draw(false);
-			if (secondWhistPlayer != 1) mDeskView->mySleep(2);
+			viewDraw(false);
+			if (secondWhistPlayer != 1) viewSleep(2);
 		  }
-          PassOrVistPlayers->makeFinalBid(m_currentGame, nPassCounter);
+          makeGameFinalBid(PassOrVistPlayers, m_currentGame, nPassCounter);
           if (PassOrVistPlayers->game() == gtPass) {
             nPassCounter++;
             player(passOrWhistPlayersCounter)->setMessage(tr("pass"));
@@ -736,7 +932,7 @@ void PrefModel::runGame () {
 			player(passOrWhistPlayersCounter)->setMessage(tr("half of whist"));
 		  else
 			player(passOrWhistPlayersCounter)->setMessage(tr("whist"));
-		  mDeskView->draw(false);
+		  viewDraw(false);
 
 		  // if halfwhist, choice of the first player again
           if (player(secondWhistPlayer)->game() == halfwhist) {
@@ -744,9 +940,9 @@ void PrefModel::runGame () {
 			mPlayerHi = firstWhistPlayer;
 			PassOrVistPlayers = player(firstWhistPlayer);
 			PassOrVistPlayers->setMessage(tr("thinking..."));
-			mDeskView->draw(false);			
-			if (firstWhistPlayer != 1) mDeskView->mySleep(2);
-            PassOrVist = PassOrVistPlayers->makeFinalBid(m_currentGame, 2);	// no more halfwhists!
+			viewDraw(false);			
+			if (firstWhistPlayer != 1) viewSleep(2);
+            PassOrVist = makeGameFinalBid(PassOrVistPlayers, m_currentGame, 2);	// no more halfwhists!
             if (PassOrVistPlayers->game() == gtPass) {
                 player(firstWhistPlayer)->setMessage(tr("pass"));
           	}
@@ -754,14 +950,14 @@ void PrefModel::runGame () {
 				player(firstWhistPlayer)->setMessage(tr("whist"));
                 player(secondWhistPlayer)->setGame(gtPass);
 			}
-			mDeskView->draw(false);
+			viewDraw(false);
 		  }
 		  
           mPlayerHi = 0;
 
           // choice made
-          mDeskView->draw(false);
-        mDeskView->longWait(1);
+          viewDraw(false);
+        viewLongWait(1);
 		  player(1)->setMessage("");
 		  player(2)->setMessage("");
           player(3)->setMessage("");
@@ -800,15 +996,16 @@ void PrefModel::runGame () {
 				for (int n=1; n<=3; n++)
                     if (player(n)->game() == whist) {
     					player(n)->setMessage(tr("thinking..."));
-						mDeskView->draw(false);
+						viewDraw(false);
 						if (n != 1)
-							mDeskView->mySleep(1);
-						m_closedWhist = player(n)->chooseClosedWhist();
+							viewSleep(1);
+						m_closedWhist = makeGameClosedWhist(player(n));
+						if (m_closedWhist) mDealRec.flags |= DealRecord::FlagClosedWhist;
 						if (m_closedWhist)
 							player(n)->setMessage(tr("close"));
 						else
 							player(n)->setMessage(tr("open"));
-						mDeskView->draw(false);
+						viewDraw(false);
 					}
 
 				// if closed whist chosen, no hand become opened
@@ -818,8 +1015,8 @@ void PrefModel::runGame () {
                         if ((player(n)->game() == whist) || (player(n)->game() == gtPass))
 							player(n)->setInvisibleHand(false);
 				}
-				mDeskView->draw(false);
-				mDeskView->mySleep(1);
+				viewDraw(false);
+				viewSleep(1);
 			
 			}
           }
@@ -834,20 +1031,20 @@ void PrefModel::runGame () {
       optPassCount++;
       mPlayerActive = 0;
       mPlayerHi = 0;
-      playerBids[0] = m_currentGame = raspass;
+      mPlayerBids[0] = m_currentGame = raspass;
       player(1)->setGame(raspass);
       player(2)->setGame(raspass);
       player(3)->setGame(raspass);
-      mCardsOnDesk[0] = mCardsOnDesk[1] = mCardsOnDesk[2] = mCardsOnDesk[3] = 0;
+      mCardsOnDesk[0] = mCardsOnDesk[1] = mCardsOnDesk[2] = mCardsOnDesk[3] = CardNone;
       mOnDeskClosed = false;
-      mDeskView->draw();
-      mDeskView->longWait(1);
+      viewDraw();
+      viewLongWait(1);
     }
 
     player(1)->setMessage("");
     player(2)->setMessage("");
     player(3)->setMessage("");
-    mDeskView->draw(true);
+    viewDraw(true);
 
     // game (10 moves)
 	mBiddingDone = true;
@@ -856,12 +1053,12 @@ void PrefModel::runGame () {
       //////////////////////////////////////////////////////////////////
       // Warning! Dirty hack!
       //
-      // Assuming trump to be playerBids[0]-(playerBids[0]/10)*10 works
+      // Assuming trump to be mPlayerBids[0]-(mPlayerBids[0]/10)*10 works
       // ONLY because of special choice of numerical constants for no trumps
       // games!
       // See prfconst.h for more details      
 
-      m_trump = playerBids[0]-(playerBids[0]/10)*10;
+      m_trump = mPlayerBids[0]-(mPlayerBids[0]/10)*10;
       qDebug() << "Trump = " << m_trump;
 
     pt.restart();
@@ -870,11 +1067,16 @@ void PrefModel::runGame () {
 
 LabelRecordOnPaper:
 
+    mDealInProgress = false;
     mPlayingRound = false;
     ++nCurrentStart;
 
     ScoreBoard::calculateScore(this, nPassCounter);
     closePool();
+    recordDeal(elapsedTime);
+    if (mTraceWriter.isOpen() && !mTraceWriter.flush()) qWarning("can't write decision trace");
+    if (mDealExport.isOpen() && !mDealExport.flush()) qWarning("can't export deal");
+    SearchStatsLog::instance().endDeal();
 
     CardList tmplist[3];
     if (nPassCounter != 2) {
@@ -888,34 +1090,9 @@ LabelRecordOnPaper:
       }
     }
 
-    if(m_keepLog) {
-        GameLogEntry entry;
-        entry.game = m_currentGame;
-        entry.player = mPlayerActive;
-        for (int f=1; f<=3; f++) {
-            const Player *plr = player(f);
-            entry.whist[f-1] = (plr->game() == whist);
-            entry.takes[f-1] = plr->tricksTaken();
-            entry.score[f-1] = plr->mScore.score();
-            entry.mountain[f-1] = plr->mScore.mountain();
-            entry.pool[f-1] = plr->mScore.pool();
-            entry.leftWhists[f-1] = plr->mScore.leftWhists();
-            entry.rightWhists[f-1] = plr->mScore.rightWhists();
-//            entry.cardList[f-1] = tmplist[f-1];
-            entry.time = elapsedTime / 1000.0;
-            for (int i=0; i<plr->mCards.size(); i++) {
-              const Card *c = plr->mCards.at(i);
-              if(c)
-                entry.cardList[f-1] << *c;
-            }
-
-        }
-        m_gameLog.append(entry);
-    }
-
     mPlayingRound = true;
-    mDeskView->draw();
-    mDeskView->drawPool();
+    viewDraw();
+    viewDrawPool();
     mPlayingRound = false;
     if (nPassCounter != 2) {
       //  
@@ -927,7 +1104,7 @@ LabelRecordOnPaper:
     }
     emitGameChanged(zerogame);
   } // end of pool
-  mDeskView->update();
+  viewUpdate();
   emit gameOver();
 
   mGameRunning = false;
@@ -937,12 +1114,14 @@ void PrefModel::playingRound()
 {
   Card *firstCard, *secondCard, *thirdCard;
   char xxBuf[1024];
-  m_outCards.clear();
+  m_outCards = 0;
     for (int i = 1; i <= 10; i++) {
       Player *tmpg;
-      mCardsOnDesk[0] = mCardsOnDesk[1] = mCardsOnDesk[2] = mCardsOnDesk[3]
-               = firstCard = secondCard = thirdCard = 0;
+      mCardsOnDesk[0] = mCardsOnDesk[1] = mCardsOnDesk[2] = mCardsOnDesk[3] = CardNone;
+      firstCard = secondCard = thirdCard = 0;
       if (m_currentGame == raspass && (i >= 1 && i <= 3)) nCurrentMove = nCurrentStart;
+      // the first bidder leads the first tricks of pass-out whoever takes them
+      if (optClaim && (m_currentGame != raspass || i > 3) && claimTricks()) break;
 
       dlogf("------------------------\nmove #%i", i);
       for (int f = 1; f <= 3; f++) {
@@ -953,19 +1132,22 @@ void PrefModel::playingRound()
       }
 
       mPlayerHi = nCurrentMove.nValue;
-      mDeskView->draw(false);
+      viewDraw(false);
 	  player(mPlayerHi)->setMessage(tr("thinking..."));
-	  mDeskView->draw();
-      mDeskView->mySleep(0);
+	  viewDraw();
+      viewSleep(0);
       if (m_currentGame == raspass && (i == 1 || i == 2)) {
-        mCardsOnDesk[0] = mDeck.at(29+i);
-        mDeskView->draw();
-        mDeskView->mySleep(0);
-        mCardsOnDesk[nCurrentMove.nValue] = firstCard = makeGameMove(0, mDeck.at(29+i), true);
+        mCardsOnDesk[0] = mDeck.idAt(29+i);
+        viewDraw();
+        viewSleep(0);
+        firstCard = makeGameMove(0, mDeck.at(29+i), true);
       } else {
-        mCardsOnDesk[0] = 0;
-        mCardsOnDesk[nCurrentMove.nValue] = firstCard = makeGameMove(0, 0, false);
+        mCardsOnDesk[0] = CardNone;
+        firstCard = makeGameMove(0, 0, false);
       }
+      mCardsOnDesk[nCurrentMove.nValue] = cardId(firstCard);
+      mDealRec.addPlay(cardId(firstCard));
+      cardPlayed(nCurrentMove.nValue, firstCard);
       player(mPlayerHi)->setMessage("");
 
       /*xxBuf[0] = 0;
@@ -975,9 +1157,12 @@ void PrefModel::playingRound()
       ++nCurrentMove;
       mPlayerHi = nCurrentMove.nValue;
       player(mPlayerHi)->setMessage(tr("thinking..."));
-      mDeskView->draw();
-      mDeskView->mySleep(0);
-      mCardsOnDesk[nCurrentMove.nValue] = secondCard = makeGameMove(0, firstCard, false);
+      viewDraw();
+      viewSleep(0);
+      secondCard = makeGameMove(0, firstCard, false);
+      mCardsOnDesk[nCurrentMove.nValue] = cardId(secondCard);
+      mDealRec.addPlay(cardId(secondCard));
+      cardPlayed(nCurrentMove.nValue, secondCard);
       player(mPlayerHi)->setMessage("");
 
       /*xxBuf[0] = 0;
@@ -987,9 +1172,12 @@ void PrefModel::playingRound()
       ++nCurrentMove;
       mPlayerHi = nCurrentMove.nValue;
       player(mPlayerHi)->setMessage(tr("thinking..."));
-      mDeskView->draw();
-      mDeskView->mySleep(0);
-      mCardsOnDesk[nCurrentMove.nValue] = thirdCard = makeGameMove(firstCard, secondCard, false);
+      viewDraw();
+      viewSleep(0);
+      thirdCard = makeGameMove(firstCard, secondCard, false);
+      mCardsOnDesk[nCurrentMove.nValue] = cardId(thirdCard);
+      mDealRec.addPlay(cardId(thirdCard));
+      cardPlayed(nCurrentMove.nValue, thirdCard);
       player(mPlayerHi)->setMessage("");
 
       /*xxBuf[0] = 0;
@@ -997,25 +1185,159 @@ void PrefModel::playingRound()
       dlogf(" (3rd) player %i:%s", nCurrentMove.nValue, xxBuf);*/
 
       checkMoves();
-      m_outCards << mCardsOnDesk[0] << mCardsOnDesk[1] << mCardsOnDesk[2] << mCardsOnDesk[3];
+      for (int f = 0; f < 4; f++) m_outCards |= cardIdMask(mCardsOnDesk[f]);
 
       ++nCurrentMove;
-      mDeskView->draw();
-      mDeskView->longWait(1);
+      viewDraw();
+      viewLongWait(1);
 
       nCurrentMove = nCurrentMove
-        + whoseTrick(firstCard, secondCard, thirdCard, m_trump)-1;
+        + whoseTrick(firstCard->id(), secondCard->id(), thirdCard->id(), m_trump)-1;
 
       QCardList cAni;
       for (int f = 0; f < 4; f++) {
-        cAni.append(mCardsOnDesk[f]);
-        mCardsOnDesk[f] = 0;
+        cAni.append(cardFromId(mCardsOnDesk[f]));
+        mCardsOnDesk[f] = CardNone;
       }
-      mDeskView->animateTrick(nCurrentMove.nValue, cAni); // will clear mCardsOnDesk[]
+      viewAnimateTrick(nCurrentMove.nValue, cAni); // will clear mCardsOnDesk[]
       tmpg = player(nCurrentMove);
       tmpg->gotTrick();
-      mDeskView->draw(false);
+      viewDraw(false);
+    }
+}
+
+
+bool PrefModel::claimTricks () {
+  quint32 hands[3];
+  for (int f = 1; f <= 3; f++) hands[f-1] = player(f)->mCards.mask();
+  int tricks[3];
+  ClaimCheck claim;
+  if (!claim.check(hands, m_trump, nCurrentMove.nValue, tricks)) return false;
+  dlogf("claim: %i %i %i", tricks[0], tricks[1], tricks[2]);
+  // the rest goes as if it was played out
+  for (int f = 1; f <= 3; f++) {
+    Player *plr = player(f);
+    for (int t = 0; t < tricks[f-1]; t++) plr->gotTrick();
+    for (CardId id = 0; id < 32; id++) {
+      if (hands[f-1] & cardIdMask(id)) plr->mCardsOut.insertId(id);
     }
+    plr->mCards.clear();
+    plr->setMessage("");
+  }
+  m_outCards |= hands[0] | hands[1] | hands[2];
+  mDealRec.flags |= DealRecord::FlagClaimed;
+  viewDraw();
+  return true;
+}
+
+
+// Lets every player update what he knows about cards
+void PrefModel::cardPlayed (int who, Card *card) {
+  for (int f = 1; f <= 3; f++) player(f)->cardPlayed(who, cardId(card));
+  mTraceRec.addPlay(who, cardId(card));
+}
+
+
+quint64 PrefModel::beginDecision (int kind, int seat, int left, int right) {
+  if (replaying()) return 0;
+  // every decision starts its random streams from a seed of its own, so
+  // tracereplay can give them back
+  quint32 aiSeed;
+  if (mResumeRng) {
+    // replayed decisions drew nothing: the streams go on as they were saved
+    mResumeRng = false;
+    mAiRng.setState(mResumeRngState);
+    aiSeed = mResumeInDecision ? mAiSeed : mAiRng.next();
+  } else
+    aiSeed = mAiRng.next();
+  mAiSeed = aiSeed;
+  mInDecision = true;
+  mAiRng.setSeed(aiSeed);
+  qsrand(aiSeed);
+  if (mTraceWriter.isOpen()) {
+    TraceRecord &t = mTraceRec;
+    t.deal = m_dealNo;
+    t.aiSeed = aiSeed;
+    t.kind = kind;
+    t.seat = seat;
+    t.flags = 0;
+    if (m_currentGame == raspass && mCardsOnDesk[0] != CardNone) t.flags |= TraceRecord::FlagPassOut;
+    if (m_closedWhist) t.flags |= TraceRecord::FlagClosedWhist;
+    if (seat == nCurrentStart.nValue) t.flags |= TraceRecord::FlagFirstBidder;
+    for (int f = 1; f <= 3; f++) {
+      Player *plr = player(f);
+      t.hands[f-1] = plr->mCards.mask();
+      t.games[f-1] = plr->game();
+      t.pools[f-1] = plr->mScore.pool();
+    }
+    t.talon[0] = mDealRec.talon[0];
+    t.talon[1] = mDealRec.talon[1];
+    t.game = kind == DealRecord::DecBid ? undefined : m_currentGame;
+    t.declarer = mPlayerActive;
+    t.first = nCurrentStart.nValue;
+    t.left = left;
+    t.right = right;
+    t.legal = 0;
+    if (kind == DealRecord::DecMove) {
+      CardId lead = isValidCardId(left) ? left : right;
+      int trump = (m_currentGame >= g61 && m_currentGame != g86) ? trumpSuit() : 0;
+      t.legal = TraceRecord::legalCards(t.hands[seat-1], lead, trump);
+    }
+    t.options = (optStalingrad ? TraceRecord::OptStalingrad : 0) |
+      (opt10Whist ? TraceRecord::Opt10Whist : 0) |
+      (optWhistGreedy ? TraceRecord::OptWhistGreedy : 0) |
+      (optAggPass ? TraceRecord::OptAggPass : 0) |
+      (optWithoutThree ? TraceRecord::OptWithoutThree : 0);
+    t.passCount = optPassCount;
+    t.maxPool = optMaxPool;
+  }
+  return monotonicUsec();
+}
+
+
+void PrefModel::recordDecision (Player *plr, int seat, int kind, quint64 start, int chosen) {
+  if (replaying()) {
+    // made before the game was saved, the trace has it already
+    const Decision &d = mDecisions[mDecisionNo++];
+    mDealRec.addDecision(seat, kind, d.engine, d.usec);
+    return;
+  }
+  quint64 usec = monotonicUsec()-start;
+  int engine = DealRecord::engineCode(plr->type());
+  mDealRec.addDecision(seat, kind, engine, usec);
+  Decision d;
+  d.chosen = chosen;
+  d.cards = 0;
+  d.usec = qMin(usec, (quint64)0xffffffffu);
+  d.engine = engine;
+  mDecisions << d;
+  mDecisionNo++;
+  mInDecision = false;
+  if (mTraceWriter.isOpen()) {
+    mTraceRec.usec = qMin(usec, (quint64)0xffffffffu);
+    mTraceRec.engine = engine;
+    mTraceRec.chosen = chosen;
+    mTraceWriter.append(mTraceRec);
+  }
+}
+
+
+void PrefModel::recordDeal (int elapsedTime) {
+  if (!mDealWriter.isOpen()) return;
+  mDealRec.game = m_currentGame;
+  mDealRec.declarer = mPlayerActive;
+  mDealRec.time = qMin(elapsedTime/100, 0xffff);
+  for (int f = 1; f <= 3; f++) {
+    const Player *plr = player(f);
+    mDealRec.finalBids[f-1] = plr->game();
+    mDealRec.tricks[f-1] = plr->tricksTaken();
+    mDealRec.score[f-1] = plr->mScore.score();
+    mDealRec.pool[f-1] = plr->mScore.pool();
+    mDealRec.mountain[f-1] = plr->mScore.mountain();
+    mDealRec.leftWhists[f-1] = plr->mScore.leftWhists();
+    mDealRec.rightWhists[f-1] = plr->mScore.rightWhists();
+  }
+  if (!mDealWriter.append(mDealRec)) qWarning("can't write deal record");
 }
 
 int PrefModel::trumpSuit () const
@@ -1027,8 +1349,7 @@ bool PrefModel::checkMoves ()
 {
   // Protect from ace in a sleeve
   for (int i=0; i<4; i++) {
-    if(!mCardsOnDesk[i]) continue;
-    if (m_outCards.contains(mCardsOnDesk[i])) {
+    if (m_outCards & cardIdMask(mCardsOnDesk[i])) {
       qFatal("Player %d is cheating!", i);
       return false;
     }
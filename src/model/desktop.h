@@ -24,30 +24,14 @@
 #define DESKTOP_H
 
 #include <QObject>
+#include <QVector>
 
 #include "cardlist.h"
+#include "dealfile.h"
+#include "dealrecord.h"
+#include "decisiontrace.h"
 #include "ncounter.h"
-
-const char * sGameName (eGameBid game);
-
-/**
- * @struct GameLogEntry
- *
- * Keeps information about all played rounds
- */
-struct GameLogEntry {
-    eGameBid game;
-    qint8 player;
-    bool whist[3];
-    qint16 takes[3];
-    qint16 score[3];
-    qint16 pool[3];
-    qint16 mountain[3];
-    qint16 leftWhists[3];
-    qint16 rightWhists[3];
-    float time;
-    QList<Card> cardList[3];
-};
+#include "prng.h"
 
 class DeskView;
 class Player;
@@ -68,13 +52,53 @@ public:
 
   void runGame ();
   Card *cardOnDesk(int index) const;
+  /// Mask of talon cards of the current deal (see cardBitNo())
+  quint32 talonMask () const;
 
   bool saveGame (const QString & name);
   bool loadGame (const QString & name);
 
   void closePool ();
-
+  /**
+   * Every deal is shuffled by its own stream made of (@a seed, @a table,
+   * deal number), see Prng::forDeal(); the same seed gives the same deals.
+   * Also chooses the first bidder and restarts deal numbering
+   */
+  void setSeed (quint64 seed, int table=0);
+  quint64 seed () const { return m_seed; }
+  int tableNo () const { return m_tableNo; }
+  int dealNo () const { return m_dealNo; }
+  /// Random stream of the simulating AIs in the current deal, follows the deal's stream; reseeded before every decision
+  Prng &aiRandom () { return mAiRng; }
+  /// Starts appending finished deals to archive @a fileName
+  bool openDealArchive (const QString &fileName) { return mDealWriter.open(fileName); }
+  /// File name of deal archive, empty if there is none
+  QString dealArchiveName () const { return mDealWriter.isOpen() ? mDealWriter.fileName() : QString(); }
+  /// Number of the first deal of this game in the deal archive; deals before it were played earlier
+  int dealArchiveStart () const { return mDealWriter.openCount(); }
+  /// Starts appending every decision to trace @a fileName (see tracereplay tool)
+  bool openDecisionTrace (const QString &fileName) { return mTraceWriter.open(fileName); }
+  /// Takes next deals from deal file @a fileName, random deals follow its end
+  bool openDealSource (const QString &fileName) { return mDealSource.open(fileName); }
+  /// Writes every deal to deal file @a fileName
+  bool openDealExport (const QString &fileName, bool binary) { return mDealExport.open(fileName, binary); }
+  /// Next deal of runGame() is @a deal; goes before deals of the deal file
+  void setNextDeal (const PresetDeal &deal);
+  /**
+   * Seats 1..3 are played by engines @a e1, @a e2, @a e3 (DealRecord::Engine,
+   * AiPlayer unless EngineAlphaBeta) instead of the human and the AIs chosen
+   * by options. For models without view, which play whole deals on their own
+   */
+  void setEngines (int e1, int e2, int e3);
+
+  /**
+   * Saves the whole game, the deal in progress included: its deck, every
+   * decision made in it and the random streams. runGame() resumes a deal
+   * restored by unserialize() where it was saved: the deal is dealt again
+   * and the decisions are replayed without asking the players
+   */
   void serialize (QByteArray &ba);
+  /// Also reads files of the old format without header
   bool unserialize (QByteArray &ba, int *pos);
 
   Player *player (int num);
@@ -84,9 +108,12 @@ public:
   int playerWithMaxPool (); // except the players who closed the pool
   int trumpSuit () const;
   eGameBid currentGame() const { return m_currentGame; }
-  const QList<GameLogEntry> & gameLog() const { return m_gameLog; }
+  /// Sets contract being played, for driving players outside of runGame()
+  void setCurrentGame (eGameBid game) { m_currentGame = game; }
 
   DeskView *view() const { Q_ASSERT(mDeskView); return mDeskView; }
+  /// False for headless models (tools, benchmarks)
+  bool hasView () const { return mDeskView != 0; }
   int gameWhists (eGameBid gType) const;
 
   void emitShowHint(const QString text) { emit showHint(text); }
@@ -129,26 +156,88 @@ public:
   bool optAlphaBeta1;
   bool optAlphaBeta2;
 
+  /// Deals end as soon as play can't change the tricks (see ClaimCheck)
+  bool optClaim;
+
 private:
   static const QString bidMessage(const eGameBid game);
   void initPlayers ();
   Player *player (const WrapCounter &cnt);
   Card *makeGameMove (Card *lMove, Card *rMove, bool isPassOut);
+  // decisions of runGame(), see replayedDecision()
+  eGameBid makeGameBid (Player *plr, eGameBid lMove, eGameBid rMove);
+  eGameBid makeGameDrop (Player *plr);
+  eGameBid makeGameFinalBid (Player *plr, eGameBid maxGame, int nPlayerPass);
+  bool makeGameClosedWhist (Player *plr);
+  bool replayedDecision (int *chosen) const;
+  /// Decisions of a resumed deal made before it was saved are being replayed
+  bool replaying () const { return mDecisionNo < mReplayCount; }
+  void cardPlayed (int who, Card *card);
   void playingRound();
   bool checkMoves();
+  /// Gives out the tricks left if every line of play ends the same
+  bool claimTricks ();
+  /**
+   * Takes state for the trace before decision @a kind of player @a seat;
+   * @a left and @a right are arguments of the decision. Returns the time
+   * for recordDecision()
+   */
+  quint64 beginDecision (int kind, int seat, int left=CardNone, int right=CardNone);
+  /// Adds decision @a chosen of @a plr for player @a seat started at @a start
+  void recordDecision (Player *plr, int seat, int kind, quint64 start, int chosen);
+  void recordDeal (int elapsedTime);
   void emitGameChanged(eGameBid game);
+  // DeskView calls of runGame(), nothing happens without view
+  void viewDraw (bool emitSignal=true);
+  void viewDrawPool ();
+  void viewUpdate ();
+  void viewSleep (int seconds);
+  void viewAniSleep (int milliseconds);
+  void viewLongWait (int n);
+  void viewAnimateTrick (int plrNo, const QCardList &cards);
+  bool dealAnimation () const;
 
 private:
   DeskView *mDeskView;
   CardList mDeck;
   QList<Player *> mPlayers;
-  Card *mCardsOnDesk[4];
-  QCardList m_outCards;
+  CardId mCardsOnDesk[4];
+  eGameBid mPlayerBids[4]; // max bid, then bids of players
+  quint32 m_outCards; // mask of cards played in this deal
   int mPlayerActive; // who plays (if not raspass and mPlayingRound=true)
   int m_trump;  
   bool m_closedWhist;
-  bool m_keepLog;
-  QList<GameLogEntry> m_gameLog;
+  quint64 m_seed;
+  int m_tableNo;
+  int m_dealNo; // number of the last deal
+  Prng mAiRng;
+  DealRecord mDealRec; // deal in progress
+  bool mDealInProgress;
+  bool mResumeDeal; // runGame() starts with mResumeDeck
+  CardList mResumeDeck; // restored deal, in order of dealing
+  /// Decision of the deal in progress, as recordDecision() got it
+  struct Decision {
+    int chosen;
+    quint32 cards; // dropped cards of DecDrop
+    quint32 usec;
+    int engine;
+  };
+  QVector<Decision> mDecisions; // of the deal in progress
+  int mDecisionNo; // decisions made or replayed in the deal
+  int mReplayCount; // first decisions of a resumed deal, replayed
+  bool mInDecision; // between beginDecision() and recordDecision()
+  quint32 mAiSeed; // of the last decision
+  bool mResumeRng; // the first decision after replayed ones takes these
+  bool mResumeInDecision;
+  quint32 mResumeRngState[4];
+  DealWriter mDealWriter;
+  TraceRecord mTraceRec; // decision being made
+  TraceWriter mTraceWriter;
+  DealFileReader mDealSource;
+  DealFileWriter mDealExport;
+  PresetDeal mNextDeal;
+  bool mHasNextDeal;
+  int mEngines[3]; // EngineUnknown: human and AIs of options
   eGameBid m_currentGame;
 };
 
@@ -4,17 +4,28 @@ INCLUDEPATH += $$PWD
 HEADERS += \
   $$PWD/baser.h \
   $$PWD/card.h \
+  $$PWD/cardid.h \
   $$PWD/cardlist.h \
+  $$PWD/dealfile.h \
+  $$PWD/dealrecord.h \
+  $$PWD/decisiontrace.h \
   $$PWD/debug.h \
   $$PWD/desktop.h \
+  $$PWD/monoclock.h \
   $$PWD/scoreboard.h\
-  $$PWD/ncounter.h
+  $$PWD/ncounter.h \
+  $$PWD/prng.h
 
 SOURCES += \
   $$PWD/baser.cpp \
   $$PWD/card.cpp \
   $$PWD/cardlist.cpp \
+  $$PWD/dealfile.cpp \
+  $$PWD/dealrecord.cpp \
+  $$PWD/decisiontrace.cpp \
   $$PWD/debug.cpp \
   $$PWD/desktop.cpp \
+  $$PWD/monoclock.cpp \
   $$PWD/scoreboard.cpp\
-  $$PWD/ncounter.cpp
+  $$PWD/ncounter.cpp \
+  $$PWD/prng.cpp
@@ -0,0 +1,53 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#include <QtGlobal>
+
+#if defined(Q_OS_WIN)
+# include <windows.h>
+#elif defined(Q_OS_MAC)
+# include <mach/mach_time.h>
+#else
+# include <time.h>
+#endif
+
+#include "monoclock.h"
+
+
+quint64 monotonicUsec () {
+#if defined(Q_OS_WIN)
+  static LARGE_INTEGER freq;
+  if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  return (quint64)now.QuadPart/freq.QuadPart*1000000+
+    (quint64)now.QuadPart%freq.QuadPart*1000000/freq.QuadPart;
+#elif defined(Q_OS_MAC)
+  static mach_timebase_info_data_t tb;
+  if (!tb.denom) mach_timebase_info(&tb);
+  return mach_absolute_time()/1000*tb.numer/tb.denom;
+#else
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (quint64)ts.tv_sec*1000000+ts.tv_nsec/1000;
+#endif
+}
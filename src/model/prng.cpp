@@ -0,0 +1,72 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#include "prng.h"
+
+
+// splitmix64: spreads seeds that differ in few bits over the whole state
+static quint64 splitMix (quint64 &x) {
+  quint64 z = (x += Q_UINT64_C(0x9e3779b97f4a7c15));
+  z = (z ^ (z >> 30))*Q_UINT64_C(0xbf58476d1ce4e5b9);
+  z = (z ^ (z >> 27))*Q_UINT64_C(0x94d049bb133111eb);
+  return z ^ (z >> 31);
+}
+
+
+void Prng::setSeed (quint64 seed) {
+  quint64 a = splitMix(seed), b = splitMix(seed);
+  s[0] = (quint32)a;
+  s[1] = (quint32)(a >> 32);
+  s[2] = (quint32)b;
+  s[3] = (quint32)(b >> 32);
+  if (!(s[0] | s[1] | s[2] | s[3])) s[0] = 1; // all-zero state is a fixed point
+}
+
+
+Prng Prng::forDeal (quint64 seed, int table, int dealNo) {
+  quint64 x = seed;
+  quint64 h = splitMix(x) ^ (quint32)table;
+  h = splitMix(h) ^ (quint32)dealNo;
+  return Prng(splitMix(h));
+}
+
+
+void Prng::jump () {
+  static const quint32 jumpPoly[4] = { 0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b };
+  quint32 t[4] = { 0, 0, 0, 0 };
+  for (int f = 0; f < 4; f++) {
+    for (int b = 0; b < 32; b++) {
+      if (jumpPoly[f] & (1u << b)) {
+        for (int c = 0; c < 4; c++) t[c] ^= s[c];
+      }
+      next();
+    }
+  }
+  for (int c = 0; c < 4; c++) s[c] = t[c];
+}
+
+
+Prng Prng::split () {
+  Prng res(*this);
+  jump();
+  return res;
+}
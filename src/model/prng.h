@@ -0,0 +1,87 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+#ifndef PRNG_H
+#define PRNG_H
+
+#include <QtGlobal>
+
+/**
+ * @class Prng prng.h
+ * @brief Seedable random number generator (xoshiro128**)
+ *
+ * Unlike qrand() it has no global state, so every table or thread keeps
+ * its own generator. Streams are made independent either by jump()
+ * (2^64 draws apart) or by forDeal(), which derives the state of one deal
+ * from (seed, table, deal number) and so doesn't depend on the order or
+ * the thread deals are made in.
+ */
+class Prng {
+public:
+  explicit Prng (quint64 seed=0) { setSeed(seed); }
+
+  /// Restarts the stream from @a seed
+  void setSeed (quint64 seed);
+  /// Stream of deal @a dealNo at table @a table
+  static Prng forDeal (quint64 seed, int table, int dealNo);
+
+  quint32 next () {
+    quint32 res = rotl(s[1]*5, 7)*9, t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 11);
+    return res;
+  }
+
+  /// Uniform number in [0, @a bound), without modulo bias
+  quint32 bounded (quint32 bound) {
+    Q_ASSERT(bound > 0);
+    quint64 m = (quint64)next()*bound;
+    if ((quint32)m < bound) {
+      // reject the few low values that would make some results more likely
+      quint32 threshold = (0u-bound)%bound;
+      while ((quint32)m < threshold) m = (quint64)next()*bound;
+    }
+    return (quint32)(m >> 32);
+  }
+
+  /// Advances the stream by 2^64 draws
+  void jump ();
+  /// Returns this stream and jumps this one ahead, so they don't overlap
+  Prng split ();
+
+  /// Four words of the state, e.g. for saved games
+  void getState (quint32 *st) const { for (int f = 0; f < 4; f++) st[f] = s[f]; }
+  void setState (const quint32 *st) { for (int f = 0; f < 4; f++) s[f] = st[f]; }
+
+private:
+  static quint32 rotl (quint32 x, int k) { return (x << k) | (x >> (32-k)); }
+
+private:
+  quint32 s[4];
+};
+
+
+#endif
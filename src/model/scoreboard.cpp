@@ -231,8 +231,9 @@ QString ScoreBoard::rightWhistsStr (int maxItems) const { return intList2Str(mRi
 
 
 static void serializeIntList (QByteArray &ba, const QIntList &lst) {
-  serializeInt(ba, lst.size());
-  for (int f = 0; f < lst.size(); f++) serializeInt(ba, lst[f]);
+  char *d = serializeGrow(ba, (lst.size()+1)*4);
+  storeInt(d, lst.size());
+  for (int f = 0; f < lst.size(); f++) storeInt(d += 4, lst[f]);
 }
 
 
@@ -316,3 +317,22 @@ void ScoreBoard::calculateScore(PrefModel *model, int nPassCounter)
 				model->player(i)->mScore.mountainAmnesty(mm);
 	}
 }
+
+
+void ScoreBoard::settle (const ScoreBoard * const boards[3], int scores[3]) {
+  int leftWh[3], rightWh[3];
+  for (int i = 0; i < 3; i++) {
+    // own pool goes to own whists
+    leftWh[i] = boards[i]->leftWhists()+boards[i]->pool()*10/3;
+    rightWh[i] = boards[i]->rightWhists()+boards[i]->pool()*10/3;
+  }
+  // mountain goes to the whists of others
+  for (int i = 0; i < 3; i++) {
+    rightWh[(i+1)%3] += boards[i]->mountain()*10/3;
+    leftWh[(i+2)%3] += boards[i]->mountain()*10/3;
+  }
+  for (int i = 0; i < 3; i++) {
+    int i1 = (i+1)%3, i2 = (i+2)%3;
+    scores[i] = leftWh[i]+rightWh[i]-rightWh[i1]-leftWh[i2];
+  }
+}
@@ -71,6 +71,11 @@ public:
   bool unserialize (QByteArray &ba, int *pos);
 
   static void calculateScore(PrefModel *model, int nPassCounter);
+  /**
+   * Converts pools and mountains of three players (@a boards[0] is player 1)
+   * into final whists, as done when the pool is closed
+   */
+  static void settle (const ScoreBoard * const boards[3], int scores[3]);
 
 private:
   QIntList mPool;
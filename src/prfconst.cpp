@@ -77,3 +77,43 @@ int gamePoolPrice (eGameBid gType) {
   if (gType == raspass) return 1;
   return 2;
 }
+
+
+const char * sGameName (eGameBid game) {
+  switch (game) {
+    case g86catch: return " ";
+    case raspass: return "pass-out";
+    case undefined: return "-----";
+    case whist: return "whist";
+    case halfwhist: return "halfwhist";
+    case gtPass: return "pass";
+    case g61: return "6\1s";
+    case g62: return "6\1c";
+    case g63: return "6\1d";
+    case g64: return "6\1h";
+    case g65: return "6NT";
+    case g71: return "7\1s";
+    case g72: return "7\1c";
+    case g73: return "7\1d";
+    case g74: return "7\1h";
+    case g75: return "7NT";
+    case g81: return "8\1s";
+    case g82: return "8\1c";
+    case g83: return "8\1d";
+    case g84: return "8\1h";
+    case g85: return "8NT";
+    case g86: return "Misere";
+    case g91: return "9\1s";
+    case g92: return "9\1c";
+    case g93: return "9\1d";
+    case g94: return "9\1h";
+    case g95: return "9NT";
+    case g101: return "10\1s";
+    case g102: return "10\1c";
+    case g103: return "10\1d";
+    case g104: return "10\1h";
+    case g105: return "10NT";
+    default: ;
+  }
+  return "";
+}
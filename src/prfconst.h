@@ -54,5 +54,7 @@ int succBid (eGameBid game);
 int gameTricks (eGameBid gType);
 int gameWhistsMin (eGameBid gType);
 int gamePoolPrice (eGameBid gType);
+/// Short name of game; suits are written as "\1s", "\1c", "\1d", "\1h"
+const char * sGameName (eGameBid game);
 
 #endif
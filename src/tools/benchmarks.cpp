@@ -0,0 +1,478 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+/*
+ * benchmarks - microbenchmarks of the card model and AI kernels
+ *
+ * Every case runs until it takes --min-time milliseconds and reports time
+ * and heap allocations per operation. Positions are dealt from a fixed
+ * seed, so numbers of different builds can be compared.
+ *
+ * Example: only CardList cases, longer runs
+ *   benchmarks --min-time 1000 CardList
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include <QByteArray>
+#include <QDir>
+#include <QStringList>
+#include <QTime>
+
+#include "prfconst.h"
+#include "card.h"
+#include "cardlist.h"
+#include "claimcheck.h"
+#include "dealfile.h"
+#include "ddsolver.h"
+#include "desktop.h"
+#include "prng.h"
+#include "scoreboard.h"
+#include "aiplayer.h"
+#include "aialphabeta.h"
+
+
+// Heap allocations since start. With glibc every malloc() is counted (Qt
+// containers don't use operator new); elsewhere only operator new is.
+// Benchmarks are single-threaded, so a plain counter will do
+static quint64 sAllocs = 0;
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc (size_t size);
+void *__libc_calloc (size_t cnt, size_t size);
+void *__libc_realloc (void *ptr, size_t size);
+
+void *malloc (size_t size) { sAllocs++; return __libc_malloc(size); }
+void *calloc (size_t cnt, size_t size) { sAllocs++; return __libc_calloc(cnt, size); }
+void *realloc (void *ptr, size_t size) { sAllocs++; return __libc_realloc(ptr, size); }
+}
+#else
+void *operator new (size_t size) throw(std::bad_alloc) {
+  sAllocs++;
+  void *res = malloc(size ? size : 1);
+  if (!res) throw std::bad_alloc();
+  return res;
+}
+void *operator new[] (size_t size) { return operator new(size); }
+void operator delete (void *ptr) throw() { free(ptr); }
+void operator delete[] (void *ptr) throw() { free(ptr); }
+#endif
+
+
+// results go here, so the compiler can't drop the work
+static volatile int sSink;
+
+// fixtures, see setup()
+static PrefModel *sModel;
+static CardList sHand;     // 10 cards, sorted
+static CardList sShuffled; // the same cards in deal order
+static CardList sTalonHand; // 12 cards
+static CardList sMisereHand; // 12 low cards
+static Card *sMissing;     // card not in sHand
+static CardId sTricks[1024][3];
+
+static const int Positions = 4;
+static const int PositionCards = 6;
+static CardList sPositions[Positions][3];
+static quint32 sEndings[Positions][3]; // first 4 cards of every hand of sPositions
+static quint32 sDeals[Positions][3];   // full hands for DDSolver::calcTable()
+
+// the same deals as text and binary deal files
+static const int FileDeals = 1000;
+static QString sDealFileNames[2];
+static DealFileReader sDealFiles[2];
+
+
+static void setup () {
+  sModel = new PrefModel(0);
+  Prng rng(20100101);
+  CardList deck;
+  deck.newDeck();
+  deck.shuffle(rng);
+  for (int f = 0; f < 10; f++) sShuffled.insertId(deck.idAt(f));
+  sHand = sShuffled;
+  sHand.mySort();
+  sMissing = deck.at(10);
+  for (int f = 0; f < 12; f++) sTalonHand.insertId(deck.idAt(f+10));
+  static const char *misere[12] = { "7s", "8s", "9s", "Js", "7c", "8c", "10c", "7d", "9d", "7h", "8h", "Ah" };
+  for (int f = 0; f < 12; f++) sMisereHand.insert(cardFromName(misere[f]));
+
+  for (int t = 0; t < 1024; t++) {
+    deck.shuffle(rng);
+    for (int f = 0; f < 3; f++) sTricks[t][f] = deck.idAt(f);
+  }
+  for (int p = 0; p < Positions; p++) {
+    deck.newDeck();
+    deck.shuffle(rng);
+    for (int h = 0; h < 3; h++) {
+      for (int f = 0; f < PositionCards; f++) sPositions[p][h].insertId(deck.idAt(h*PositionCards+f));
+      sEndings[p][h] = 0;
+      for (int f = 0; f < 4; f++) sEndings[p][h] |= cardIdMask(deck.idAt(h*PositionCards+f));
+    }
+  }
+  // own stream, so the fixtures above stay as they were
+  Prng tableRng(20100103);
+  for (int p = 0; p < Positions; p++) {
+    deck.newDeck();
+    deck.shuffle(tableRng);
+    for (int h = 0; h < 3; h++) {
+      sDeals[p][h] = 0;
+      for (int f = 0; f < 10; f++) sDeals[p][h] |= cardIdMask(deck.idAt(h*10+f));
+    }
+  }
+  for (int b = 0; b < 2; b++) {
+    sDealFileNames[b] = QDir::tempPath()+(b ? "/openpref-bench.opdl" : "/openpref-bench.txt");
+    DealFileWriter writer;
+    writer.open(sDealFileNames[b], b);
+    Prng dealRng(20100102);
+    for (int f = 0; f < FileDeals; f++) {
+      PresetDeal deal;
+      deck.newDeck();
+      deck.shuffle(dealRng);
+      deal.fromDeck(deck, f%3+1);
+      writer.append(deal);
+    }
+    writer.close();
+    sDealFiles[b].open(sDealFileNames[b]);
+  }
+}
+
+
+static void cleanup () {
+  for (int b = 0; b < 2; b++) {
+    sDealFiles[b].close();
+    QFile::remove(sDealFileNames[b]);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+static void benchExists (int iters) {
+  int hits = 0;
+  for (int i = 0; i < iters; i++) {
+    int c = i & 31;
+    if (sHand.exists(c%8+7, c/8+1)) hits++;
+  }
+  sSink = hits;
+}
+
+
+static void benchInsertRemove (int iters) {
+  CardList list(sHand);
+  for (int i = 0; i < iters; i++) {
+    list.insert(sMissing);
+    list.remove(sMissing);
+  }
+  sSink = list.count();
+}
+
+
+// includes copy of the list, sorting works in place
+static void benchMySort (int iters) {
+  int sum = 0;
+  for (int i = 0; i < iters; i++) {
+    CardList list(sShuffled);
+    list.mySort();
+    sum += list.idAt(0);
+  }
+  sSink = sum;
+}
+
+
+static void benchMaxInSuit (int iters) {
+  int hits = 0;
+  for (int i = 0; i < iters; i++) {
+    if (sHand.maxInSuit((i & 3)+1)) hits++;
+  }
+  sSink = hits;
+}
+
+
+static void benchGreaterInSuit (int iters) {
+  int hits = 0;
+  for (int i = 0; i < iters; i++) {
+    if (sHand.greaterInSuit((i & 7)+7, ((i >> 3) & 3)+1)) hits++;
+  }
+  sSink = hits;
+}
+
+
+static void benchWhoseTrick (int iters) {
+  int sum = 0;
+  for (int i = 0; i < iters; i++) {
+    const CardId *t = sTricks[i & 1023];
+    sum += whoseTrick(t[0], t[1], t[2], i & 3);
+  }
+  sSink = sum;
+}
+
+
+// AlphaBetaPlayer::makeMove() searches with abcPrune() when hands aren't full
+static void benchAbcPrune (int iters) {
+  AlphaBetaPlayer me(1, sModel);
+  AiPlayer left(2, sModel), right(3, sModel);
+  sModel->setCurrentGame(g72);
+  int sum = 0;
+  for (int i = 0; i < iters; i++) {
+    const CardList *pos = sPositions[i%Positions];
+    me.clear();
+    me.mCards = pos[0];
+    left.mCards = pos[1];
+    right.mCards = pos[2];
+    sum += cardId(me.makeMove(0, 0, &left, &right, false));
+  }
+  sSink = sum;
+}
+
+
+// all 45 solves of a deal; the next deal starts a new cache generation
+static void benchCalcTable (int iters) {
+  DDSolver solver;
+  DDTable table;
+  int sum = 0;
+  for (int i = 0; i < iters; i++) {
+    solver.calcTable(sDeals[i%Positions], table);
+    sum += table.tricks(i%5+1, 1, 1);
+  }
+  sSink = sum;
+}
+
+
+// playingRound() checks endings like these at every trick boundary
+static void benchClaimCheck (int iters) {
+  ClaimCheck claim;
+  int sum = 0, tricks[3];
+  for (int i = 0; i < iters; i++) {
+    if (claim.check(sEndings[i%Positions], i%5+1, i%3+1, tricks)) sum += tricks[0];
+  }
+  sSink = sum;
+}
+
+
+static void benchDrop (int iters, const CardList &hand, eGameBid game) {
+  AiPlayer plr(2, sModel);
+  int sum = 0;
+  for (int i = 0; i < iters; i++) {
+    plr.clear();
+    plr.mCards = hand;
+    plr.setGame(game);
+    sum += plr.makeDrop();
+  }
+  sSink = sum;
+}
+
+
+static void benchDropForGame (int iters) {
+  benchDrop(iters, sTalonHand, g71);
+}
+
+
+static void benchDropForMisere (int iters) {
+  benchDrop(iters, sMisereHand, g86);
+}
+
+
+static void benchMakeBid (int iters) {
+  AiPlayer plr(2, sModel);
+  plr.mCards = sHand;
+  int sum = 0;
+  for (int i = 0; i < iters; i++) {
+    plr.setGame(undefined);
+    sum += plr.makeBid(undefined, (i & 1) ? g71 : undefined);
+  }
+  sSink = sum;
+}
+
+
+// score sheets grow with every deal, so a fresh one is taken now and then
+static void benchRecordScores (int iters) {
+  ScoreBoard *board = 0;
+  int sum = 0;
+  for (int i = 0; i < iters; i++) {
+    if (!(i & 255)) {
+      delete board;
+      board = new ScoreBoard(sModel);
+    }
+    sum += board->recordScores(g71, (i & 1) ? g71 : whist, 7-(i & 1), 2, 2, (i & 1)+1, 2);
+  }
+  delete board;
+  sSink = sum;
+}
+
+
+static void benchSerialize (int iters) {
+  int sum = 0;
+  for (int i = 0; i < iters; i++) {
+    QByteArray ba;
+    sHand.serialize(ba);
+    CardList list;
+    int pos = 0;
+    if (list.unserialize(ba, &pos)) sum += list.count();
+  }
+  sSink = sum;
+}
+
+
+// starts over at the end of file
+static void benchReadDeals (DealFileReader &reader, int iters) {
+  PresetDeal deal;
+  quint32 sum = 0;
+  for (int i = 0; i < iters; i++) {
+    if (!reader.next(&deal)) {
+      reader.rewind();
+      reader.next(&deal);
+    }
+    sum += deal.hands[0];
+  }
+  sSink = sum;
+}
+
+
+static void benchReadDealsText (int iters) {
+  benchReadDeals(sDealFiles[0], iters);
+}
+
+
+static void benchReadDealsBinary (int iters) {
+  benchReadDeals(sDealFiles[1], iters);
+}
+
+
+// deal of a file into the deck runGame() deals from
+static void benchPresetToDeck (int iters) {
+  CardList deck;
+  deck.newDeck();
+  PresetDeal deal;
+  deal.fromDeck(deck, 1);
+  int sum = 0;
+  for (int i = 0; i < iters; i++) {
+    deal.toDeck(deck, i%3+1);
+    sum += deck.idAt(i & 31);
+  }
+  sSink = sum;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+typedef void (*BenchFunc) (int iters);
+
+struct Bench {
+  const char *name;
+  BenchFunc func;
+};
+
+static const Bench sBenches[] = {
+  { "CardList::exists", benchExists },
+  { "CardList::insert+remove", benchInsertRemove },
+  { "CardList::mySort", benchMySort },
+  { "CardList::maxInSuit", benchMaxInSuit },
+  { "CardList::greaterInSuit", benchGreaterInSuit },
+  { "CardList::serialize+unserialize", benchSerialize },
+  { "whoseTrick", benchWhoseTrick },
+  { "abcPrune", benchAbcPrune },
+  { "DDSolver::calcTable", benchCalcTable },
+  { "ClaimCheck::check", benchClaimCheck },
+  { "AiPlayer::dropForGame", benchDropForGame },
+  { "AiPlayer::dropForMisere", benchDropForMisere },
+  { "AiPlayer::makeBid", benchMakeBid },
+  { "ScoreBoard::recordScores", benchRecordScores },
+  { "DealFileReader::next text", benchReadDealsText },
+  { "DealFileReader::next binary", benchReadDealsBinary },
+  { "PresetDeal::toDeck", benchPresetToDeck },
+  { 0, 0 }
+};
+
+
+static void run (const Bench &b, int minMs) {
+  qint64 iters = 1;
+  for (;;) {
+    quint64 allocs = sAllocs;
+    QTime timer;
+    timer.start();
+    b.func((int)iters);
+    int ms = timer.elapsed();
+    allocs = sAllocs-allocs;
+    if (ms >= minMs || iters >= (1 << 30)) {
+      printf("%-34s %12.1f ns/op %10.2f allocs/op %12lld ops\n", b.name,
+        ms*1e6/iters, (double)allocs/iters, (long long)iters);
+      fflush(stdout);
+      return;
+    }
+    // aim a bit past the limit, so that the next run is likely the last
+    iters = ms < 10 ? iters*10 : qMin((qint64)1 << 30, iters*minMs*6/(ms*5)+1);
+  }
+}
+
+
+static void quietMessages (QtMsgType type, const char *msg) {
+  if (type != QtDebugMsg) fprintf(stderr, "%s\n", msg);
+}
+
+
+static void usage () {
+  fprintf(stderr,
+    "usage: benchmarks [options] [filter...]\n"
+    "  --min-time MS   run every case at least MS milliseconds (default 300)\n"
+    "  --list          list cases and exit\n"
+    "Only cases whose names contain one of the filters are run.\n");
+}
+
+
+int main (int argc, char *argv[]) {
+  int minMs = 300;
+  QStringList filters;
+  for (int f = 1; f < argc; f++) {
+    if (!strcmp(argv[f], "--list")) {
+      for (const Bench *b = sBenches; b->name; b++) printf("%s\n", b->name);
+      return 0;
+    }
+    if (!strcmp(argv[f], "--min-time")) {
+      bool ok = false;
+      if (f+1 < argc) minMs = QString(argv[++f]).toInt(&ok);
+      if (!ok || minMs <= 0) {
+        usage();
+        return 1;
+      }
+      continue;
+    }
+    if (argv[f][0] == '-') {
+      usage();
+      return 1;
+    }
+    filters << argv[f];
+  }
+
+  qInstallMsgHandler(quietMessages);
+  setup();
+  for (const Bench *b = sBenches; b->name; b++) {
+    bool selected = filters.isEmpty();
+    foreach (const QString &s, filters) if (QString(b->name).contains(s, Qt::CaseInsensitive)) selected = true;
+    if (selected) run(*b, minMs);
+  }
+  cleanup();
+  delete sModel;
+  return 0;
+}
@@ -0,0 +1,212 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+/*
+ * bidtrain - fits BidEvaluator weights from deal archives
+ *
+ * Every deal with a declared game gives one example: features of
+ * declarer's hand as dealt, before the talon, and the tricks declarer
+ * took. Weights are fitted by ridge regression.
+ *
+ * Example:
+ *   bidtrain -o bidweights.txt deals.opda
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "prfconst.h"
+#include "dealrecord.h"
+#include "bideval.h"
+#include "suittables.h"
+
+
+static const int N = BidEvaluator::Features;
+
+
+struct Normal {
+  double xx[N][N];
+  double xy[N];
+  double yy;
+  quint64 count;
+};
+
+
+// Pools before the deal: those after the previous deal of the same game
+static void poolsBefore (const DealRecord &prev, const DealRecord &rec, bool hasPrev, int *pools) {
+  bool sameGame = hasPrev;
+  for (int p = 0; p < 3; p++) if (prev.pool[p] > rec.pool[p]) sameGame = false;
+  for (int p = 0; p < 3; p++) pools[p] = sameGame ? prev.pool[p] : 0;
+}
+
+
+static void addArchive (DealArchive &archive, int maxPool, Normal &eq) {
+  DealRecord prev, rec;
+  bool hasPrev = false;
+  for (int i = 0; i < archive.count(); i++) {
+    if (!archive.record(i, &rec)) {
+      hasPrev = false;
+      continue;
+    }
+    int decl = rec.declarer, pools[3];
+    poolsBefore(prev, rec, hasPrev, pools);
+    prev = rec;
+    hasPrev = true;
+    if (decl < 1 || decl > 3 || rec.game < g61 || rec.game > g105 || rec.game == g86) continue;
+
+    int enemyPool = 0;
+    for (int p = 0; p < 3; p++) if (p != decl-1) enemyPool = qMax(enemyPool, pools[p]);
+    float f[BidEvaluator::VectorSize];
+    BidEvaluator::features(rec.hands[decl-1], (decl-rec.first+3)%3, pools[decl-1], enemyPool, maxPool, f);
+    double y = rec.tricks[decl-1];
+    for (int a = 0; a < N; a++) {
+      for (int b = 0; b < N; b++) eq.xx[a][b] += (double)f[a]*f[b];
+      eq.xy[a] += f[a]*y;
+    }
+    eq.yy += y*y;
+    eq.count++;
+  }
+}
+
+
+// Solves (xx + ridge*I) w = xy by Gaussian elimination; bias isn't penalized
+static bool solve (const Normal &eq, double ridge, double *w) {
+  double a[N][N+1];
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < N; c++) a[r][c] = eq.xx[r][c];
+    if (r != BidEvaluator::Bias) a[r][r] += ridge;
+    a[r][N] = eq.xy[r];
+  }
+  for (int c = 0; c < N; c++) {
+    int pivot = c;
+    for (int r = c+1; r < N; r++) if (fabs(a[r][c]) > fabs(a[pivot][c])) pivot = r;
+    if (fabs(a[pivot][c]) < 1e-12) return false;
+    for (int k = 0; k <= N; k++) qSwap(a[c][k], a[pivot][k]);
+    for (int r = 0; r < N; r++) {
+      if (r == c) continue;
+      double m = a[r][c]/a[c][c];
+      for (int k = c; k <= N; k++) a[r][k] -= m*a[c][k];
+    }
+  }
+  for (int r = 0; r < N; r++) w[r] = a[r][N]/a[r][r];
+  return true;
+}
+
+
+// Mean squared error of weights @a w, from the normal equations
+static double meanSquare (const Normal &eq, const double *w) {
+  double sum = eq.yy;
+  for (int a = 0; a < N; a++) {
+    sum -= 2*w[a]*eq.xy[a];
+    for (int b = 0; b < N; b++) sum += w[a]*w[b]*eq.xx[a][b];
+  }
+  return sum/eq.count;
+}
+
+
+static void usage () {
+  fprintf(stderr,
+    "usage: bidtrain [options] archive...\n"
+    "  -o FILE       write weights to FILE (default bidweights.txt)\n"
+    "  --pool N      pool size the games were played to (default 10)\n"
+    "  --ridge L     ridge penalty (default 1)\n");
+}
+
+
+int main (int argc, char *argv[]) {
+  QString output("bidweights.txt");
+  int maxPool = 10;
+  double ridge = 1.0;
+  QStringList files;
+
+  for (int f = 1; f < argc; f++) {
+    QString arg(argv[f]);
+    if (!arg.startsWith("-")) {
+      files << arg;
+      continue;
+    }
+    if (f+1 >= argc) { usage(); return 1; }
+    QString val(argv[++f]);
+    bool ok = true;
+    if (arg == "-o") output = val;
+    else if (arg == "--pool") {
+      maxPool = val.toInt(&ok);
+      ok = ok && maxPool > 0;
+    } else if (arg == "--ridge") {
+      ridge = val.toDouble(&ok);
+      ok = ok && ridge >= 0;
+    } else ok = false;
+    if (!ok) {
+      fprintf(stderr, "bad option: %s %s\n", argv[f-1], argv[f]);
+      usage();
+      return 1;
+    }
+  }
+  if (files.isEmpty()) {
+    usage();
+    return 1;
+  }
+
+  SuitTables::init();
+  Normal eq;
+  memset(&eq, 0, sizeof(eq));
+  foreach (const QString &fn, files) {
+    DealArchive archive;
+    if (!archive.open(fn)) {
+      fprintf(stderr, "can't open archive %s\n", qPrintable(fn));
+      return 1;
+    }
+    addArchive(archive, maxPool, eq);
+  }
+  if (eq.count < (quint64)N) {
+    fprintf(stderr, "too few games: %llu\n", (unsigned long long)eq.count);
+    return 1;
+  }
+
+  double w[N];
+  if (!solve(eq, ridge, w)) {
+    fprintf(stderr, "features are degenerate, try larger --ridge\n");
+    return 1;
+  }
+  BidEvaluator eval;
+  for (int f = 0; f < N; f++) {
+    eval.setWeight(f, w[f]);
+    printf("%-12s %9.4f\n", BidEvaluator::featureName(f), w[f]);
+  }
+  // hand-written bidding counts table tricks plus one for the talon
+  double base[N];
+  memset(base, 0, sizeof(base));
+  base[BidEvaluator::Bias] = 1.0;
+  base[BidEvaluator::TableTricks] = 1.0;
+  printf("%llu games, rms error %.3f tricks (table estimate %.3f)\n", (unsigned long long)eq.count,
+    sqrt(qMax(0.0, meanSquare(eq, w))), sqrt(qMax(0.0, meanSquare(eq, base))));
+  if (!eval.save(output)) {
+    fprintf(stderr, "can't write %s\n", qPrintable(output));
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,17 @@
+# Fits bidding weights from deal archives (see bidtrain.cpp)
+TEMPLATE = app
+TARGET = bidtrain
+QT = core
+CONFIG += console warn_on
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD/.. $$PWD/../model $$PWD/../logic
+
+SOURCES += \
+  $$PWD/bidtrain.cpp \
+  $$PWD/../model/dealrecord.cpp \
+  $$PWD/../logic/bideval.cpp \
+  $$PWD/../logic/suittables.cpp
+
+DESTDIR = .
+OBJECTS_DIR = _build/obj
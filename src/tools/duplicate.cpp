@@ -0,0 +1,298 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+/*
+ * duplicate - compares two engines by duplicate play
+ *
+ * Every deal is played 6 times, once with each way to seat engines A and B
+ * so that both of them play (a table of one engine compares nothing).
+ * Each engine gets every seat, and so every hand in every position to the
+ * first bidder, in 3 of them; rotating hands together with the first
+ * bidder would only replay the same games with seats renumbered.
+ * All games of a deal use the same random stream. A deal gives the mean
+ * score (whists after settling the one-deal pool) of the seats played by
+ * B minus that of the seats played by A, so the luck of the cards cancels
+ * out; the report is the mean over deals with a 95% confidence interval.
+ *
+ * Deals are split between worker processes, one per core by default
+ * (AI players keep search state in globals, so threads won't do).
+ *
+ * Example: AlphaBeta against the original AI on 500 deals of seed 7
+ *   duplicate --deals 500 --seed 7
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <QCoreApplication>
+#include <QList>
+#include <QProcess>
+#include <QStringList>
+#include <QThread>
+#include <QTime>
+
+#include "prfconst.h"
+#include "cardlist.h"
+#include "dealfile.h"
+#include "dealrecord.h"
+#include "desktop.h"
+#include "player.h"
+#include "prng.h"
+
+
+// seats of B are bits of assignment numbers 1..6; all A (0) and all B (7) are left out
+enum { Assignments = 6, SeatsPerEngine = Assignments*3/2 };
+
+struct Options {
+  int engines[2]; // A, B
+  int deals;      // -1: all deals of the deal file
+  quint64 seed;
+  QString dealFile;
+  int jobs;
+  bool verbose;
+};
+
+
+/*
+ * Plays all games of @a deal (number @a idx), adds scores of seats played
+ * by engine A to @a sumA and of B to @a sumB
+ */
+static void playDeal (const Options &opt, const PresetDeal &deal, int idx, int *sumA, int *sumB) {
+  for (int a = 1; a <= Assignments; a++) {
+    int e[3];
+    for (int s = 0; s < 3; s++) e[s] = opt.engines[(a >> s) & 1];
+    PrefModel model(0);
+    model.setEngines(e[0], e[1], e[2]);
+    model.optQuitAfterMaxRounds = true;
+    model.optMaxRounds = 1;
+    model.optClaim = true;
+    model.setSeed(opt.seed, idx);
+    model.setNextDeal(deal);
+    model.runGame();
+    for (int s = 0; s < 3; s++) {
+      int score = model.player(s+1)->mScore.score();
+      if ((a >> s) & 1) *sumB += score; else *sumA += score;
+    }
+  }
+}
+
+
+// Plays deals idx % @a workers == @a worker, prints "deal idx sumA sumB" for each
+static int runWorker (const Options &opt, int worker, int workers) {
+  DealFileReader file;
+  if (!opt.dealFile.isEmpty() && !file.open(opt.dealFile)) {
+    fprintf(stderr, "can't read deal file %s\n", qPrintable(opt.dealFile));
+    return 1;
+  }
+  CardList deck;
+  PresetDeal deal;
+  for (int idx = 0; opt.deals < 0 || idx < opt.deals; idx++) {
+    if (file.isOpen()) {
+      if (!file.next(&deal)) {
+        if (file.errorLine()) {
+          fprintf(stderr, "broken deal at line %d of %s\n", file.errorLine(), qPrintable(opt.dealFile));
+          return 1;
+        }
+        break;
+      }
+    } else if (idx%workers == worker) {
+      Prng rng = Prng::forDeal(opt.seed, 0, idx+1);
+      deck.newDeck();
+      deck.shuffle(rng);
+      deal.fromDeck(deck, idx%3+1);
+    }
+    if (idx%workers != worker) continue;
+    if (!deal.first) deal.first = idx%3+1;
+    int sumA = 0, sumB = 0;
+    playDeal(opt, deal, idx, &sumA, &sumB);
+    printf("deal %d %d %d\n", idx, sumA, sumB);
+    fflush(stdout);
+  }
+  return 0;
+}
+
+
+struct Totals {
+  int deals;
+  double sumA, sumB; // mean scores of engines per deal, summed
+  double sumD, sumD2; // differences B-A per deal
+  Totals () : deals(0), sumA(0), sumB(0), sumD(0), sumD2(0) {}
+};
+
+
+// false if a result line is broken; other output of workers is skipped
+static bool addLine (const Options &opt, const QByteArray &line, Totals *t) {
+  int idx, sumA, sumB;
+  if (!line.startsWith("deal ")) return true;
+  if (sscanf(line.constData(), "deal %d %d %d", &idx, &sumA, &sumB) != 3) return false;
+  double a = (double)sumA/SeatsPerEngine, b = (double)sumB/SeatsPerEngine;
+  t->deals++;
+  t->sumA += a;
+  t->sumB += b;
+  t->sumD += b-a;
+  t->sumD2 += (b-a)*(b-a);
+  if (opt.verbose) printf("deal %6d  %s %+8.2f  %s %+8.2f  difference %+8.2f\n", idx,
+    DealRecord::engineName(opt.engines[0]), a, DealRecord::engineName(opt.engines[1]), b, b-a);
+  return true;
+}
+
+
+static void report (const Options &opt, const Totals &t, int ms) {
+  if (!t.deals) {
+    printf("no deals played\n");
+    return;
+  }
+  const char *nameA = DealRecord::engineName(opt.engines[0]), *nameB = DealRecord::engineName(opt.engines[1]);
+  double mean = t.sumD/t.deals, sd = 0;
+  if (t.deals > 1) sd = sqrt(qMax(0.0, (t.sumD2-t.sumD*mean)/(t.deals-1)));
+  // normal approximation; with a few dozen deals or more the t-quantile is close
+  double half = 1.96*sd/sqrt((double)t.deals);
+  printf("deals %d, games %d, %.1f s\n", t.deals, t.deals*Assignments, ms/1000.0);
+  printf("%-10s %+8.2f whists per seat and deal\n", nameA, t.sumA/t.deals);
+  printf("%-10s %+8.2f whists per seat and deal\n", nameB, t.sumB/t.deals);
+  printf("%s - %s: %+.2f +- %.2f (95%%), sd %.2f per deal\n", nameB, nameA, mean, half, sd);
+}
+
+
+// Starts workers, collects their deals as they come
+static int runParent (const Options &opt, const QStringList &args) {
+  QTime timer;
+  timer.start();
+  QList<QProcess *> procs;
+  for (int w = 0; w < opt.jobs; w++) {
+    QProcess *p = new QProcess;
+    p->start(QCoreApplication::applicationFilePath(),
+      QStringList(args) << "--worker" << QString("%1/%2").arg(w).arg(opt.jobs));
+    if (!p->waitForStarted()) {
+      fprintf(stderr, "can't start worker\n");
+      return 1;
+    }
+    procs << p;
+  }
+
+  Totals t;
+  int failed = 0;
+  while (!procs.isEmpty()) {
+    for (int f = 0; f < procs.size(); f++) {
+      QProcess *p = procs[f];
+      p->waitForReadyRead(100);
+      while (p->canReadLine()) {
+        if (!addLine(opt, p->readLine(), &t)) failed++;
+      }
+      QByteArray err(p->readAllStandardError());
+      if (!err.isEmpty()) fputs(err.constData(), stderr);
+      if (p->state() == QProcess::NotRunning) {
+        while (p->canReadLine()) if (!addLine(opt, p->readLine(), &t)) failed++;
+        fputs(p->readAllStandardError().constData(), stderr);
+        if (p->exitStatus() != QProcess::NormalExit || p->exitCode()) failed++;
+        delete procs.takeAt(f--);
+      }
+    }
+  }
+  report(opt, t, timer.elapsed());
+  if (failed) fprintf(stderr, "%d worker(s) failed\n", failed);
+  return failed ? 1 : 0;
+}
+
+
+static void quietMessages (QtMsgType type, const char *msg) {
+  if (type != QtDebugMsg) fprintf(stderr, "%s\n", msg);
+}
+
+
+static void usage () {
+  fprintf(stderr,
+    "usage: duplicate [options]\n"
+    "  --a NAME        engine A: Original or AlphaBeta (default Original)\n"
+    "  --b NAME        engine B (default AlphaBeta)\n"
+    "  --deals N       number of deals (default 100, or all of the deal file)\n"
+    "  --seed N        seed of deals and of AI players (default 1)\n"
+    "  --deal-file F   take deals from deal file F\n"
+    "  --jobs N        worker processes (default: number of cores)\n"
+    "  --verbose       print result of every deal\n");
+}
+
+
+int main (int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  Options opt;
+  opt.engines[0] = DealRecord::EngineOriginal;
+  opt.engines[1] = DealRecord::EngineAlphaBeta;
+  opt.deals = 0;
+  opt.seed = 1;
+  opt.jobs = qMax(1, QThread::idealThreadCount());
+  opt.verbose = false;
+  int worker = -1, workers = 1;
+  QStringList args; // passed on to workers
+  for (int f = 1; f < argc; f++) {
+    QString arg(argv[f]);
+    if (arg == "--verbose") {
+      opt.verbose = true;
+      continue;
+    }
+    if (!arg.startsWith("--") || f+1 >= argc) {
+      usage();
+      return 1;
+    }
+    QString val(argv[++f]);
+    bool ok = true;
+    if (arg == "--a" || arg == "--b") {
+      int e = DealRecord::engineCode(val);
+      opt.engines[arg == "--b"] = e;
+      ok = e == DealRecord::EngineOriginal || e == DealRecord::EngineAlphaBeta;
+    } else if (arg == "--deals") {
+      opt.deals = val.toInt(&ok);
+      ok = ok && opt.deals > 0;
+    } else if (arg == "--seed") {
+      opt.seed = val.toULongLong(&ok);
+    } else if (arg == "--deal-file") {
+      opt.dealFile = val;
+    } else if (arg == "--jobs") {
+      opt.jobs = val.toInt(&ok);
+      ok = ok && opt.jobs > 0;
+    } else if (arg == "--worker") {
+      QStringList parts = val.split('/');
+      bool ok2 = false;
+      if (parts.size() == 2) {
+        worker = parts[0].toInt(&ok);
+        workers = parts[1].toInt(&ok2);
+      }
+      ok = ok && ok2 && worker >= 0 && worker < workers;
+    } else ok = false;
+    if (!ok) {
+      usage();
+      return 1;
+    }
+    if (arg != "--worker") args << arg << val;
+  }
+  if (opt.engines[0] == opt.engines[1]) {
+    fprintf(stderr, "engines A and B are the same\n");
+    return 1;
+  }
+  if (!opt.deals) opt.deals = opt.dealFile.isEmpty() ? 100 : -1;
+
+  qInstallMsgHandler(quietMessages);
+  if (worker >= 0) return runWorker(opt, worker, workers);
+  return runParent(opt, args);
+}
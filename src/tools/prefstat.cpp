@@ -0,0 +1,380 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+/*
+ * prefstat - statistics over deal archives
+ *
+ * Example: how often declarer goes down in 7NT with two aces
+ *   prefstat --contract 7NT --count A=2 --group contract,result deals.opda
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTime>
+#include <QVector>
+#ifndef QT_NO_CONCURRENT
+# include <QtConcurrentMap>
+#endif
+
+#include "prfconst.h"
+#include "card.h"
+#include "dealrecord.h"
+
+
+// records are scanned in blocks; hand predicates run over a column of masks
+static const int BlockSize = 256;
+static const int ChunkSize = 64*1024; // records per job
+static const int MaxCounts = 4;
+
+// result codes: 0 - made, n - down n, NoResult - nobody played
+static const int NoResult = 11;
+static const int Results = 12;
+static const int Contracts = g105+1;
+
+
+struct Query {
+  int contract; // 0 is any
+  int seat;     // 0 is declarer
+  quint32 has;  // subject must hold all these cards
+  quint32 hasNot;
+  int counts;
+  quint32 countMask[MaxCounts];
+  int countMin[MaxCounts], countMax[MaxCounts];
+  bool byContract, bySeat, byResult;
+};
+
+
+struct Cell {
+  quint64 deals;
+  quint64 tricks;
+  qint64 points; // declarer's pool points
+};
+
+
+struct ScanJob {
+  DealArchive *archive;
+  const Query *query;
+  int from, to;
+  QVector<Cell> cells; // [contract][seat][result]
+};
+
+
+static inline int cellNo (int contract, int seat, int result) {
+  return (contract*4+seat)*Results+result;
+}
+
+
+static inline quint32 get32 (const uchar *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((quint32)p[3] << 24);
+}
+
+
+// SWAR bit count: plain integer operations, so loops over it vectorize
+static inline quint32 bitCount (quint32 m) {
+  m = m-((m >> 1) & 0x55555555u);
+  m = (m & 0x33333333u)+((m >> 2) & 0x33333333u);
+  m = (m+(m >> 4)) & 0x0f0f0f0fu;
+  return (m*0x01010101u) >> 24;
+}
+
+
+// Hand the query is about: seat's hand as dealt; declarer also gets the
+// talon and loses the drop. Returns 0 if there is no such player
+static quint32 subjectHand (const uchar *r, int seat) {
+  int decl = r[DealRecord::OfsDeclarer];
+  if (!seat) seat = decl;
+  if (seat < 1 || seat > 3) return 0;
+  quint32 hand = get32(r+DealRecord::OfsHands+(seat-1)*4);
+  if (seat == decl) {
+    hand |= cardIdMask(r[DealRecord::OfsTalon]) | cardIdMask(r[DealRecord::OfsTalon+1]);
+    hand &= ~(cardIdMask(r[DealRecord::OfsDrop]) | cardIdMask(r[DealRecord::OfsDrop+1]));
+  }
+  return hand;
+}
+
+
+static int dealResult (const uchar *r, int *points) {
+  int decl = r[DealRecord::OfsDeclarer], game = r[DealRecord::OfsGame];
+  *points = 0;
+  if (decl < 1 || decl > 3 || game < g61 || game > g105) return NoResult;
+  int tricks = r[DealRecord::OfsTricks+decl-1], price = gamePoolPrice((eGameBid)game);
+  int down = (game == g86) ? tricks : qMax(gameTricks((eGameBid)game)-tricks, 0);
+  *points = down ? -price*down : price;
+  return qMin(down, NoResult-1);
+}
+
+
+static void scanChunk (ScanJob &job) {
+  const Query &q = *job.query;
+  job.cells.fill(Cell());
+  const uchar *recs[BlockSize];
+  quint32 hands[BlockSize];
+  uchar pass[BlockSize];
+  uchar scratch[BlockSize][DealRecord::RecordSize]; // unmapped archives only
+  DealRecord rec;
+
+  for (int base = job.from; base < job.to; base += BlockSize) {
+    int n = qMin(BlockSize, job.to-base);
+    // gather column of subject hands
+    for (int f = 0; f < n; f++) {
+      const uchar *r = job.archive->rawRecord(base+f);
+      if (!r && job.archive->record(base+f, &rec)) {
+        rec.pack(scratch[f]);
+        r = scratch[f];
+      }
+      recs[f] = r;
+      hands[f] = r ? subjectHand(r, q.seat) : 0;
+    }
+    // predicates over the column
+    for (int f = 0; f < n; f++) {
+      quint32 h = hands[f];
+      pass[f] = (h != 0) & ((h & q.has) == q.has) & ((h & q.hasNot) == 0);
+    }
+    for (int k = 0; k < q.counts; k++) {
+      quint32 m = q.countMask[k];
+      int lo = q.countMin[k], hi = q.countMax[k];
+      for (int f = 0; f < n; f++) {
+        int cnt = bitCount(hands[f] & m);
+        pass[f] &= (cnt >= lo) & (cnt <= hi);
+      }
+    }
+    // group what passed
+    for (int f = 0; f < n; f++) {
+      if (!pass[f]) continue;
+      const uchar *r = recs[f];
+      int c = r[DealRecord::OfsGame];
+      if (c >= Contracts || (q.contract && c != q.contract)) continue;
+      int points, res = dealResult(r, &points), decl = r[DealRecord::OfsDeclarer];
+      Cell &cell = job.cells[cellNo(q.byContract ? c : 0, q.bySeat ? decl & 3 : 0, q.byResult ? res : 0)];
+      cell.deals++;
+      if (decl >= 1 && decl <= 3) cell.tricks += r[DealRecord::OfsTricks+decl-1];
+      cell.points += points;
+    }
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+static QString gameName (int game) {
+  QString s(sGameName((eGameBid)game));
+  s.remove('\1');
+  return s.trimmed();
+}
+
+
+static int parseContract (const QString &s) {
+  for (int g = g61; g <= g105; g++) {
+    if (!QString(sGameName((eGameBid)g)).isEmpty() && !gameName(g).compare(s, Qt::CaseInsensitive)) return g;
+  }
+  if (!gameName(raspass).compare(s, Qt::CaseInsensitive)) return raspass;
+  return -1;
+}
+
+
+static int parseFace (const QString &s) {
+  static const char *faces[] = { "7", "8", "9", "10", "J", "Q", "K", "A" };
+  for (int f = 0; f < 8; f++) if (!s.compare(faces[f], Qt::CaseInsensitive)) return f+7;
+  return 0;
+}
+
+
+static int parseSuit (QChar c) {
+  switch (c.toLower().toLatin1()) {
+    case 's': return 1;
+    case 'c': return 2;
+    case 'd': return 3;
+    case 'h': return 4;
+    default: ;
+  }
+  return 0;
+}
+
+
+// "A+Kh+s": all aces, king of hearts and all spades
+static bool parseCards (const QString &s, quint32 *mask) {
+  *mask = 0;
+  foreach (const QString &tok, s.split('+', QString::SkipEmptyParts)) {
+    int face = parseFace(tok), suit = 0;
+    if (!face && tok.length() == 1) suit = parseSuit(tok[0]);
+    if (!face && !suit && tok.length() >= 2) {
+      face = parseFace(tok.left(tok.length()-1));
+      suit = parseSuit(tok[tok.length()-1]);
+      if (!face || !suit) return false;
+    }
+    if (!face && !suit) return false;
+    for (int st = 1; st <= 4; st++) {
+      if (suit && st != suit) continue;
+      for (int fc = 7; fc <= FACE_ACE; fc++)
+        if (!face || fc == face) *mask |= cardIdMask(cardId(fc, st));
+    }
+  }
+  return *mask != 0;
+}
+
+
+// "A=2", "h=5-", "K+Q=1-3"
+static bool parseCount (const QString &s, quint32 *mask, int *lo, int *hi) {
+  int eq = s.indexOf('=');
+  if (eq < 0 || !parseCards(s.left(eq), mask)) return false;
+  QString range = s.mid(eq+1);
+  int dash = range.indexOf('-');
+  bool ok1 = true, ok2 = true;
+  if (dash < 0) {
+    *lo = *hi = range.toInt(&ok1);
+  } else {
+    *lo = dash ? range.left(dash).toInt(&ok1) : 0;
+    *hi = dash < range.length()-1 ? range.mid(dash+1).toInt(&ok2) : 32;
+  }
+  return ok1 && ok2 && *lo <= *hi;
+}
+
+
+static void usage () {
+  fprintf(stderr,
+    "usage: prefstat [options] archive...\n"
+    "  --contract GAME   only deals played in GAME (6s .. 10NT, Misere, pass-out)\n"
+    "  --seat N          ask about player N instead of declarer\n"
+    "  --has CARDS       player holds all CARDS\n"
+    "  --hasnot CARDS    player holds none of CARDS\n"
+    "  --count CARDS=N[-M]  player holds N (to M) of CARDS; may be repeated\n"
+    "  --group LIST      group by contract, seat, result (comma separated)\n"
+    "  --threads N       number of worker threads\n"
+    "CARDS are joined with '+': faces (A), suits (h) or cards (10h).\n"
+    "Declarer's hand includes the talon and excludes the drop.\n");
+}
+
+
+int main (int argc, char *argv[]) {
+  Query q;
+  memset(&q, 0, sizeof(q));
+  q.byContract = q.byResult = true;
+  QStringList files;
+
+  for (int f = 1; f < argc; f++) {
+    QString arg(argv[f]);
+    if (!arg.startsWith("--")) {
+      files << arg;
+      continue;
+    }
+    if (f+1 >= argc) { usage(); return 1; }
+    QString val(argv[++f]);
+    bool ok = true;
+    if (arg == "--contract") {
+      q.contract = parseContract(val);
+      ok = q.contract > 0;
+    } else if (arg == "--seat") {
+      q.seat = val.toInt(&ok);
+      ok = ok && q.seat >= 1 && q.seat <= 3;
+    } else if (arg == "--has") {
+      ok = parseCards(val, &q.has);
+    } else if (arg == "--hasnot") {
+      ok = parseCards(val, &q.hasNot);
+    } else if (arg == "--count") {
+      ok = q.counts < MaxCounts &&
+        parseCount(val, &q.countMask[q.counts], &q.countMin[q.counts], &q.countMax[q.counts]);
+      if (ok) q.counts++;
+    } else if (arg == "--group") {
+      q.byContract = q.bySeat = q.byResult = false;
+      foreach (const QString &g, val.split(',', QString::SkipEmptyParts)) {
+        if (g == "contract") q.byContract = true;
+        else if (g == "seat") q.bySeat = true;
+        else if (g == "result") q.byResult = true;
+        else ok = false;
+      }
+    } else if (arg == "--threads") {
+      int n = val.toInt(&ok);
+      if (ok && n > 0) QThreadPool::globalInstance()->setMaxThreadCount(n);
+    } else ok = false;
+    if (!ok) {
+      fprintf(stderr, "bad option: %s %s\n", argv[f-1], argv[f]);
+      usage();
+      return 1;
+    }
+  }
+  if (files.isEmpty()) {
+    usage();
+    return 1;
+  }
+
+  QTime timer;
+  timer.start();
+  QVector<Cell> total(Contracts*4*Results);
+  quint64 scanned = 0;
+  foreach (const QString &fn, files) {
+    DealArchive archive;
+    if (!archive.open(fn)) {
+      fprintf(stderr, "can't open archive %s\n", qPrintable(fn));
+      return 1;
+    }
+    QVector<ScanJob> jobs;
+    for (int from = 0; from < archive.count(); from += ChunkSize) {
+      ScanJob job;
+      job.archive = &archive;
+      job.query = &q;
+      job.from = from;
+      job.to = qMin(from+ChunkSize, archive.count());
+      job.cells.resize(total.size());
+      jobs << job;
+    }
+#ifndef QT_NO_CONCURRENT
+    QtConcurrent::blockingMap(jobs, scanChunk);
+#else
+    for (int f = 0; f < jobs.size(); f++) scanChunk(jobs[f]);
+#endif
+    for (int j = 0; j < jobs.size(); j++) {
+      for (int c = 0; c < total.size(); c++) {
+        total[c].deals += jobs[j].cells[c].deals;
+        total[c].tricks += jobs[j].cells[c].tricks;
+        total[c].points += jobs[j].cells[c].points;
+      }
+    }
+    scanned += archive.count();
+  }
+
+  quint64 matched = 0;
+  for (int c = 0; c < total.size(); c++) matched += total[c].deals;
+  printf("%-10s %-4s %-8s %10s %7s %7s %8s\n", "contract", "seat", "result", "deals", "%",
+    "tricks", "points");
+  for (int g = 0; g < Contracts; g++) {
+    for (int s = 0; s < 4; s++) {
+      for (int r = 0; r < Results; r++) {
+        const Cell &cell = total[cellNo(g, s, r)];
+        if (!cell.deals) continue;
+        QString res("-");
+        if (q.byResult && r != NoResult) res = r ? QString("down %1").arg(r) : QString("made");
+        QString seat = q.bySeat && s ? QString::number(s) : QString("-");
+        printf("%-10s %-4s %-8s %10llu %7.2f %7.2f %8.3f\n",
+          q.byContract ? qPrintable(gameName(g)) : "-", qPrintable(seat), qPrintable(res),
+          (unsigned long long)cell.deals, 100.0*cell.deals/matched,
+          (double)cell.tricks/cell.deals, (double)cell.points/cell.deals);
+      }
+    }
+  }
+  fprintf(stderr, "%llu of %llu deals matched in %.2f s\n", (unsigned long long)matched,
+    (unsigned long long)scanned, timer.elapsed()/1000.0);
+  return 0;
+}
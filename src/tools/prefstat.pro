@@ -0,0 +1,16 @@
+# Statistics over deal archives (see prefstat.cpp)
+TEMPLATE = app
+TARGET = prefstat
+QT = core
+CONFIG += console warn_on
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD/.. $$PWD/../model
+
+SOURCES += \
+  $$PWD/prefstat.cpp \
+  $$PWD/../prfconst.cpp \
+  $$PWD/../model/dealrecord.cpp
+
+DESTDIR = .
+OBJECTS_DIR = _build/obj
@@ -0,0 +1,476 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+/*
+ * solvercheck - regression run of DDSolver and AbcSearch over a stored corpus
+ *
+ * Every corpus line is a position with its exact trick value, the set of
+ * best moves and the node count and time it took when the corpus was made.
+ * AbcSearch positions (kind a) store the card AlphaBetaPlayer plays and
+ * the score of its line instead. The run fails if a result differs or
+ * nodes exceed the stored baseline by more than the allowed margin; time
+ * depends on the machine and load, so it is only checked on request.
+ * Tables of DDSolver::calcTable() for the first full deals of the corpus
+ * are checked against separate solves as well.
+ *
+ * Examples:
+ *   solvercheck ddcorpus.txt
+ *   solvercheck --node-margin 0 --check-time ddcorpus.txt
+ *   solvercheck --generate ddcorpus.txt --count 150
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <QString>
+#include <QTime>
+#include <QVector>
+#ifdef Q_OS_LINUX
+# include <time.h>
+#endif
+
+#include "ddsolver.h"
+#include "abcsearch.h"
+#include "prng.h"
+
+
+// position kinds and numbers of cards left in every hand
+static const char sKinds[] = "tnmpa"; // trump, no-trump, misere, pass-out, AbcSearch
+static const int sDepths[] = { 10, 7, 4, 2 };
+static const int Kinds = 5, Depths = 4;
+
+
+struct Position {
+  char kind;
+  int strain, leader, seat; // players 1..3
+  quint32 hands[3];
+  int table[2], tableCnt;
+  int value;    // tricks of seat from here, current trick included (kind a: score)
+  quint32 best; // best cards of the player to move (kind a: the card played)
+  quint64 nodes;
+  int usec;
+
+  bool misere () const { return kind == 'm' || kind == 'p'; }
+  int mover () const { return (leader-1+tableCnt)%3+1; }
+  int cardsLeft () const;
+};
+
+
+static inline int bitCount (quint32 m) {
+  int res = 0;
+  for (; m; m &= m-1) res++;
+  return res;
+}
+
+
+static inline int lowBit (quint32 m) {
+  int res = 0;
+  while (!(m & 1)) { m >>= 1; res++; }
+  return res;
+}
+
+
+int Position::cardsLeft () const {
+  return (bitCount(hands[0] | hands[1] | hands[2])+tableCnt)/3;
+}
+
+
+static double nowUsec () {
+#ifdef Q_OS_LINUX
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1e6+ts.tv_nsec/1e3;
+#else
+  static QTime timer;
+  if (timer.isNull()) timer.start();
+  return timer.elapsed()*1e3;
+#endif
+}
+
+
+// Solves @a p with empty cache; fills value, best moves, nodes and time.
+// Time is the best of @a repeat runs, which filters out most of the noise
+static void solve (DDSolver &solver, Position &p, int repeat) {
+  if (p.kind == 'a') {
+    // the search plays for seat, who is the player to move
+    static const int tricks[3] = { 0, 0, 0 };
+    double best = 0;
+    for (int r = 0; r < repeat; r++) {
+      SearchStats stats;
+      double start = nowUsec();
+      int card = AbcSearch::bestMove(p.hands, tricks, p.table, p.tableCnt, p.seat, p.strain, false, 0, stats, &p.value);
+      double usec = nowUsec()-start;
+      if (!r || usec < best) best = usec;
+      p.best = 1u << card;
+      p.nodes = stats.totalNodes();
+    }
+    p.usec = (int)(best+0.5);
+    return;
+  }
+
+  int values[32];
+  quint32 moves = 0;
+  double best = 0;
+  for (int r = 0; r < repeat; r++) {
+    solver.clearCache();
+    quint64 nodes = solver.nodes();
+    double start = nowUsec();
+    p.value = solver.solvePosition(p.hands, p.strain, p.leader, p.table, p.tableCnt, p.seat, p.misere());
+    moves = solver.solveMoves(p.hands, p.strain, p.leader, p.table, p.tableCnt, p.seat, p.misere(), values);
+    double usec = nowUsec()-start;
+    if (!r || usec < best) best = usec;
+    p.nodes = solver.nodes()-nodes;
+  }
+  p.usec = (int)(best+0.5);
+
+  // values are seat's tricks; seat wants more of them (fewer in misere)
+  bool wantMore = (p.mover() == p.seat) != p.misere();
+  int bestValue = wantMore ? -1 : 99;
+  for (quint32 m = moves; m; m &= m-1) {
+    int v = values[lowBit(m)];
+    if (wantMore ? v > bestValue : v < bestValue) bestValue = v;
+  }
+  p.best = 0;
+  for (quint32 m = moves; m; m &= m-1) {
+    int c = lowBit(m);
+    if (values[c] == bestValue) p.best |= 1u << c;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+static void writePosition (FILE *fo, const Position &p) {
+  fprintf(fo, "%c %d %d %d %08x %08x %08x ", p.kind, p.strain, p.leader, p.seat,
+    p.hands[0], p.hands[1], p.hands[2]);
+  if (!p.tableCnt) fprintf(fo, "-");
+  for (int f = 0; f < p.tableCnt; f++) fprintf(fo, f ? ",%d" : "%d", p.table[f]);
+  fprintf(fo, " %d %08x %llu %d\n", p.value, p.best, (unsigned long long)p.nodes, p.usec);
+}
+
+
+static bool readPosition (const char *line, Position &p) {
+  char table[16];
+  unsigned long long nodes;
+  memset(&p, 0, sizeof(p));
+  if (sscanf(line, " %c %d %d %d %x %x %x %15s %d %x %llu %d", &p.kind, &p.strain, &p.leader, &p.seat,
+      &p.hands[0], &p.hands[1], &p.hands[2], table, &p.value, &p.best, &nodes, &p.usec) != 12) return false;
+  p.nodes = nodes;
+  if (!strchr(sKinds, p.kind) || p.strain < 1 || p.strain > 5 || p.leader < 1 || p.leader > 3 ||
+      p.seat < 1 || p.seat > 3) return false;
+  if (strcmp(table, "-")) {
+    p.tableCnt = sscanf(table, "%d,%d", &p.table[0], &p.table[1]);
+    if (p.tableCnt < 1) return false;
+    for (int f = 0; f < p.tableCnt; f++) if (p.table[f] < 0 || p.table[f] > 31) return false;
+  }
+  return p.kind != 'a' || p.seat == p.mover();
+}
+
+
+static bool readCorpus (const char *fileName, QVector<Position> &corpus) {
+  FILE *fi = fopen(fileName, "r");
+  if (!fi) {
+    fprintf(stderr, "can't open corpus %s\n", fileName);
+    return false;
+  }
+  char line[256];
+  int lineNo = 0;
+  Position p;
+  while (fgets(line, sizeof(line), fi)) {
+    lineNo++;
+    if (line[0] == '#' || line[0] == '\n') continue;
+    if (!readPosition(line, p)) {
+      fprintf(stderr, "%s:%d: bad position\n", fileName, lineNo);
+      fclose(fi);
+      return false;
+    }
+    corpus << p;
+  }
+  fclose(fi);
+  return true;
+}
+
+
+static bool writeCorpus (const char *fileName, const QVector<Position> &corpus) {
+  FILE *fo = fopen(fileName, "w");
+  if (!fo) {
+    fprintf(stderr, "can't write corpus %s\n", fileName);
+    return false;
+  }
+  fprintf(fo,
+    "# DDSolver and AbcSearch regression corpus, see src/tools/solvercheck.cpp\n"
+    "# kind: t trump, n no-trump, m misere, p pass-out (seat avoids tricks),\n"
+    "#   a AbcSearch (seat moves; value is its score, best the card it plays)\n"
+    "# kind strain leader seat hand1 hand2 hand3 table value best nodes usec\n");
+  for (int f = 0; f < corpus.size(); f++) writePosition(fo, corpus[f]);
+  return fclose(fo) == 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Random position of @a kind with @a cards cards left; the current trick
+// may already have one or two cards
+static Position randomPosition (Prng &rng, char kind, int cards) {
+  Position p;
+  memset(&p, 0, sizeof(p));
+  p.kind = kind;
+  p.strain = kind == 't' ? rng.bounded(4)+1 : kind == 'a' ? rng.bounded(DDNoTrump)+1 : DDNoTrump;
+  p.leader = rng.bounded(3)+1;
+  p.seat = rng.bounded(3)+1;
+
+  int deck[32];
+  for (int f = 0; f < 32; f++) deck[f] = f;
+  for (int f = 31; f > 0; f--) qSwap(deck[f], deck[rng.bounded(f+1)]);
+  for (int h = 0; h < 3; h++)
+    for (int f = 0; f < cards; f++) p.hands[h] |= 1u << deck[h*cards+f];
+
+  int tableCnt = rng.bounded(3);
+  for (int f = 0; f < tableCnt; f++) {
+    quint32 &hand = p.hands[(p.leader-1+f)%3];
+    quint32 moves = DDSolver::legalMoves(hand, p.table, f, p.strain);
+    int n = rng.bounded(bitCount(moves));
+    while (n--) moves &= moves-1;
+    p.table[f] = lowBit(moves);
+    hand &= ~(1u << p.table[f]);
+  }
+  p.tableCnt = tableCnt;
+  if (kind == 'a') p.seat = p.mover();
+  return p;
+}
+
+
+static int generate (const char *fileName, int count, quint64 seed, int repeat) {
+  DDSolver solver;
+  Prng rng(seed);
+  QVector<Position> corpus;
+  for (int k = 0; k < Kinds; k++) {
+    for (int d = 0; d < Depths; d++) {
+      for (int f = 0; f < count; f++) {
+        Position p = randomPosition(rng, sKinds[k], sDepths[d]);
+        solve(solver, p, repeat);
+        corpus << p;
+      }
+    }
+  }
+  if (!writeCorpus(fileName, corpus)) return 1;
+  printf("%d positions written to %s\n", corpus.size(), fileName);
+  return 0;
+}
+
+
+/*
+ * Compares DDSolver::calcTable() with separate solves from empty cache for
+ * the first @a count corpus positions that are full deals; returns the
+ * number of wrong tables
+ */
+static int checkTables (const QVector<Position> &corpus, int count) {
+  DDSolver batch, single;
+  int deals = 0, failed = 0;
+  double batchUsec = 0, singleUsec = 0;
+  for (int f = 0; f < corpus.size() && deals < count; f++) {
+    const Position &p = corpus[f];
+    if (p.tableCnt || p.cardsLeft() != 10) continue;
+    deals++;
+    DDTable table;
+    double start = nowUsec();
+    batch.calcTable(p.hands, table);
+    batchUsec += nowUsec()-start;
+    bool ok = true;
+    for (int strain = 1; strain <= DDNoTrump; strain++) {
+      for (int leader = 1; leader <= 3; leader++) {
+        for (int seat = 1; seat <= 3; seat++) {
+          single.clearCache();
+          start = nowUsec();
+          int v = single.solve(p.hands, strain, leader, seat);
+          singleUsec += nowUsec()-start;
+          if (v != table.tricks(strain, leader, seat)) ok = false;
+        }
+      }
+    }
+    if (!ok) {
+      failed++;
+      printf("FAIL table of position %d\n", f+1);
+    }
+  }
+  printf("%d tables, %d failed; %.1f ms in calcTable, %.1f ms in separate solves\n",
+    deals, failed, batchUsec/1000, singleUsec/1000);
+  return failed;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+struct Options {
+  double nodeMargin; // allowed growth, parts of baseline
+  double timeMargin;
+  int timeSlack;     // usec allowed over any baseline (timer noise)
+  int repeat;        // runs of every position, the fastest one counts
+  bool checkTime;
+  bool update;
+  int tables;        // full deals to check calcTable() on
+};
+
+
+struct Summary {
+  int positions, failed;
+  quint64 nodes, baseNodes;
+  double usec, baseUsec;
+};
+
+
+static int depthNo (int cards) {
+  for (int d = 0; d < Depths; d++) if (sDepths[d] == cards) return d;
+  return -1;
+}
+
+
+static int check (const char *fileName, const Options &opt) {
+  QVector<Position> corpus;
+  if (!readCorpus(fileName, corpus)) return 1;
+  DDSolver solver;
+  Summary sum[Kinds][Depths+1];
+  memset(sum, 0, sizeof(sum));
+  int failed = 0;
+
+  for (int f = 0; f < corpus.size(); f++) {
+    const Position &base = corpus[f];
+    Position p = base;
+    solve(solver, p, opt.repeat);
+    QString why;
+    if (p.value != base.value) why += QString(" value %1, expected %2").arg(p.value).arg(base.value);
+    if (p.best != base.best) why += QString(" best %1, expected %2").arg(p.best, 8, 16, QChar('0')).arg(base.best, 8, 16, QChar('0'));
+    if (p.nodes > base.nodes*(1+opt.nodeMargin))
+      why += QString(" nodes %1, baseline %2").arg(p.nodes).arg(base.nodes);
+    if (opt.checkTime && p.usec > base.usec*(1+opt.timeMargin)+opt.timeSlack)
+      why += QString(" %1 us, baseline %2 us").arg(p.usec).arg(base.usec);
+    if (!why.isEmpty()) {
+      failed++;
+      printf("FAIL position %d (%c, %d cards):%s\n", f+1, base.kind, base.cardsLeft(), qPrintable(why));
+    }
+    int k = strchr(sKinds, base.kind)-sKinds, d = depthNo(base.cardsLeft());
+    if (d < 0) d = Depths;
+    Summary &s = sum[k][d];
+    s.positions++;
+    if (!why.isEmpty()) s.failed++;
+    s.nodes += p.nodes;
+    s.baseNodes += base.nodes;
+    s.usec += p.usec;
+    s.baseUsec += base.usec;
+    if (opt.update && p.value == base.value && p.best == base.best) {
+      corpus[f].nodes = p.nodes;
+      corpus[f].usec = p.usec;
+    }
+  }
+
+  printf("%-9s %5s %9s %6s %14s %8s %12s %8s\n", "kind", "cards", "positions", "failed",
+    "nodes", "vs base", "ms", "vs base");
+  for (int k = 0; k < Kinds; k++) {
+    for (int d = 0; d <= Depths; d++) {
+      const Summary &s = sum[k][d];
+      if (!s.positions) continue;
+      static const char *names[Kinds] = { "trump", "no-trump", "misere", "pass-out", "abc" };
+      printf("%-9s %5s %9d %6d %14llu %7.1f%% %12.1f %7.1f%%\n", names[k],
+        d < Depths ? qPrintable(QString::number(sDepths[d])) : "other", s.positions, s.failed,
+        (unsigned long long)s.nodes, s.baseNodes ? 100.0*s.nodes/s.baseNodes : 0.0,
+        s.usec/1000, s.baseUsec > 0 ? 100.0*s.usec/s.baseUsec : 0.0);
+    }
+  }
+  printf("%d positions, %d failed\n", corpus.size(), failed);
+  if (opt.tables && checkTables(corpus, opt.tables)) failed++;
+  if (opt.update) {
+    if (!writeCorpus(fileName, corpus)) return 1;
+    printf("baseline of %s updated\n", fileName);
+  }
+  return failed ? 1 : 0;
+}
+
+
+static void usage () {
+  fprintf(stderr,
+    "usage: solvercheck [options] corpus\n"
+    "  --node-margin PCT  allowed growth of nodes over baseline (default 10)\n"
+    "  --check-time       check time too (results and nodes only by default)\n"
+    "  --time-margin PCT  allowed growth of time over baseline (default 100)\n"
+    "  --time-slack US    extra time allowed for every position (default 500)\n"
+    "  --repeat N         time the best of N runs of every position (default 3)\n"
+    "  --update           store nodes and time of this run as new baseline\n"
+    "  --tables N         check calcTable() on N full deals (default 8)\n"
+    "  --generate         write new corpus instead of checking it\n"
+    "  --count N          positions of every kind and depth to generate (default 150)\n"
+    "  --seed S           seed of generated positions\n");
+}
+
+
+int main (int argc, char *argv[]) {
+  Options opt;
+  opt.nodeMargin = 0.1;
+  opt.timeMargin = 1.0;
+  opt.timeSlack = 500;
+  opt.repeat = 3;
+  opt.checkTime = false;
+  opt.update = false;
+  opt.tables = 8;
+  bool gen = false;
+  int count = 150;
+  quint64 seed = 20100101;
+  const char *fileName = 0;
+
+  for (int f = 1; f < argc; f++) {
+    QString arg(argv[f]);
+    if (!arg.startsWith("--")) {
+      if (fileName) { usage(); return 1; }
+      fileName = argv[f];
+      continue;
+    }
+    if (arg == "--check-time") { opt.checkTime = true; continue; }
+    if (arg == "--update") { opt.update = true; continue; }
+    if (arg == "--generate") { gen = true; continue; }
+    if (f+1 >= argc) { usage(); return 1; }
+    QString val(argv[++f]);
+    bool ok = true;
+    if (arg == "--node-margin") opt.nodeMargin = val.toDouble(&ok)/100;
+    else if (arg == "--time-margin") opt.timeMargin = val.toDouble(&ok)/100;
+    else if (arg == "--time-slack") opt.timeSlack = val.toInt(&ok);
+    else if (arg == "--repeat") {
+      opt.repeat = val.toInt(&ok);
+      ok = ok && opt.repeat > 0;
+    }
+    else if (arg == "--tables") {
+      opt.tables = val.toInt(&ok);
+      ok = ok && opt.tables >= 0;
+    }
+    else if (arg == "--count") {
+      count = val.toInt(&ok);
+      ok = ok && count > 0;
+    } else if (arg == "--seed") seed = val.toULongLong(&ok);
+    else ok = false;
+    if (!ok) {
+      fprintf(stderr, "bad option: %s %s\n", argv[f-1], argv[f]);
+      usage();
+      return 1;
+    }
+  }
+  if (!fileName) {
+    usage();
+    return 1;
+  }
+  return gen ? generate(fileName, count, seed, opt.repeat) : check(fileName, opt);
+}
@@ -0,0 +1,20 @@
+# Regression run of DDSolver and AbcSearch over stored positions (see solvercheck.cpp)
+TEMPLATE = app
+TARGET = solvercheck
+QT = core
+CONFIG += console warn_on
+CONFIG -= app_bundle
+
+INCLUDEPATH += $$PWD/.. $$PWD/../model $$PWD/../logic
+
+SOURCES += \
+  $$PWD/solvercheck.cpp \
+  $$PWD/../logic/ddsolver.cpp \
+  $$PWD/../logic/abcsearch.cpp \
+  $$PWD/../logic/searchstats.cpp \
+  $$PWD/../model/prng.cpp
+
+linux-*:LIBS += -lrt
+
+DESTDIR = .
+OBJECTS_DIR = _build/obj
@@ -0,0 +1,272 @@
+/*
+ *      OpenPref - cross-platform Preferans game
+ *      
+ *      Copyright (C) 2000-2010 OpenPref Developers
+ *      (see file AUTHORS for more details)
+ *      Contact: annulen@users.sourceforge.net
+ *      
+ *      OpenPref is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *      
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *      
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program (see file COPYING); if not, see 
+ *      http://www.gnu.org/licenses 
+ */
+
+/*
+ * tracereplay - asks an engine of this build the decisions of a trace
+ *
+ * The game writes a trace when OPENPREF_DECISION_TRACE names a file. Every
+ * card play and bid of the trace is given to the chosen engine in the same
+ * position; the tool reports how often it decides otherwise and how its
+ * time compares to the recorded one. Drops and whist choices are counted
+ * but not replayed. Engines start every decision afresh: cards played so
+ * far in the deal are played out again before it, trick counts included,
+ * and random streams start from the seed the decision had in the game
+ * (traces written before the seed was recorded give 0).
+ *
+ * Example: how AlphaBeta of this build differs from recorded AI players
+ *   tracereplay --engine AlphaBeta --only Original trace.opdt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QtAlgorithms>
+
+#include "prfconst.h"
+#include "card.h"
+#include "cardlist.h"
+#include "dealrecord.h"
+#include "decisiontrace.h"
+#include "desktop.h"
+#include "monoclock.h"
+#include "player.h"
+
+
+struct Group {
+  int decisions;
+  int replayed;
+  int differ;
+  quint64 recordedUsec; // over replayed decisions
+  quint64 replayUsec;
+  QVector<double> ratios; // replay time to recorded one
+
+  Group () : decisions(0), replayed(0), differ(0), recordedUsec(0), replayUsec(0) {}
+};
+
+
+static void setHand (Player *plr, quint32 mask) {
+  plr->mCards.clear();
+  for (CardId id = 0; id < 32; id++) {
+    if (mask & cardIdMask(id)) plr->mCards.insertId(id);
+  }
+  plr->mCards.mySort();
+}
+
+
+// puts options and score of the record into the model
+static void setupModel (PrefModel *model, const TraceRecord &t) {
+  model->optStalingrad = t.options & TraceRecord::OptStalingrad;
+  model->opt10Whist = t.options & TraceRecord::Opt10Whist;
+  model->optWhistGreedy = t.options & TraceRecord::OptWhistGreedy;
+  model->optAggPass = t.options & TraceRecord::OptAggPass;
+  model->optWithoutThree = t.options & TraceRecord::OptWithoutThree;
+  model->optPassCount = t.passCount;
+  model->optMaxPool = t.maxPool;
+  model->nCurrentStart.nValue = t.first;
+  model->nCurrentMove.nValue = t.seat;
+  model->setCurrentGame((eGameBid)t.game);
+}
+
+
+/*
+ * Plays the cards of the deal before the decision: they leave hands of
+ * @a plrs for their mCardsOut, every player is told of them and winners
+ * of finished tricks get the tricks. Hands must still hold these cards
+ */
+static void replayPlay (Player *plrs[3], const TraceRecord &t) {
+  int trump = t.game%10;
+  CardId trick[3];
+  int leader = 0;
+  for (int f = 0; f < t.playCount; f++) {
+    int who = t.play[f] >> 5, n = f%3;
+    CardId id = t.play[f] & 31;
+    if (who < 1 || who > 3) return;
+    trick[n] = id;
+    if (!n) leader = who;
+    Card *card = cardFromId(id);
+    plrs[who-1]->mCards.remove(card);
+    plrs[who-1]->mCardsOut.insert(card);
+    for (int p = 0; p < 3; p++) plrs[p]->cardPlayed(who, id);
+    if (n == 2) plrs[(leader-1+whoseTrick(trick[0], trick[1], trick[2], trump)-1)%3]->gotTrick();
+  }
+}
+
+
+/*
+ * Returns choice of @a engine in the position of @a t or -1 if the kind of
+ * decision isn't replayed; time goes to @a usec
+ */
+static int replay (const TraceRecord &t, int engine, quint64 *usec) {
+  if (t.kind != DealRecord::DecMove && t.kind != DealRecord::DecBid) return -1;
+  if (t.seat < 1 || t.seat > 3) return -1;
+  PrefModel model(0);
+  // engines look at other players through the model as well
+  model.setEngines(engine, engine, engine);
+  setupModel(&model, t);
+  model.aiRandom().setSeed(t.aiSeed);
+  qsrand(t.aiSeed);
+  // hands as they were before the cards of the record were played
+  quint32 hands[3] = { t.hands[0], t.hands[1], t.hands[2] };
+  for (int f = 0; f < t.playCount; f++) {
+    int who = t.play[f] >> 5;
+    if (who >= 1 && who <= 3) hands[who-1] |= cardIdMask(t.play[f] & 31);
+  }
+  Player *plrs[3];
+  for (int f = 0; f < 3; f++) {
+    plrs[f] = model.player(f+1);
+    setHand(plrs[f], hands[f]);
+    plrs[f]->setGame((eGameBid)t.games[f]);
+    plrs[f]->setCurrentStart(f+1 == t.first);
+    plrs[f]->mScore.poolAdd(t.pools[f]);
+  }
+  replayPlay(plrs, t);
+  Player *me = plrs[t.seat-1];
+  Player *left = plrs[t.seat%3], *right = plrs[(t.seat+1)%3];
+  int res;
+  quint64 start = monotonicUsec();
+  if (t.kind == DealRecord::DecMove) {
+    Card *lMove = cardFromId(t.left), *rMove = cardFromId(t.right);
+    res = cardId(me->makeMove(lMove, rMove, left, right, t.flags & TraceRecord::FlagPassOut));
+  } else {
+    res = me->makeBid((eGameBid)t.left, (eGameBid)t.right);
+  }
+  *usec = monotonicUsec()-start;
+  return res;
+}
+
+
+static void printGroup (const char *name, Group &g) {
+  if (!g.decisions) return;
+  printf("%-18s %9d %9d", name, g.decisions, g.replayed);
+  if (g.replayed) {
+    qSort(g.ratios);
+    double median = g.ratios[g.ratios.size()/2];
+    printf(" %9.2f%% %11.3f %9.3f", 100.0*g.differ/g.replayed,
+      g.recordedUsec ? (double)g.replayUsec/g.recordedUsec : 0.0, median);
+  }
+  printf("\n");
+}
+
+
+static void quietMessages (QtMsgType type, const char *msg) {
+  if (type != QtDebugMsg) fprintf(stderr, "%s\n", msg);
+}
+
+
+static void usage () {
+  fprintf(stderr,
+    "usage: tracereplay [options] trace...\n"
+    "  --engine NAME   engine to ask: Original or AlphaBeta (default AlphaBeta)\n"
+    "  --only NAME     replay only decisions recorded from engine NAME\n"
+    "  --limit N       stop after N decisions\n"
+    "  --verbose       print every differing decision\n");
+}
+
+
+int main (int argc, char *argv[]) {
+  int engine = DealRecord::EngineAlphaBeta, only = -1, limit = -1;
+  bool verbose = false;
+  QStringList files;
+  for (int f = 1; f < argc; f++) {
+    QString arg(argv[f]);
+    if (arg == "--verbose") {
+      verbose = true;
+      continue;
+    }
+    if (arg.startsWith("--")) {
+      if (f+1 >= argc) {
+        usage();
+        return 1;
+      }
+      QString val(argv[++f]);
+      bool ok = true;
+      if (arg == "--engine") {
+        engine = DealRecord::engineCode(val);
+        ok = engine == DealRecord::EngineOriginal || engine == DealRecord::EngineAlphaBeta;
+      } else if (arg == "--only") {
+        only = DealRecord::engineCode(val);
+        ok = only != DealRecord::EngineUnknown;
+      } else if (arg == "--limit") {
+        limit = val.toInt(&ok);
+        ok = ok && limit > 0;
+      } else ok = false;
+      if (!ok) {
+        usage();
+        return 1;
+      }
+      continue;
+    }
+    files << arg;
+  }
+  if (files.isEmpty()) {
+    usage();
+    return 1;
+  }
+
+  qInstallMsgHandler(quietMessages);
+  Group kinds[DealRecord::DecisionKinds], engines[DealRecord::Engines], total;
+  int done = 0;
+  foreach (const QString &fileName, files) {
+    TraceReader trace;
+    if (!trace.open(fileName)) {
+      fprintf(stderr, "can't read trace %s\n", qPrintable(fileName));
+      return 1;
+    }
+    TraceRecord t;
+    for (int idx = 0; idx < trace.count() && done != limit; idx++) {
+      if (!trace.record(idx, &t)) break;
+      if (only >= 0 && t.engine != only) continue;
+      if (t.kind >= DealRecord::DecisionKinds || t.engine >= DealRecord::Engines) continue;
+      done++;
+      Group *groups[3] = { &kinds[t.kind], &engines[t.engine], &total };
+      quint64 usec = 0;
+      int choice = replay(t, engine, &usec);
+      for (int g = 0; g < 3; g++) {
+        groups[g]->decisions++;
+        if (choice < 0) continue;
+        groups[g]->replayed++;
+        if (choice != t.chosen) groups[g]->differ++;
+        groups[g]->recordedUsec += t.usec;
+        groups[g]->replayUsec += usec;
+        groups[g]->ratios << (double)(usec+1)/(t.usec+1);
+      }
+      if (verbose && choice >= 0 && choice != t.chosen) {
+        bool move = t.kind == DealRecord::DecMove;
+        printf("deal %u player %d %s: %s %s, replayed %s\n", t.deal, t.seat,
+          DealRecord::kindName(t.kind), DealRecord::engineName(t.engine),
+          move ? cardIdName(t.chosen) : qPrintable(QString::number(t.chosen)),
+          move ? cardIdName(choice) : qPrintable(QString::number(choice)));
+      }
+    }
+  }
+
+  printf("%-18s %9s %9s %10s %11s %9s\n", "recorded", "decisions", "replayed",
+    "differ", "time ratio", "median");
+  for (int k = 0; k < DealRecord::DecisionKinds; k++) printGroup(DealRecord::kindName(k), kinds[k]);
+  for (int e = 0; e < DealRecord::Engines; e++) printGroup(DealRecord::engineName(e), engines[e]);
+  printGroup("total", total);
+  return 0;
+}
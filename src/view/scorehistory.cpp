@@ -1,4 +1,7 @@
 #include <QtCore/QAbstractTableModel>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QtCore/QtAlgorithms>
 #include <QtGui/QVBoxLayout>
 #include <QtGui/QHeaderView>
 #include <QtGui/QLabel>
@@ -6,6 +9,8 @@
 #include <QtGui/QStyleOptionButton>
 #include <QtGui/QPainter>
 #include <QtGui/QMessageBox>
+#include <QtGui/QPushButton>
+#include <QtGui/QTableWidget>
 #include <QDebug>
 
 #include "scorehistory.h"
@@ -13,23 +18,38 @@
 #include "player.h"
 
 namespace {
+  /// Table over deal archive; rows are decoded from the archive on demand
   class GameLogModel : public QAbstractTableModel
   {
   private:
-    QList<GameLogEntry> m_log;
+    DealArchive *m_archive;
     PrefModel *m_model;
+    int m_first; // archive record of the first row
+    int m_rows; // fetched rows
+    mutable DealRecord m_rec;
+    mutable int m_recRow;
+
+    enum { FetchRows = 256 };
+
+    const DealRecord &rec(int row) const
+    {
+      if (row != m_recRow) {
+        m_archive->record(m_first+row, &m_rec);
+        m_recRow = row;
+      }
+      return m_rec;
+    }
 
   public:
-    explicit GameLogModel(PrefModel *model, QObject * parent = 0) : QAbstractTableModel(parent),
-                                                           m_model(model)
+    explicit GameLogModel(DealArchive *archive, int first, PrefModel *model, QObject * parent = 0) :
+      QAbstractTableModel(parent), m_archive(archive), m_model(model), m_first(first), m_rows(0), m_recRow(-1)
     {
-      m_log = model->gameLog();
     }
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const
     {
       Q_UNUSED(parent)
-      return m_log.size();
+      return m_rows;
     }
 
     int columnCount(const QModelIndex &parent = QModelIndex()) const
@@ -38,6 +58,22 @@ namespace {
       return 6;
     }
 
+    bool canFetchMore(const QModelIndex &parent) const
+    {
+      if (parent.isValid()) return false;
+      return m_first+m_rows < m_archive->count();
+    }
+
+    void fetchMore(const QModelIndex &parent)
+    {
+      if (parent.isValid()) return;
+      int cnt = qMin((int)FetchRows, m_archive->count()-m_first-m_rows);
+      if (cnt <= 0) return;
+      beginInsertRows(QModelIndex(), m_rows, m_rows+cnt-1);
+      m_rows += cnt;
+      endInsertRows();
+    }
+
     QVariant data(const QModelIndex &index, int role) const
     {
       if(!index.isValid()) {
@@ -46,10 +82,11 @@ namespace {
       if (role == Qt::TextAlignmentRole) {
         return Qt::AlignCenter;
       } else if (role == Qt::DisplayRole) {
+        const DealRecord &r = rec(index.row());
         switch(index.column()) {
         case 0:
           {
-          QString s(sGameName(m_log.at(index.row()).game));
+          QString s(sGameName((eGameBid)r.game));
 //          if (s.indexOf("\1d") >= 0 || s.indexOf("\1h") >= 0) textRGB = qRgb(255, 0, 0);
           s.replace("\1s", QChar((ushort)0x2660));
           s.replace("\1c", QChar((ushort)0x2663));
@@ -61,17 +98,18 @@ namespace {
         case 1:
         case 2:
         case 3:
-            return QString::number(m_log.at(index.row()).takes[index.column()-1])
-                + (index.column() == m_log.at(index.row()).player ? "*" : "")
-                + (m_log.at(index.row()).whist[index.column()-1] ? tr("(w)") : "");
+            return QString::number(r.tricks[index.column()-1])
+                + (index.column() == r.declarer ? "*" : "")
+                + (r.finalBids[index.column()-1] == whist ? tr("(w)") : "");
         case 4:
-          return QString::number(m_log.at(index.row()).time, 'f', 1);
+          return QString::number(r.time / 10.0, 'f', 1);
         case 5:
           return tr("Show");
         }
       } else {
         return QVariant();
       }
+      return QVariant();
     }
 
     Qt::ItemFlags flags(const QModelIndex &index) const
@@ -114,35 +152,40 @@ namespace {
 }
 
 
-DealButton::DealButton(int rowNum, const QString & text, QWidget * parent)
-  : m_rowNum(rowNum), QPushButton(text, parent)
-{
-  connect(this, SIGNAL(clicked()), this, SLOT(doClick()));
-}
-
-
 ScoreHistoryDialog::ScoreHistoryDialog(PrefModel *model, QWidget *parent, Qt::WindowFlags f) :
-    QDialog(parent, f), m_model(model)
+    QDialog(parent, f), m_model(model), m_first(model->dealArchiveStart())
 {
     setWindowTitle(tr("Score History"));
     QVBoxLayout *layout = new QVBoxLayout(this);
     layout->setSpacing(5);
     layout->setContentsMargins(0,0,0,0);
+    if (!model->dealArchiveName().isEmpty())
+      m_archive.open(model->dealArchiveName());
     m_table = new QTableView(this);
     m_table->setAlternatingRowColors(true);
-    m_table->setModel(new GameLogModel(model, this));
-    for (int i=0; i<model->gameLog().size(); i++) {
-      DealButton *btnDeal = new DealButton(i, tr("Deal #") + QString::number(i+1), m_table);
-      m_table->setIndexWidget(m_table->model()->index(i, 5), btnDeal);
-      connect(btnDeal, SIGNAL(clicked(int)), this, SLOT(showDeal(int)));
-    }
+    m_table->setModel(new GameLogModel(&m_archive, m_first, model, this));
+    connect(m_table, SIGNAL(clicked(const QModelIndex &)), this, SLOT(cellClicked(const QModelIndex &)));
     layout->addWidget(m_table);
+    QPushButton *timesButton = new QPushButton(tr("Decision times..."), this);
+    connect(timesButton, SIGNAL(clicked()), this, SLOT(showDecisionSummary()));
+    layout->addWidget(timesButton);
+    // only this game's deals are shown, earlier ones were played by other players
+    if (m_archive.count() <= m_first) {
+      QLabel *label = new QLabel(model->dealArchiveName().isEmpty() ?
+        tr("Deals are not recorded: the deal archive can't be opened") : tr("No deals played yet"), this);
+      label->setAlignment(Qt::AlignCenter);
+      label->setMargin(20);
+      layout->insertWidget(0, label);
+      m_table->hide();
+      timesButton->hide();
+    }
     setLayout(layout);
 }
 
 void ScoreHistoryDialog::showEvent(QShowEvent *event)
 {
   Q_UNUSED(event)
+  if (m_table->isHidden()) return;
   m_table->verticalHeader()->hide();
   m_table->resizeColumnsToContents();
   m_table->horizontalHeader()->setStretchLastSection(true);
@@ -151,18 +194,151 @@ void ScoreHistoryDialog::showEvent(QShowEvent *event)
   resize(dialogSize);
 }
 
+void ScoreHistoryDialog::cellClicked(const QModelIndex &index)
+{
+  if (index.column() == 4)
+    showDecisions(index.row());
+  else if (index.column() == 5)
+    showDeal(index.row());
+}
+
+static QString cardsString(quint32 mask)
+{
+  QString res;
+  // spades, clubs, diamonds, hearts; higher cards first
+  for (int suit = 1; suit <= 4; suit++) {
+    for (int face = FACE_ACE; face >= 7; face--) {
+      CardId id = cardId(face, suit);
+      if (!(mask & cardIdMask(id))) continue;
+      res += cardFromId(id)->toUniString();
+      res += ' ';
+    }
+  }
+  return res;
+}
+
 void ScoreHistoryDialog::showDeal(const int row)
 {
-  Q_ASSERT(row < m_model->gameLog().size());
+  DealRecord rec;
+  if (!m_archive.record(m_first+row, &rec)) return;
   QString output;
   for (int i=1; i<=3; i++) {
     output += QString("%1").arg(m_model->player(i)->nick(), -12);
     output += ": ";
-    foreach(const Card &c, m_model->gameLog().at(row).cardList[i-1]) {
-      output += c.toUniString();
-      output += ' ';
-    }
+    output += cardsString(rec.hands[i-1]);
+    output += '\n';
+  }
+  output += QString("%1").arg(tr("Talon"), -12);
+  output += ": ";
+  output += cardsString(cardIdMask(rec.talon[0]) | cardIdMask(rec.talon[1]));
+  output += '\n';
+  if (rec.drop[0] != CardNone) {
+    output += QString("%1").arg(tr("Drop"), -12);
+    output += ": ";
+    output += cardsString(cardIdMask(rec.drop[0]) | cardIdMask(rec.drop[1]));
     output += '\n';
   }
   QMessageBox::about(0, tr("Deal #") + QString::number(row + 1), output);
 }
+
+static QString usecString(quint64 usec)
+{
+  if (usec < 1000)
+    return QString::number(usec) + " us";
+  if (usec < 1000000)
+    return QString::number(usec / 1000.0, 'f', 1) + " ms";
+  return QString::number(usec / 1000000.0, 'f', 2) + " s";
+}
+
+void ScoreHistoryDialog::showDecisions(const int row)
+{
+  DealRecord rec;
+  if (!m_archive.record(m_first+row, &rec)) return;
+  if (!rec.decisionCount) {
+    QMessageBox::about(0, tr("Deal #") + QString::number(row + 1), tr("Decision times were not recorded"));
+    return;
+  }
+  QString output;
+  for (int f = 0; f < rec.decisionCount; f++) {
+    const DealRecord::Decision &d = rec.decisions[f];
+    // a damaged record may have any seat
+    QString who = (d.seat >= 1 && d.seat <= 3) ? m_model->player(d.seat)->nick() : QString("?");
+    output += QString("%1").arg(who, -12);
+    output += QString(" %1 %2 ").arg(DealRecord::kindName(d.kind), -6).arg(DealRecord::engineName(d.engine), -10);
+    output += usecString(d.usec);
+    output += '\n';
+  }
+  QMessageBox::about(0, tr("Deal #") + QString::number(row + 1), output);
+}
+
+namespace {
+  // decision times of one group, microseconds
+  struct TimeGroup
+  {
+    QString name;
+    QVector<quint32> times;
+    quint64 total;
+
+    TimeGroup() : total(0) {}
+    void add(quint32 usec) { times.append(usec); total += usec; }
+  };
+
+  // nearest-rank percentile of sorted @a v
+  quint32 percentile(const QVector<quint32> &v, int pct)
+  {
+    int idx = (v.size() * pct + 99) / 100 - 1;
+    return v[qBound(0, idx, v.size() - 1)];
+  }
+}
+
+void ScoreHistoryDialog::showDecisionSummary()
+{
+  // players 1..3, then engines
+  QVector<TimeGroup> groups(3 + DealRecord::Engines);
+  for (int f = 1; f <= 3; f++)
+    groups[f - 1].name = m_model->player(f)->nick();
+  for (int f = 0; f < DealRecord::Engines; f++)
+    groups[3 + f].name = DealRecord::engineName(f);
+  // deals of this game only: seats of earlier ones were other players
+  DealRecord rec;
+  for (int row = m_first; row < m_archive.count(); row++) {
+    if (!m_archive.record(row, &rec)) continue;
+    for (int f = 0; f < rec.decisionCount; f++) {
+      const DealRecord::Decision &d = rec.decisions[f];
+      if (d.seat >= 1 && d.seat <= 3) groups[d.seat - 1].add(d.usec);
+      groups[3 + qMin((int)d.engine, DealRecord::Engines - 1)].add(d.usec);
+    }
+  }
+
+  static const int pcts[4] = { 50, 90, 99, 100 };
+  QStringList columns;
+  columns << tr("Decisions") << tr("Median") << tr("90%") << tr("99%") << tr("Max") << tr("Total");
+  QDialog dlg(this);
+  dlg.setWindowTitle(tr("Decision times"));
+  QVBoxLayout *layout = new QVBoxLayout(&dlg);
+  layout->setContentsMargins(0,0,0,0);
+  QTableWidget *table = new QTableWidget(0, columns.size(), &dlg);
+  table->setHorizontalHeaderLabels(columns);
+  table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  for (int g = 0; g < groups.size(); g++) {
+    TimeGroup &grp = groups[g];
+    if (grp.times.isEmpty()) continue;
+    qSort(grp.times);
+    int row = table->rowCount();
+    table->insertRow(row);
+    table->setVerticalHeaderItem(row, new QTableWidgetItem(grp.name));
+    table->setItem(row, 0, new QTableWidgetItem(QString::number(grp.times.size())));
+    for (int p = 0; p < 4; p++)
+      table->setItem(row, p + 1, new QTableWidgetItem(usecString(percentile(grp.times, pcts[p]))));
+    table->setItem(row, 5, new QTableWidgetItem(usecString(grp.total)));
+  }
+  if (!table->rowCount()) {
+    QMessageBox::about(0, tr("Decision times"), tr("Decision times were not recorded"));
+    return;
+  }
+  table->resizeColumnsToContents();
+  layout->addWidget(table);
+  dlg.resize(table->verticalHeader()->width() + table->horizontalHeader()->length() + 10,
+    table->horizontalHeader()->height() + table->verticalHeader()->length() + 10);
+  dlg.exec();
+}
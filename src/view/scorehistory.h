@@ -3,7 +3,8 @@
 
 #include <QtGui/QDialog>
 #include <QtGui/QTableView>
-#include <QtGui/QPushButton>
+
+#include "dealrecord.h"
 
 class PrefModel;
 class ScoreHistoryDialog : public QDialog
@@ -18,27 +19,17 @@ protected:
 
 private slots:
   void showDeal(const int n);
+  /// Time of every decision of deal @a n
+  void showDecisions(const int n);
+  /// Decision time percentiles of this game's deals by player and by engine
+  void showDecisionSummary();
+  void cellClicked(const QModelIndex &index);
 
 private:
   QTableView *m_table;
   PrefModel *m_model;
-};
-
-class DealButton : public QPushButton
-{
-  Q_OBJECT
-
-public:
-  explicit DealButton(int rowNum, const QString & text, QWidget * parent = 0);
-
-signals:
-  void clicked(int);
-
-private slots:
-  void doClick() { emit clicked(m_rowNum); }
-
-private:
-  int m_rowNum;
+  DealArchive m_archive;
+  int m_first; // first deal of this game in the archive
 };
 
 #endif // SCOREHISTORY_H